@@ -0,0 +1,24 @@
+-- the jungle level: its tile map and what is placed on it, see LevelLoader
+return {
+    map = "./assets/tilemaps/jungle.map",
+    tile_size = 32,
+
+    archetypes = {
+        -- driven by their script alone; steering would fight it over the velocity
+        tank = { collider = { 32, 32 }, body = true, script = "patrol" },
+        -- drive up to the base, steering along the path they are given
+        truck = { collider = { 32, 32 }, body = true, goal = { 640, 400 }, steering = { radius = 12, speed = 90 } },
+        tree = { collider = { 16, 16, 8, 16 } },
+        base = { collider = { 64, 64 } },
+        chopper = { collider = { 32, 32 }, body = true, sound = "helicopter" },
+    },
+
+    -- x, y pairs in pixels
+    objects = {
+        tank = { 336, 400, 400, 400, 368, 368 },
+        truck = { 464, 368, 496, 400, 528, 400 },
+        tree = { 48, 496, 80, 528, 48, 560, 112, 304, 240, 272, 208, 240 },
+        base = { 688, 368 },
+        chopper = { 656, 304, 752, 336 },
+    },
+}
@@ -0,0 +1,21 @@
+-- walks back and forth along x between two lines, for entities with
+-- ScriptComponent{"patrol"} and a RigidBodyComponent
+local patrol = {}
+
+local SPEED = 60
+local LEFT = 100
+local RIGHT = 700
+
+function patrol.update_batch(batch, dt)
+    local x, vx, vy = batch.x, batch.vx, batch.vy
+    for i = 1, #batch do
+        if x[i] >= RIGHT then
+            vx[i] = -SPEED
+        elseif x[i] <= LEFT or vx[i] == 0 then
+            vx[i] = SPEED
+        end
+        vy[i] = 0
+    end
+end
+
+return patrol
@@ -0,0 +1,223 @@
+// voice allocation benchmark: 300, 3k and 30k choppers flying about a
+// 4000x4000 px map around a 1920x1080 camera, 16 voices, at 60 Hz
+//
+//   make benchmarks && ./bench_audio
+//
+// reports the VoiceAllocator::Allocate time per frame, how many choppers
+// could be heard and how many voices start per second; the mixer itself
+// never mixes more than the 16 voices, however many there are. then the
+// AudioMixer callback is timed mixing those 16 voices, 1024 frames at a
+// time, and the game thread sending level changes for all of them every
+// frame. last, a 22.05 kHz music track written to a temporary WAV file is
+// decoded as fast as it goes, then streamed through a MusicPlayer into the
+// mixer's callbacks, paced as a device would, with a crossfade halfway
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../src/Audio/VoiceAllocator.h"
+#include "../src/Audio/AudioMixer.h"
+#include "../src/Audio/MusicPlayer.h"
+#include "../src/Audio/MusicSource.h"
+
+const float DELTA_TIME = 1.0f / 60.0f;
+const float MAP_SIZE = 4000.0f;
+const float SPEED = 150.0f;
+
+// seconds of 16-bit stereo PCM, a slow sweep
+void WriteTrack(const std::string &path, int frequency, int seconds)
+{
+    const uint32_t frames = static_cast<uint32_t>(frequency * seconds);
+    std::vector<int16_t> samples(2 * static_cast<size_t>(frames));
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        const float t = static_cast<float>(i) / frequency;
+        samples[2 * i] = static_cast<int16_t>(8000.0f * std::sin(6.2831853f * (220.0f + 20.0f * t) * t));
+        samples[2 * i + 1] = samples[2 * i];
+    }
+    auto u16 = [](uint8_t *out, uint32_t value)
+    { out[0] = static_cast<uint8_t>(value); out[1] = static_cast<uint8_t>(value >> 8); };
+    auto u32 = [&](uint8_t *out, uint32_t value)
+    { u16(out, value & 0xFFFF); u16(out + 2, value >> 16); };
+    const uint32_t dataSize = frames * 4;
+    uint8_t header[44];
+    std::memcpy(header, "RIFF", 4);
+    u32(header + 4, 36 + dataSize);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    u32(header + 16, 16);
+    u16(header + 20, 1);
+    u16(header + 22, 2);
+    u32(header + 24, static_cast<uint32_t>(frequency));
+    u32(header + 28, static_cast<uint32_t>(frequency) * 4);
+    u16(header + 32, 4);
+    u16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    u32(header + 40, dataSize);
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(samples.data()), dataSize);
+}
+
+struct Chopper
+{
+    glm::vec2 position;
+    float heading;
+    int voice;
+};
+
+int main()
+{
+    const size_t counts[] = {300, 3000, 30000};
+    const int frames = 600;
+    const glm::vec2 camera(MAP_SIZE * 0.5f);
+    for (size_t count : counts)
+    {
+        std::mt19937 random(5);
+        std::uniform_real_distribution<float> anywhere(0.0f, MAP_SIZE);
+        std::uniform_real_distribution<float> turn(-1.0f, 1.0f);
+        std::vector<Chopper> choppers(count);
+        for (auto &chopper : choppers)
+        {
+            chopper = {glm::vec2(anywhere(random), anywhere(random)), anywhere(random), -1};
+        }
+
+        VoiceAllocator voices;
+        voices.Reserve(count);
+        double total = 0.0;
+        double worst = 0.0;
+        size_t audible = 0;
+        size_t starts = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            voices.Clear();
+            for (const auto &chopper : choppers)
+            {
+                voices.AddEmitter(chopper.position, 1.0f, 0, 100.0f, 1500.0f, chopper.voice);
+            }
+            voices.Allocate(camera, 960.0f);
+            for (size_t i = 0; i < count; i++)
+            {
+                choppers[i].voice = voices.GetAssignedVoice(static_cast<int>(i));
+            }
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            total += milliseconds;
+            worst = std::max(worst, milliseconds);
+            audible += voices.GetAudibleCount();
+            // the first frame starts every voice
+            starts += frame > 0 ? voices.GetStartCount() : 0;
+
+            for (auto &chopper : choppers)
+            {
+                chopper.heading += turn(random) * DELTA_TIME;
+                chopper.position += glm::vec2(std::cos(chopper.heading), std::sin(chopper.heading)) * SPEED * DELTA_TIME;
+                chopper.position = glm::clamp(chopper.position, glm::vec2(0.0f), glm::vec2(MAP_SIZE));
+            }
+        }
+        printf("%6zu choppers  %7.3f ms/frame (worst %6.3f)  %6.0f audible  %4.1f voice starts/s\n",
+               count, total / frames, worst, static_cast<double>(audible) / frames,
+               static_cast<double>(starts) / (frames * DELTA_TIME));
+    }
+
+    // a 2 s chopper loop on each of the 16 voices
+    const int frequency = 44100;
+    const size_t callbackFrames = 1024;
+    std::vector<int16_t> loop(2 * 2 * frequency);
+    for (size_t i = 0; i < loop.size(); i++)
+    {
+        loop[i] = static_cast<int16_t>(8000.0f * std::sin(0.05f * static_cast<float>(i / 2)));
+    }
+    AudioMixer mixer;
+    mixer.SetFrequency(frequency);
+    for (int v = 0; v < VoiceAllocator::DEFAULT_VOICES; v++)
+    {
+        mixer.Play(v, loop.data(), static_cast<uint32_t>(loop.size() / 2), static_cast<uint32_t>(v * 1000), true, 0.05f, 0.05f);
+    }
+    std::vector<int16_t> stream(2 * callbackFrames);
+    const int callbacks = 2000;
+    double mixTotal = 0.0;
+    double mixWorst = 0.0;
+    double sendTotal = 0.0;
+    // a game frame, then a callback; on the one thread, to time each alone
+    for (int callback = 0; callback < callbacks; callback++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int v = 0; v < VoiceAllocator::DEFAULT_VOICES; v++)
+        {
+            mixer.SetLevels(v, 0.03f + 0.001f * (callback % 20), 0.05f);
+        }
+        mixer.Submit();
+        sendTotal += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        mixer.Mix(stream.data(), callbackFrames);
+        double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        mixTotal += microseconds;
+        mixWorst = std::max(mixWorst, microseconds);
+    }
+    const double callbackMicroseconds = 1e6 * callbackFrames / frequency;
+    printf("mixer, %d voices: %.1f us per %zu frame callback (worst %.1f, %.2f%% of the %.0f us it plays)\n",
+           mixer.GetPlayingCount(), mixTotal / callbacks, callbackFrames, mixWorst,
+           100.0 * mixTotal / callbacks / callbackMicroseconds, callbackMicroseconds);
+    printf("game thread: %.2f us to send %d level changes, %llu commands taken by the callbacks\n",
+           sendTotal / callbacks, VoiceAllocator::DEFAULT_VOICES, static_cast<unsigned long long>(mixer.GetCommandCount()));
+
+    const std::string track = (std::filesystem::temp_directory_path() / "bench_audio_music.wav").string();
+    const int trackFrequency = 22050;
+    const int trackSeconds = 20;
+    WriteTrack(track, trackFrequency, trackSeconds);
+    MusicSource source;
+    std::string error;
+    if (!source.Open(track, error))
+    {
+        printf("music track %s\n", error.c_str());
+        return 1;
+    }
+    std::vector<int16_t> chunk(2 * MusicPlayer::CHUNK_FRAMES);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t decodedFrames = 0;
+    while (size_t read = source.Read(chunk.data(), MusicPlayer::CHUNK_FRAMES))
+    {
+        decodedFrames += read;
+    }
+    const double decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("music: %d s track read in %.2f ms, %.0fx real time\n", trackSeconds, 1e3 * decodeSeconds,
+           decodedFrames / static_cast<double>(trackFrequency) / decodeSeconds);
+
+    // real time, one callback a period, the decoder thread filling alongside
+    MusicPlayer music;
+    music.Start(frequency);
+    mixer.SetMusic(&music);
+    music.Play(track, 0.5f, true);
+    const int musicCallbacks = 120;
+    const auto period = std::chrono::microseconds(static_cast<long long>(callbackMicroseconds));
+    auto next = std::chrono::steady_clock::now() + 2 * period;
+    mixTotal = 0.0;
+    int crossfading = 0;
+    for (int callback = 0; callback < musicCallbacks; callback++)
+    {
+        std::this_thread::sleep_until(next);
+        next += period;
+        if (callback == musicCallbacks / 2)
+        {
+            music.Play(track, 0.5f, true);
+        }
+        start = std::chrono::steady_clock::now();
+        mixer.Mix(stream.data(), callbackFrames);
+        mixTotal += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        crossfading = std::max(crossfading, music.GetPlayingCount());
+    }
+    printf("music streamed: %.1f us per callback with the voices, %d tracks at once at most, %llu underruns, %zu KB of rings\n",
+           mixTotal / musicCallbacks, crossfading, static_cast<unsigned long long>(music.GetUnderrunCount()),
+           MusicPlayer::GetRingBytes() / 1024);
+    music.Shutdown();
+    std::filesystem::remove(track);
+    return 0;
+}
@@ -0,0 +1,182 @@
+// broadphase benchmark: 10k, 100k and 1M colliders, uniformly spread versus
+// packed into a few clusters, through every CollisionSystem broadphase mode
+//
+//   make benchmarks && ./bench_collision [scene dump]
+//
+// a scene dump written by CollisionSystem::DumpScene replaces the generated
+// scenes, so all modes can be compared on a real level
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/Jobs/JobSystem.h"
+#include "../src/Systems/CollisionSystem.h"
+
+enum Distribution
+{
+    UNIFORM,
+    CLUSTERED
+};
+
+// boxes between 8 and 32 px; the world grows with the count so the average
+// density stays the same and only the distribution changes
+std::vector<AABB> MakeScene(size_t count, Distribution distribution, unsigned seed)
+{
+    std::mt19937 random(seed);
+    float worldSize = std::sqrt(static_cast<float>(count)) * 64.0f;
+    std::uniform_real_distribution<float> size(8.0f, 32.0f);
+    std::uniform_real_distribution<float> anywhere(0.0f, worldSize);
+    std::vector<glm::vec2> centers(32);
+    for (auto &center : centers)
+    {
+        center = glm::vec2(anywhere(random), anywhere(random));
+    }
+    std::normal_distribution<float> spread(0.0f, worldSize / 40.0f);
+    std::uniform_int_distribution<size_t> pickCluster(0, centers.size() - 1);
+
+    std::vector<AABB> boxes(count);
+    for (auto &box : boxes)
+    {
+        glm::vec2 position;
+        if (distribution == UNIFORM)
+        {
+            position = glm::vec2(anywhere(random), anywhere(random));
+        }
+        else
+        {
+            const glm::vec2 &center = centers[pickCluster(random)];
+            position = center + glm::vec2(spread(random), spread(random));
+        }
+        box.min = position;
+        box.max = position + glm::vec2(size(random), size(random));
+    }
+    return boxes;
+}
+
+bool LoadScene(const std::string &path, std::vector<AABB> &boxes)
+{
+    std::ifstream file(path);
+    size_t count;
+    if (!(file >> count))
+    {
+        return false;
+    }
+    boxes.resize(count);
+    for (auto &box : boxes)
+    {
+        if (!(file >> box.min.x >> box.min.y >> box.max.x >> box.max.y))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Result
+{
+    double milliseconds;
+    size_t pairs;
+};
+
+// every frame one collider in ten moves a couple of pixels, like units
+// driving around between static scenery
+Result RunMode(const std::vector<AABB> &boxes, BroadphaseMode mode)
+{
+    const int FRAMES = 5;
+    Registry registry;
+    registry.AddSystem<CollisionSystem>(mode);
+    std::vector<Entity> entities;
+    entities.reserve(boxes.size());
+    for (const auto &box : boxes)
+    {
+        Entity entity = registry.CreateEntity();
+        glm::vec2 size = box.max - box.min;
+        entity.AddComponent<TransformerComponent>(box.min, glm::vec2(1.0), 0.0);
+        entity.AddComponent<BoxColliderComponent>(static_cast<int>(std::ceil(size.x)), static_cast<int>(std::ceil(size.y)));
+        // the ones that move need a body, the rest is static scenery
+        if (entities.size() % 10 == 0)
+        {
+            entity.AddComponent<RigidBodyComponent>();
+        }
+        entities.push_back(entity);
+    }
+    registry.Update();
+    auto &collisionSystem = registry.GetSystem<CollisionSystem>();
+    // the first frame inserts everything, which is not what we're measuring
+    collisionSystem.Update();
+
+    Result result{0.0, 0};
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        // the pair lists come from the frame arena, as in the game
+        FrameArena::NewFrame();
+        float step = frame % 2 ? -2.0f : 2.0f;
+        for (size_t i = 0; i < entities.size(); i += 10)
+        {
+            entities[i].GetComponent<TransformerComponent>().position.x += step;
+        }
+        auto start = std::chrono::steady_clock::now();
+        collisionSystem.Update();
+        result.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.pairs = collisionSystem.GetCollisions().size();
+    }
+    result.milliseconds /= FRAMES;
+    return result;
+}
+
+bool Compare(const char *label, const std::vector<AABB> &boxes)
+{
+    const BroadphaseMode modes[] = {BROADPHASE_SPATIAL_HASH, BROADPHASE_DYNAMIC_TREE, BROADPHASE_SWEEP_AND_PRUNE};
+    Result results[3];
+    for (int i = 0; i < 3; i++)
+    {
+        results[i] = RunMode(boxes, modes[i]);
+    }
+    printf("%-22s %10zu %10.2f %10.2f %10.2f\n", label, results[0].pairs,
+           results[0].milliseconds, results[1].milliseconds, results[2].milliseconds);
+    if (results[1].pairs != results[0].pairs || results[2].pairs != results[0].pairs)
+    {
+        printf("pair count mismatch: hash %zu, tree %zu, sweep %zu\n", results[0].pairs, results[1].pairs, results[2].pairs);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    JobSystem::Initialize();
+    printf("%-22s %10s %10s %10s %10s   (ms per frame)\n", "scene", "pairs", "hash", "tree", "sweep");
+
+    bool ok = true;
+    if (argc > 1)
+    {
+        std::vector<AABB> boxes;
+        if (!LoadScene(argv[1], boxes))
+        {
+            printf("cannot read scene dump %s\n", argv[1]);
+            return 1;
+        }
+        ok = Compare(argv[1], boxes);
+    }
+    else
+    {
+        const size_t counts[] = {10000, 100000, 1000000};
+        const char *names[] = {"uniform", "clustered"};
+        for (size_t count : counts)
+        {
+            for (int distribution = UNIFORM; distribution <= CLUSTERED; distribution++)
+            {
+                char label[64];
+                snprintf(label, sizeof(label), "%zu %s", count, names[distribution]);
+                ok = Compare(label, MakeScene(count, static_cast<Distribution>(distribution), 1234)) && ok;
+            }
+        }
+    }
+    JobSystem::Shutdown();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// level loading benchmark: 100k tanks, trucks, trees and bases
+//
+//   make benchmarks && ./bench_level
+//
+// the same objects are created one create and one add per component at a
+// time, and counted, reserved and created in bulk; both from positions
+// already in memory, then joined to a MovementSystem with Registry::Update.
+// then a generated level file with the objects is loaded by LevelLoader,
+// compiled and from the bytecode cache, which includes running the Lua
+// table constructor and reading it back
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/Components/TransformerComponent.h"
+#include "../src/Components/BoxColliderComponent.h"
+#include "../src/Components/RigidBodyComponent.h"
+#include "../src/Components/PathComponent.h"
+#include "../src/Components/SteeringComponent.h"
+#include "../src/Level/LevelLoader.h"
+#include "../src/Systems/MovementSystem.h"
+
+const char *NAMES[] = {"base", "tank", "tree", "truck"};
+// of every 100 objects
+const int SHARES[] = {1, 20, 60, 19};
+
+struct Placement
+{
+    int archetype;
+    float x;
+    float y;
+};
+
+double Since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the components LevelLoader gives each archetype of the generated level
+void AddOne(Entity entity, const Placement &placement)
+{
+    entity.AddComponent<TransformerComponent>(glm::vec2(placement.x, placement.y), glm::vec2(1.0f), 0.0);
+    entity.AddComponent<BoxColliderComponent>(32, 32, glm::vec2(0.0f));
+    if (placement.archetype == 1 || placement.archetype == 3)
+    {
+        entity.AddComponent<RigidBodyComponent>();
+        entity.AddComponent<PathComponent>();
+        entity.AddComponent<SteeringComponent>();
+    }
+}
+
+double OneByOne(const std::vector<Placement> &placements)
+{
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<MovementSystem>();
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &placement : placements)
+    {
+        AddOne(registry->CreateEntity(), placement);
+    }
+    registry->Update();
+    return Since(start);
+}
+
+double Bulk(const std::vector<Placement> &placements)
+{
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<MovementSystem>();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<glm::vec2>> positions(4);
+    for (const auto &placement : placements)
+    {
+        positions[placement.archetype].push_back(glm::vec2(placement.x, placement.y));
+    }
+    registry->ReserveEntities(placements.size());
+    registry->ReserveComponents<TransformerComponent>(placements.size());
+    registry->ReserveComponents<BoxColliderComponent>(placements.size());
+    for (int archetype = 0; archetype < 4; archetype++)
+    {
+        const auto &at = positions[archetype];
+        std::vector<Entity> entities = registry->CreateEntities(at.size());
+        registry->AddComponents<TransformerComponent>(entities, [&](size_t i)
+                                                      { return TransformerComponent{at[i], glm::vec2(1.0f), 0.0}; });
+        registry->AddComponents<BoxColliderComponent>(entities, [](size_t)
+                                                      { return BoxColliderComponent{32, 32, glm::vec2(0.0f)}; });
+        if (archetype == 1 || archetype == 3)
+        {
+            registry->AddComponents<RigidBodyComponent>(entities, [](size_t)
+                                                        { return RigidBodyComponent(); });
+            registry->AddComponents<PathComponent>(entities, [](size_t)
+                                                   { return PathComponent(); });
+            registry->AddComponents<SteeringComponent>(entities, [](size_t)
+                                                       { return SteeringComponent(); });
+        }
+    }
+    registry->Update();
+    return Since(start);
+}
+
+std::string MakeLevel(const std::vector<Placement> &placements)
+{
+    std::string source = "return {\n"
+                         "    map = \"./assets/tilemaps/jungle.map\",\n"
+                         "    archetypes = {\n"
+                         "        base = { collider = { 32, 32 } },\n"
+                         "        tank = { collider = { 32, 32 }, body = true, path = true, steering = {} },\n"
+                         "        tree = { collider = { 32, 32 } },\n"
+                         "        truck = { collider = { 32, 32 }, body = true, path = true, steering = {} },\n"
+                         "    },\n"
+                         "    objects = {\n";
+    for (int archetype = 0; archetype < 4; archetype++)
+    {
+        source += std::string("        ") + NAMES[archetype] + " = {";
+        for (const auto &placement : placements)
+        {
+            if (placement.archetype == archetype)
+            {
+                source += std::to_string(static_cast<int>(placement.x)) + "," + std::to_string(static_cast<int>(placement.y)) + ",";
+            }
+        }
+        source += "},\n";
+    }
+    return source + "    },\n}\n";
+}
+
+double FromFile(LevelLoader &levels, const std::string &path, size_t &created)
+{
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<MovementSystem>();
+    auto start = std::chrono::steady_clock::now();
+    Level level;
+    if (!levels.Load(path, *registry, level))
+    {
+        printf("%s failed to load\n", path.c_str());
+    }
+    registry->Update();
+    created = level.objectCount;
+    return Since(start);
+}
+
+int main()
+{
+    const size_t count = 100000;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> anywhere(0.0f, 8000.0f);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<Placement> placements;
+    for (size_t i = 0; i < count; i++)
+    {
+        int roll = percent(random);
+        int archetype = 0;
+        while (roll >= SHARES[archetype])
+        {
+            roll -= SHARES[archetype++];
+        }
+        // whole pixels, as written to the level file
+        placements.push_back({archetype, static_cast<float>(static_cast<int>(anywhere(random))),
+                              static_cast<float>(static_cast<int>(anywhere(random)))});
+    }
+
+    // best of three, the first run also pays for faulting in the heap
+    double oneByOne = 1e9;
+    double bulk = 1e9;
+    for (int run = 0; run < 3; run++)
+    {
+        oneByOne = std::min(oneByOne, OneByOne(placements));
+        bulk = std::min(bulk, Bulk(placements));
+    }
+    printf("%zu objects\n", count);
+    printf("%-22s %7.1f ms\n", "one by one", oneByOne);
+    printf("%-22s %7.1f ms\n", "counted, in bulk", bulk);
+
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "bench_level_load";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    const std::string path = (root / "level.lua").string();
+    std::string source = MakeLevel(placements);
+    std::ofstream(path, std::ios::binary) << source;
+
+    size_t created = 0;
+    LevelLoader compiling;
+    double compiled = FromFile(compiling, path, created);
+    printf("%-22s %7.1f ms  (%zu objects, %zu KB of source)\n", "level file, compiled", compiled, created, source.size() / 1024);
+    LevelLoader caching;
+    caching.GetLoader().SetCacheDirectory((root / "cache").string());
+    FromFile(caching, path, created);
+    double cached = 1e9;
+    for (int run = 0; run < 3; run++)
+    {
+        LevelLoader later;
+        later.GetLoader().SetCacheDirectory((root / "cache").string());
+        cached = std::min(cached, FromFile(later, path, created));
+    }
+    printf("%-22s %7.1f ms  (%zu objects)\n", "level file, cached", cached, created);
+
+    fs::remove_all(root);
+    return 0;
+}
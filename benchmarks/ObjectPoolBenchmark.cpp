@@ -0,0 +1,124 @@
+// ObjectPool versus new/delete and std::allocator under multi-threaded churn
+//
+//   make benchmarks && ./bench_objectpool [threads] [operations per thread]
+//
+// every thread keeps a working set of live particles and keeps replacing a
+// random one, which is what bullets and particles do to the allocator
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../src/Memory/ObjectPool.h"
+
+struct Particle
+{
+    float position[2];
+    float velocity[2];
+    float color[4];
+    int lifetime;
+    int sprite;
+};
+
+const size_t WORKING_SET = 4096;
+
+// small xorshift so the benchmark doesn't measure rand()'s lock
+struct Random
+{
+    uint32_t state;
+    uint32_t Next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+template <typename TAllocate, typename TFree>
+void Churn(size_t operations, uint32_t seed, TAllocate allocate, TFree release)
+{
+    std::vector<Particle *> live(WORKING_SET);
+    for (auto &particle : live)
+    {
+        particle = allocate();
+    }
+    Random random{seed};
+    for (size_t i = 0; i < operations; i++)
+    {
+        size_t index = random.Next() % WORKING_SET;
+        release(live[index]);
+        live[index] = allocate();
+        live[index]->lifetime = static_cast<int>(i);
+    }
+    for (auto particle : live)
+    {
+        release(particle);
+    }
+}
+
+template <typename TWorker>
+double Run(const char *name, int threads, size_t operations, TWorker worker)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back(worker, t);
+    }
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double totalOperations = static_cast<double>(operations) * threads;
+    printf("%-28s %8.2f ms  %7.2f ns/op  %8.2f Mops/s\n", name, seconds * 1000.0,
+           seconds * 1e9 / totalOperations, totalOperations / seconds / 1e6);
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    size_t operations = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000000;
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    printf("%d threads, %zu alloc/free pairs per thread, %zu live objects each\n", threads, operations, WORKING_SET);
+
+    Run("new/delete", threads, operations, [&](int t)
+        { Churn(operations, 0x9e3779b9u + t, []
+                { return new Particle(); },
+                [](Particle *particle)
+                { delete particle; }); });
+
+    Run("std::allocator", threads, operations, [&](int t)
+        {
+            std::allocator<Particle> allocator;
+            Churn(operations, 0x9e3779b9u + t, [&]
+                  {
+                      Particle *particle = allocator.allocate(1);
+                      return new (particle) Particle();
+                  },
+                  [&](Particle *particle)
+                  { allocator.deallocate(particle, 1); }); });
+
+    ObjectPool<Particle> sharedPool(1024, true);
+    Run("ObjectPool shared + caches", threads, operations, [&](int t)
+        { Churn(operations, 0x9e3779b9u + t, [&]
+                { return sharedPool.New(); },
+                [&](Particle *particle)
+                { sharedPool.Delete(particle); }); });
+
+    Run("ObjectPool per thread", threads, operations, [&](int t)
+        {
+            ObjectPool<Particle> pool(1024);
+            Churn(operations, 0x9e3779b9u + t, [&]
+                  { return pool.New(); },
+                  [&](Particle *particle)
+                  { pool.Delete(particle); }); });
+    return 0;
+}
@@ -0,0 +1,241 @@
+// grid pathfinding benchmark: paths per second with JPS+, plain A* and
+// HPA* on 256x256, 1024x1024 and 4096x4096 maps, and one flow field for a
+// whole group against a JPS+ path per unit. on the 1024x1024 map 500 units
+// are also ordered in one frame through the PathService, answered within a
+// 2 ms budget per frame on the main thread and then on the workers
+//
+//   make benchmarks && ./bench_pathfinding
+//
+// the maps are open ground with random rectangular rocks and lakes over
+// about a quarter of the area; every JPS+ path is checked against the A*
+// path length on the same query, HPA* paths (default heuristic weight) are
+// reported as their average length over the optimal one. the flow field
+// runs on the JobSystem workers
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../src/Jobs/JobSystem.h"
+#include "../src/Pathfinding/FlowField.h"
+#include "../src/Pathfinding/GridPathfinder.h"
+#include "../src/Pathfinding/HierarchicalPathfinder.h"
+#include "../src/Pathfinding/PathService.h"
+#include "../src/Terrain/TerrainMap.h"
+
+const int GROUND = 0;
+const int ROCK = 25;
+
+std::vector<int> MakeMap(int size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::vector<int> tiles(static_cast<size_t>(size) * size, GROUND);
+    std::uniform_int_distribution<int> anywhere(0, size - 1);
+    std::uniform_int_distribution<int> extent(1, 12);
+    size_t covered = 0;
+    while (covered < tiles.size() / 4)
+    {
+        int x = anywhere(random);
+        int y = anywhere(random);
+        int w = extent(random);
+        int h = extent(random);
+        for (int row = y; row < std::min(size, y + h); row++)
+        {
+            for (int column = x; column < std::min(size, x + w); column++)
+            {
+                int &tile = tiles[static_cast<size_t>(row) * size + column];
+                covered += tile == GROUND;
+                tile = ROCK;
+            }
+        }
+    }
+    return tiles;
+}
+
+struct Query
+{
+    glm::ivec2 start;
+    glm::ivec2 goal;
+};
+
+// orders every unit twice, the second time after the first orders were
+// answered, and updates the service once per 60 Hz frame until nothing is
+// pending; the rest of each frame is slept away like a frame limiter would
+void OrderUnits(PathService &service, const std::vector<Query> &orders, const char *mode)
+{
+    int frames = 0;
+    double worstMs = 0.0;
+    size_t answered = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < 2; round++)
+    {
+        for (size_t unit = 0; unit < orders.size(); unit++)
+        {
+            service.Request(orders[unit].start, orders[unit].goal, static_cast<int>(unit % 3));
+        }
+        do
+        {
+            auto frameStart = std::chrono::steady_clock::now();
+            service.Update();
+            answered += service.GetCompletions().size();
+            worstMs = std::max(worstMs, service.GetLastUpdateMs());
+            frames++;
+            std::this_thread::sleep_until(frameStart + std::chrono::microseconds(16667));
+        } while (service.GetPendingCount() > 0);
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    service.Update();
+    answered += service.GetCompletions().size();
+    printf("           %-8s %zu orders answered over %4d frames, worst frame %6.2f ms, %7.1f ms until the last answer  "
+           "(%zu searches, %zu shared, %zu from cache)\n",
+           mode, answered, frames, worstMs, totalMs, service.GetSearchCount(), service.GetSharedCount(), service.GetCacheHitCount());
+}
+
+int main()
+{
+    const int sizes[] = {256, 1024, 4096};
+    const int queryCounts[] = {2000, 300, 40};
+    TileProperties properties;
+    properties.Set(ROCK, TILE_SOLID);
+    JobSystem::Initialize();
+
+    for (int i = 0; i < 3; i++)
+    {
+        int size = sizes[i];
+        TerrainMap terrain;
+        terrain.Load(size, size, MakeMap(size, 7 + i), properties, 32.0f);
+
+        auto buildStart = std::chrono::steady_clock::now();
+        GridPathfinder pathfinder;
+        pathfinder.Build(terrain);
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> anywhere(0, size - 1);
+        std::vector<Query> queries;
+        while (static_cast<int>(queries.size()) < queryCounts[i])
+        {
+            Query query = {glm::ivec2(anywhere(random), anywhere(random)), glm::ivec2(anywhere(random), anywhere(random))};
+            if (!terrain.IsBlocked(query.start.x, query.start.y) && !terrain.IsBlocked(query.goal.x, query.goal.y))
+            {
+                queries.push_back(query);
+            }
+        }
+
+        std::vector<glm::ivec2> path;
+        std::vector<float> jumpCosts;
+        long jumpExpanded = 0;
+        auto jumpStart = std::chrono::steady_clock::now();
+        for (const auto &query : queries)
+        {
+            pathfinder.FindPath(query.start, query.goal, path);
+            jumpCosts.push_back(path.empty() ? -1.0f : pathfinder.GetLastCost());
+            jumpExpanded += pathfinder.GetLastExpandedCount();
+        }
+        double jumpSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jumpStart).count();
+
+        int mismatches = 0;
+        long aStarExpanded = 0;
+        auto aStarStart = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries.size(); q++)
+        {
+            pathfinder.FindPathAStar(queries[q].start, queries[q].goal, path);
+            float cost = path.empty() ? -1.0f : pathfinder.GetLastCost();
+            aStarExpanded += pathfinder.GetLastExpandedCount();
+            if (std::abs(cost - jumpCosts[q]) > 1e-3f * std::max(1.0f, cost))
+            {
+                mismatches++;
+            }
+        }
+        double aStarSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - aStarStart).count();
+
+        printf("%4dx%-4d  build %7.1f ms  JPS+ %9.1f paths/s (%7ld expanded/path)  A* %9.1f paths/s (%8ld expanded/path)  %s\n",
+               size, size, buildMs,
+               queries.size() / jumpSeconds, jumpExpanded / static_cast<long>(queries.size()),
+               queries.size() / aStarSeconds, aStarExpanded / static_cast<long>(queries.size()),
+               mismatches == 0 ? "lengths match" : "LENGTH MISMATCH");
+
+        buildStart = std::chrono::steady_clock::now();
+        HierarchicalPathfinder hierarchical;
+        hierarchical.Build(terrain);
+        buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+        double lengthRatio = 0.0;
+        int found = 0;
+        long abstractExpanded = 0;
+        auto hierarchicalStart = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries.size(); q++)
+        {
+            if (hierarchical.FindPath(queries[q].start, queries[q].goal, path) && jumpCosts[q] > 0.0f)
+            {
+                lengthRatio += hierarchical.GetLastCost() / jumpCosts[q];
+                found++;
+            }
+            abstractExpanded += hierarchical.GetLastExpandedCount();
+        }
+        double hierarchicalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hierarchicalStart).count();
+
+        if (size == 1024)
+        {
+            // 500 units from 250 spawn tiles to 5 rally points, so half the orders repeat
+            std::vector<Query> orders;
+            for (int unit = 0; unit < 500; unit++)
+            {
+                orders.push_back({queries[unit % 250].start, queries[unit % 5].goal});
+            }
+            auto syncStart = std::chrono::steady_clock::now();
+            for (const auto &order : orders)
+            {
+                pathfinder.FindPath(order.start, order.goal, path);
+            }
+            double syncMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - syncStart).count();
+            printf("           500 orders searched in one frame: %7.1f ms\n", syncMs);
+
+            PathService budgeted;
+            budgeted.SetPathfinder(&pathfinder);
+            budgeted.SetUseWorkers(false);
+            budgeted.SetFrameBudget(2.0);
+            OrderUnits(budgeted, orders, "budget");
+
+            PathService threaded;
+            threaded.SetPathfinder(&pathfinder);
+            OrderUnits(threaded, orders, "workers");
+        }
+
+        // drop a rock in the middle of the map and patch the graph
+        int middle = size / 2;
+        terrain.SetTile(middle, middle, properties, ROCK);
+        auto patchStart = std::chrono::steady_clock::now();
+        hierarchical.OnTilesChanged(middle, middle, middle, middle);
+        double patchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - patchStart).count();
+
+        printf("           build %7.1f ms  HPA* %9.1f paths/s (%7ld expanded/path, %.3f x optimal length, %.3f ms/path)  "
+               "%d nodes, tile change rebuilt %d clusters in %.3f ms\n",
+               buildMs, queries.size() / hierarchicalSeconds, abstractExpanded / static_cast<long>(queries.size()),
+               found ? lengthRatio / found : 0.0, 1000.0 * hierarchicalSeconds / queries.size(),
+               hierarchical.GetNodeCount(), hierarchical.GetRebuiltClusterCount(), patchMs);
+
+        // a group of units sharing the first query's goal: one field for all
+        // of them, or one JPS+ path each
+        glm::ivec2 groupGoal = queries[0].goal;
+        auto fieldStart = std::chrono::steady_clock::now();
+        FlowField field;
+        field.Build(terrain, groupGoal);
+        double fieldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fieldStart).count();
+
+        const int groupSize = 200;
+        auto groupStart = std::chrono::steady_clock::now();
+        for (int unit = 0; unit < groupSize; unit++)
+        {
+            pathfinder.FindPath(queries[unit % queries.size()].start, groupGoal, path);
+        }
+        double groupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - groupStart).count();
+
+        printf("           flow field %7.1f ms (%d rounds, %d chunk solves)  vs %d JPS+ paths to the same goal %7.1f ms\n",
+               fieldMs, field.GetRoundCount(), field.GetChunkSolveCount(), groupSize, groupMs);
+    }
+    JobSystem::Shutdown();
+    return 0;
+}
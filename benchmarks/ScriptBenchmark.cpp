@@ -0,0 +1,440 @@
+// script bridge benchmark: 10k entities running the same Lua behaviour,
+// once called per entity and once per ScriptBatch chunk
+//
+//   make benchmarks && ./bench_script
+//
+// both behaviours bounce the entities around inside a box; the final
+// positions are compared so the two ways are known to do the same work.
+// then the scheduler is put under load: the batched bounce next to
+// heavy run() coroutines and a script that never returns, under the
+// default frame budget. after that, garbage-heavy scripts on the default
+// allocator against ScriptAllocator, and a script with a large heap and
+// garbage every frame under the collector profiles, and AI work that reads
+// other entities in one Lua state and split over several on worker threads.
+// then 300 generated script files are loaded the ways ScriptLoader can:
+// compiled, through an empty and a filled bytecode cache and from a pack,
+// next to only reading the files (warm OS file cache throughout)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/Components/TransformerComponent.h"
+#include "../src/Components/RigidBodyComponent.h"
+#include "../src/Components/ScriptComponent.h"
+#include "../src/Jobs/JobSystem.h"
+#include "../src/Scripting/ScriptAllocator.h"
+#include "../src/Scripting/ScriptLoader.h"
+#include "../src/Systems/ScriptSystem.h"
+
+const char *PER_ENTITY = R"(
+local bounce = {}
+function bounce.update(entity, dt)
+    local x, y = entity:position()
+    local vx, vy = entity:velocity()
+    if (x < 0 and vx < 0) or (x > 4000 and vx > 0) then vx = -vx end
+    if (y < 0 and vy < 0) or (y > 4000 and vy > 0) then vy = -vy end
+    entity:set_velocity(vx, vy)
+    entity:set_position(x + vx * dt, y + vy * dt)
+end
+return bounce
+)";
+
+const char *BATCHED = R"(
+local bounce = {}
+function bounce.update_batch(batch, dt)
+    local x, y, vx, vy = batch.x, batch.y, batch.vx, batch.vy
+    for i = 1, #batch do
+        if (x[i] < 0 and vx[i] < 0) or (x[i] > 4000 and vx[i] > 0) then vx[i] = -vx[i] end
+        if (y[i] < 0 and vy[i] < 0) or (y[i] > 4000 and vy[i] > 0) then vy[i] = -vy[i] end
+        x[i] = x[i] + vx[i] * dt
+        y[i] = y[i] + vy[i] * dt
+    end
+end
+return bounce
+)";
+
+const char *THINKER = R"(
+local thinker = {}
+function thinker.run(entity, dt)
+    local n = 0
+    while true do
+        for i = 1, 400000 do n = (n + i * 7) % 1000 end
+        entity:set_position(n, n)
+        dt = coroutine.yield()
+    end
+end
+return thinker
+)";
+
+const char *STUCK = R"(
+return { update = function(entity, dt) while true do end end }
+)";
+
+// a short-lived table and string per entity, like scripts that build
+// messages or target lists every frame, next to a large long-lived heap
+const char *LITTERING = R"(
+local litter = {}
+local memory = {}
+for i = 1, 300000 do memory[i] = { seen = i, where = "cell" .. i } end
+function litter.update_batch(batch, dt)
+    local x, id = batch.x, batch.id
+    for i = 1, #batch do
+        local note = { id = id[i], x = x[i], tag = "unit" .. id[i] }
+        local cell = memory[id[i] % #memory + 1]
+        cell.seen = cell.seen + 1
+        x[i] = note.x + #note.tag * dt
+    end
+end
+return litter
+)";
+
+// steers every unit towards a few others, read through world.position, so
+// the states read entities that run in other states
+const char *SWARM = R"(
+local swarm = {}
+function swarm.update_batch(batch, dt)
+    local id, x, y, vx, vy = batch.id, batch.x, batch.y, batch.vx, batch.vy
+    for i = 1, #batch do
+        local sx, sy, n = 0, 0, 0
+        for k = 1, 16 do
+            local ox, oy = world.position(id[i] + k * 7)
+            if ox then sx, sy, n = sx + ox, sy + oy, n + 1 end
+        end
+        if n > 0 then
+            local dx, dy = sx / n - x[i], sy / n - y[i]
+            local length = math.sqrt(dx * dx + dy * dy) + 1
+            vx[i] = vx[i] * 0.9 + dx / length * 10
+            vy[i] = vy[i] * 0.9 + dy / length * 10
+        end
+        x[i] = x[i] + vx[i] * dt
+        y[i] = y[i] + vy[i] * dt
+    end
+end
+return swarm
+)";
+
+const char *CHURN = R"(
+local kept = {}
+for i = 1, 2000000 do
+    local t = { i, i + 1, name = "n" .. (i % 1000) }
+    kept[i % 512 + 1] = t
+end
+)";
+
+const double DELTA_TIME = 1.0 / 60.0;
+
+// runs the behaviour on count entities and returns the sum of the final positions
+double Run(const char *label, const char *source, size_t count, int frames)
+{
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<ScriptSystem>();
+    auto &scripts = registry->GetSystem<ScriptSystem>();
+    // all of the work every frame, this measures how long it takes
+    scripts.SetFrameBudget(1000.0);
+    scripts.LoadBehaviorFromSource("bounce", source);
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> anywhere(0.0f, 4000.0f);
+    std::uniform_real_distribution<float> speed(-100.0f, 100.0f);
+    for (size_t i = 0; i < count; i++)
+    {
+        Entity entity = registry->CreateEntity();
+        entity.AddComponent<TransformerComponent>(glm::vec2(anywhere(random), anywhere(random)), glm::vec2(1.0f), 0.0);
+        entity.AddComponent<RigidBodyComponent>(glm::vec2(speed(random), speed(random)));
+        entity.AddComponent<ScriptComponent>("bounce");
+    }
+    registry->Update();
+
+    double total = 0.0;
+    double worst = 0.0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        scripts.Update(DELTA_TIME);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        total += milliseconds;
+        worst = std::max(worst, milliseconds);
+    }
+    printf("%-10s %zu entities  %6.2f ms/frame (worst %6.2f)  %zu calls into Lua per frame\n",
+           label, count, total / frames, worst, scripts.GetLastCallCount());
+
+    double checksum = 0.0;
+    for (auto entity : scripts.GetEntities())
+    {
+        const auto &position = entity.GetComponent<TransformerComponent>().position;
+        checksum += position.x + position.y;
+    }
+    return checksum;
+}
+
+// frame times with far more script work than fits the budget
+void Overload(size_t count, int frames)
+{
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<ScriptSystem>();
+    auto &scripts = registry->GetSystem<ScriptSystem>();
+    scripts.LoadBehaviorFromSource("bounce", BATCHED);
+    scripts.LoadBehaviorFromSource("thinker", THINKER);
+    scripts.LoadBehaviorFromSource("stuck", STUCK);
+
+    // 20 thinkers, one stuck entity, the rest bounce
+    for (size_t i = 0; i < count; i++)
+    {
+        Entity entity = registry->CreateEntity();
+        entity.AddComponent<TransformerComponent>(glm::vec2(0.0f), glm::vec2(1.0f), 0.0);
+        entity.AddComponent<RigidBodyComponent>(glm::vec2(10.0f, 10.0f));
+        entity.AddComponent<ScriptComponent>(i < 20 ? "thinker" : (i == 20 ? "stuck" : "bounce"));
+    }
+    registry->Update();
+
+    double total = 0.0;
+    double worst = 0.0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        scripts.Update(DELTA_TIME);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        total += milliseconds;
+        worst = std::max(worst, milliseconds);
+    }
+    printf("overloaded %.1f ms budget  %6.2f ms/frame (worst %6.2f)\n",
+           scripts.GetFrameBudget(), total / frames, worst);
+    for (const auto &profile : scripts.GetProfiles())
+    {
+        printf("  %-8s %8.1f ms total  last frame %5.2f ms, %d resumes, %d preempted%s\n",
+               profile.name.c_str(), profile.totalMilliseconds, profile.milliseconds, profile.resumes,
+               profile.preemptions, scripts.IsBehind(profile.name) ? ", behind" : "");
+    }
+}
+
+// best of three runs of a script that allocates nothing but small tables
+// and strings
+double Churn(sol::state &lua)
+{
+    double best = 0.0;
+    for (int run = 0; run < 3; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        lua.script(CHURN);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = run == 0 ? milliseconds : std::min(best, milliseconds);
+    }
+    return best;
+}
+
+void Allocation(size_t count, int frames)
+{
+    sol::state plain;
+    plain.open_libraries(sol::lib::base);
+    double plainTime = Churn(plain);
+    ScriptAllocator allocator;
+    double pooledTime;
+    {
+        sol::state pooled(sol::default_at_panic, ScriptAllocator::Allocate, &allocator);
+        pooled.open_libraries(sol::lib::base);
+        pooledTime = Churn(pooled);
+    }
+    printf("2M small tables: realloc %6.1f ms, ScriptAllocator %6.1f ms (%zu KB of slabs)\n",
+           plainTime, pooledTime, allocator.GetSlabBytes() / 1024);
+
+    const char *labels[] = {"incremental", "generational", "gen. + slack"};
+    for (int mode = 0; mode < 3; mode++)
+    {
+        auto registry = std::make_unique<Registry>();
+        registry->AddSystem<ScriptSystem>();
+        auto &scripts = registry->GetSystem<ScriptSystem>();
+        ScriptCollectorProfile profile;
+        profile.generational = mode > 0;
+        profile.collectInSlack = mode == 2;
+        scripts.SetCollectorProfile(profile);
+        scripts.LoadBehaviorFromSource("litter", LITTERING);
+        for (size_t i = 0; i < count; i++)
+        {
+            Entity entity = registry->CreateEntity();
+            entity.AddComponent<TransformerComponent>(glm::vec2(0.0f), glm::vec2(1.0f), 0.0);
+            entity.AddComponent<ScriptComponent>("litter");
+        }
+        registry->Update();
+        scripts.FinishLoading();
+
+        std::vector<double> times;
+        double collectTotal = 0.0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            scripts.Update(DELTA_TIME);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            collectTotal += scripts.GetLastCollectTime();
+        }
+        double total = 0.0;
+        for (double milliseconds : times)
+        {
+            total += milliseconds;
+        }
+        std::sort(times.begin(), times.end());
+        printf("%-13s %5.2f ms/frame (99th %5.2f, worst %5.2f), %4.2f of it in the slack, peak %zu KB\n",
+               labels[mode], total / frames, times[times.size() * 99 / 100], times.back(), collectTotal / frames,
+               scripts.GetAllocator().GetPeakBytes() / 1024);
+    }
+}
+
+// the same AI work in one Lua state and spread over several, on the
+// JobSystem; returns nothing, prints whether every split ended the same
+void Parallel(size_t count, int frames)
+{
+    double first = 0.0;
+    bool same = true;
+    for (unsigned states : {1u, 2u, 4u})
+    {
+        auto registry = std::make_unique<Registry>();
+        registry->AddSystem<ScriptSystem>(states);
+        auto &scripts = registry->GetSystem<ScriptSystem>();
+        scripts.SetFrameBudget(1000.0);
+        scripts.LoadBehaviorFromSource("swarm", SWARM);
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> anywhere(0.0f, 4000.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            Entity entity = registry->CreateEntity();
+            entity.AddComponent<TransformerComponent>(glm::vec2(anywhere(random), anywhere(random)), glm::vec2(1.0f), 0.0);
+            entity.AddComponent<RigidBodyComponent>(glm::vec2(0.0f));
+            entity.AddComponent<ScriptComponent>("swarm");
+        }
+        registry->Update();
+
+        double total = 0.0;
+        double worst = 0.0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            scripts.Update(DELTA_TIME);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            total += milliseconds;
+            worst = std::max(worst, milliseconds);
+        }
+        double checksum = 0.0;
+        for (auto entity : scripts.GetEntities())
+        {
+            const auto &position = entity.GetComponent<TransformerComponent>().position;
+            checksum += position.x + position.y;
+        }
+        if (states == 1)
+        {
+            first = checksum;
+        }
+        same = same && checksum == first;
+        printf("%u Lua state%s %zu entities  %6.2f ms/frame (worst %6.2f)\n",
+               states, states == 1 ? " " : "s", count, total / frames, worst);
+    }
+    printf("%u worker threads, final positions %s\n", JobSystem::GetWorkerCount(), same ? "match" : "DIFFER");
+}
+
+// an AI-sized script, about 400 lines of functions, tables and closures
+std::string MakeScript(size_t seed)
+{
+    std::string source = "local ai = { name = \"unit" + std::to_string(seed) + "\" }\n";
+    for (int i = 0; i < 40; i++)
+    {
+        std::string n = std::to_string(i);
+        source += "function ai.state" + n + "(self, targets, dt)\n"
+                  "    local best, bestScore = nil, -math.huge\n"
+                  "    for _, target in ipairs(targets) do\n"
+                  "        local dx, dy = target.x - self.x, target.y - self.y\n"
+                  "        local score = " + std::to_string(seed % 7 + i) + " - math.sqrt(dx * dx + dy * dy) * dt\n"
+                  "        if target.kind == \"tank\" then score = score * 2 elseif target.kind == \"tree\" then score = score - 10 end\n"
+                  "        if score > bestScore then best, bestScore = target, score end\n"
+                  "    end\n"
+                  "    return best and function() return best, string.format(\"%s:%d\", self.name, " + n + ") end\n"
+                  "end\n";
+    }
+    return source + "return ai\n";
+}
+
+void LoadTimes(size_t count)
+{
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "bench_script_load";
+    fs::remove_all(root);
+    fs::create_directories(root / "scripts");
+    std::vector<std::string> paths;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        paths.push_back((root / "scripts" / ("unit" + std::to_string(i) + ".lua")).string());
+        std::string source = MakeScript(i);
+        bytes += source.size();
+        std::ofstream(paths.back(), std::ios::binary) << source;
+    }
+    printf("\n%zu scripts, %zu KB of source\n", count, bytes / 1024);
+
+    auto start = std::chrono::steady_clock::now();
+    std::string contents;
+    for (const auto &path : paths)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        contents.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(&contents[0], static_cast<std::streamsize>(contents.size()));
+    }
+    printf("%-20s %7.1f ms\n", "read only", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    auto timeLoads = [&](const char *label, ScriptLoader &loader)
+    {
+        sol::state lua;
+        auto begin = std::chrono::steady_clock::now();
+        for (const auto &path : paths)
+        {
+            sol::load_result chunk = loader.Load(lua, path);
+            if (!chunk.valid())
+            {
+                printf("%s failed to load\n", path.c_str());
+            }
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        printf("%-20s %7.1f ms  (%d compiled, %d from cache, %d from pack)\n",
+               label, milliseconds, loader.GetCompiledCount(), loader.GetCacheHitCount(), loader.GetPackHitCount());
+    };
+
+    ScriptLoader compiling;
+    timeLoads("compile every run", compiling);
+    ScriptLoader firstRun;
+    firstRun.SetCacheDirectory((root / "cache").string());
+    timeLoads("empty cache", firstRun);
+    ScriptLoader laterRun;
+    laterRun.SetCacheDirectory((root / "cache").string());
+    timeLoads("filled cache", laterRun);
+    ScriptLoader::WritePack(paths, (root / "scripts.pack").string());
+    ScriptLoader packed;
+    packed.OpenPack((root / "scripts.pack").string());
+    timeLoads("pack", packed);
+
+    fs::remove_all(root);
+}
+
+int main()
+{
+    const size_t count = 10000;
+    const int frames = 300;
+    double perEntity = Run("per entity", PER_ENTITY, count, frames);
+    double batched = Run("batched", BATCHED, count, frames);
+    printf("final positions %s\n", std::fabs(perEntity - batched) <= 1e-6 * std::fabs(perEntity) ? "match" : "DIFFER");
+
+    Overload(count, frames);
+    Allocation(count / 5, 1000);
+
+    printf("\n");
+    JobSystem::Initialize(3);
+    Parallel(count, frames);
+    JobSystem::Shutdown();
+
+    LoadTimes(300);
+    return 0;
+}
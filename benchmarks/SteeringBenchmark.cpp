@@ -0,0 +1,171 @@
+// crowd steering benchmark: 5k, 20k and 50k agents in two crowds walking
+// through each other, stepped at 60 Hz
+//
+//   make benchmarks && ./bench_steering [workers]
+//
+// reports the CrowdSteering::Solve time per frame and, at the start and end
+// of the run, how many agents overlap another one. the neighbour search is
+// also timed against checking every pair, on one frame of the 5k scene
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../src/Jobs/JobSystem.h"
+#include "../src/Physics/CrowdSteering.h"
+
+const float RADIUS = 8.0f;
+const float MAX_SPEED = 60.0f;
+const float DELTA_TIME = 1.0f / 60.0f;
+
+struct Agent
+{
+    glm::vec2 position;
+    glm::vec2 velocity;
+    glm::vec2 goal;
+};
+
+// left half walks right, right half walks left, both through the middle;
+// about four agents per 64x64 px cell
+std::vector<Agent> MakeCrowds(size_t count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    float height = std::sqrt(static_cast<float>(count)) * 32.0f;
+    float width = height;
+    std::uniform_real_distribution<float> across(0.0f, height);
+    std::uniform_real_distribution<float> side(0.0f, width * 0.5f);
+    std::vector<Agent> agents(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        bool left = i % 2 == 0;
+        float x = side(random) + (left ? 0.0f : width * 1.5f);
+        float y = across(random);
+        agents[i].position = glm::vec2(x, y);
+        agents[i].velocity = glm::vec2(0.0f);
+        agents[i].goal = glm::vec2(left ? x + width * 1.5f : x - width * 1.5f, y);
+    }
+    return agents;
+}
+
+// agents sunk more than a quarter into another one, checked against every other agent
+size_t CountOverlapping(const std::vector<Agent> &agents)
+{
+    size_t overlapping = 0;
+    for (size_t i = 0; i < agents.size(); i++)
+    {
+        for (size_t j = 0; j < agents.size(); j++)
+        {
+            if (i != j && glm::length(agents[i].position - agents[j].position) < 2.0f * RADIUS * 0.75f)
+            {
+                overlapping++;
+                break;
+            }
+        }
+    }
+    return overlapping;
+}
+
+void Fill(CrowdSteering &crowd, const std::vector<Agent> &agents)
+{
+    crowd.Clear();
+    for (const auto &agent : agents)
+    {
+        glm::vec2 toGoal = agent.goal - agent.position;
+        float distance = glm::length(toGoal);
+        glm::vec2 preferred = distance > 1.0f ? toGoal * (MAX_SPEED / distance) : glm::vec2(0.0f);
+        crowd.AddAgent(agent.position, agent.velocity, preferred, RADIUS, MAX_SPEED);
+    }
+}
+
+// k nearest by checking every other agent, what the steering would cost
+// without the spatial hash
+double NaiveNeighbours(const std::vector<Agent> &agents, float radius, int k)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> nearest;
+    long found = 0;
+    for (size_t i = 0; i < agents.size(); i++)
+    {
+        nearest.clear();
+        for (size_t j = 0; j < agents.size(); j++)
+        {
+            glm::vec2 offset = agents[j].position - agents[i].position;
+            float distance = glm::dot(offset, offset);
+            if (i != j && distance < radius * radius)
+            {
+                nearest.push_back(distance);
+            }
+        }
+        size_t keep = std::min(nearest.size(), static_cast<size_t>(k));
+        std::partial_sort(nearest.begin(), nearest.begin() + keep, nearest.end());
+        found += static_cast<long>(keep);
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("all pairs neighbour search, %zu agents: %.1f ms (%ld neighbours)\n", agents.size(), milliseconds, found);
+    return milliseconds;
+}
+
+int main(int argc, char *argv[])
+{
+    JobSystem::Initialize(argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 0);
+    printf("%u workers\n", JobSystem::GetWorkerCount());
+
+    const size_t counts[] = {5000, 20000, 50000};
+    const int frames = 300;
+    for (size_t count : counts)
+    {
+        std::vector<Agent> agents = MakeCrowds(count, 99);
+        CrowdSteering crowd;
+        crowd.SetNeighbourRadius(64.0f);
+        crowd.SetMaxNeighbours(8);
+        crowd.Reserve(count);
+
+        if (count == counts[0])
+        {
+            Fill(crowd, agents);
+            auto start = std::chrono::steady_clock::now();
+            crowd.Solve(DELTA_TIME);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            double naive = NaiveNeighbours(agents, 64.0f, 8);
+            printf("hashed steering, same frame: %.2f ms, %.0fx faster\n", milliseconds, naive / milliseconds);
+        }
+
+        size_t overlapBefore = 0;
+        double total = 0.0;
+        double worst = 0.0;
+        long neighbours = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            // Solve's scratch comes from the frame arena, as in the game
+            FrameArena::NewFrame();
+            Fill(crowd, agents);
+            auto start = std::chrono::steady_clock::now();
+            crowd.Solve(DELTA_TIME);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            total += milliseconds;
+            worst = std::max(worst, milliseconds);
+            for (size_t i = 0; i < agents.size(); i++)
+            {
+                agents[i].velocity = crowd.GetVelocity(static_cast<int>(i));
+                agents[i].position += agents[i].velocity * DELTA_TIME;
+                neighbours += crowd.GetNeighbourCount(static_cast<int>(i));
+            }
+            if (frame == 0 && count <= 20000)
+            {
+                overlapBefore = CountOverlapping(agents);
+            }
+        }
+        printf("%6zu agents  %7.2f ms/frame (worst %7.2f)  %.1f neighbours/agent",
+               count, total / frames, worst, static_cast<double>(neighbours) / (static_cast<double>(frames) * count));
+        if (count <= 20000)
+        {
+            printf("  overlapping agents %zu -> %zu", overlapBefore, CountOverlapping(agents));
+        }
+        printf("\n");
+    }
+    JobSystem::Shutdown();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef AUDIOCOMMANDQUEUE_H
+#define AUDIOCOMMANDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum AudioCommandType
+{
+    AUDIO_PLAY,
+    AUDIO_STOP,
+    AUDIO_LEVELS
+};
+
+// one change to a voice of the AudioMixer
+struct AudioCommand
+{
+    AudioCommandType type = AUDIO_STOP;
+    int voice = 0;
+    // AUDIO_PLAY: interleaved stereo frames in the mixer's format, where to
+    // start in them and whether to go round
+    const int16_t *samples = nullptr;
+    uint32_t frames = 0;
+    uint32_t offset = 0;
+    bool loop = false;
+    // AUDIO_PLAY and AUDIO_LEVELS: 0..1 per side
+    float left = 0.0f;
+    float right = 0.0f;
+};
+
+// Hands AudioCommands from one producer thread, the game, to one consumer
+// thread, the audio callback, without a lock. A fixed ring of CAPACITY
+// slots; the producer only moves the tail and the consumer only the head,
+// each published with a release store and read with an acquire load, so
+// neither ever waits for the other. Both indices sit on cache lines of
+// their own, and each side keeps a copy of the other's index to look at the
+// shared one only when the ring seems full or empty.
+class AudioCommandQueue
+{
+private:
+    static const size_t CAPACITY = 1024;
+    static const size_t MASK = CAPACITY - 1;
+    static_assert((CAPACITY & MASK) == 0, "the capacity must be a power of two");
+
+    AudioCommand slots[CAPACITY];
+    // consumer side
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+    // producer side
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+
+public:
+    // producer only; false if the ring is full
+    bool TryPush(const AudioCommand &command)
+    {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == CAPACITY)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == CAPACITY)
+            {
+                return false;
+            }
+        }
+        slots[position & MASK] = command;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only; false if the ring is empty
+    bool TryPop(AudioCommand &command)
+    {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail)
+            {
+                return false;
+            }
+        }
+        command = slots[position & MASK];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    static size_t GetCapacity() { return CAPACITY; }
+};
+
+#endif
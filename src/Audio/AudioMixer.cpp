@@ -0,0 +1,233 @@
+#include "AudioMixer.h"
+#include <algorithm>
+#include "MusicPlayer.h"
+
+namespace
+{
+    // adds run frames of a voice into the block at a ramping gain; no
+    // branches inside, so the loop vectorizes
+    void AddFrames(const int16_t *__restrict samples, float *__restrict block, size_t run,
+                   float left, float right, float leftStep, float rightStep)
+    {
+        for (size_t i = 0; i < run; i++)
+        {
+            float step = static_cast<float>(i);
+            block[2 * i] += samples[2 * i] * (left + leftStep * step);
+            block[2 * i + 1] += samples[2 * i + 1] * (right + rightStep * step);
+        }
+    }
+}
+
+AudioMixer::AudioMixer()
+    : frequency(44100), commandCount(0), playingCount(0)
+{
+}
+
+void AudioMixer::Send(const AudioCommand &command)
+{
+    if (command.voice < 0 || command.voice >= MAX_VOICES)
+    {
+        return;
+    }
+    // behind the ones already waiting, to keep the order
+    if (!pending.empty() || !queue.TryPush(command))
+    {
+        pending.push_back(command);
+    }
+}
+
+void AudioMixer::Play(int voice, const int16_t *samples, uint32_t frames, uint32_t offset, bool loop, float left, float right)
+{
+    AudioCommand command;
+    command.type = AUDIO_PLAY;
+    command.voice = voice;
+    command.samples = samples;
+    command.frames = frames;
+    command.offset = offset;
+    command.loop = loop;
+    command.left = left;
+    command.right = right;
+    Send(command);
+}
+
+void AudioMixer::Stop(int voice)
+{
+    AudioCommand command;
+    command.type = AUDIO_STOP;
+    command.voice = voice;
+    Send(command);
+}
+
+void AudioMixer::SetLevels(int voice, float left, float right)
+{
+    AudioCommand command;
+    command.type = AUDIO_LEVELS;
+    command.voice = voice;
+    command.left = left;
+    command.right = right;
+    Send(command);
+}
+
+void AudioMixer::Submit()
+{
+    size_t sent = 0;
+    while (sent < pending.size() && queue.TryPush(pending[sent]))
+    {
+        sent++;
+    }
+    pending.erase(pending.begin(), pending.begin() + sent);
+}
+
+void AudioMixer::Start(PlayingVoice &voice, const AudioCommand &command)
+{
+    voice.samples = command.samples;
+    voice.frames = command.frames;
+    voice.position = command.frames > 0 ? command.offset % command.frames : 0;
+    voice.loop = command.loop;
+    voice.active = command.samples && command.frames > 0;
+    voice.stopping = false;
+    voice.hasNext = false;
+    // faded in, it may start in the middle of the sound
+    voice.left = 0.0f;
+    voice.right = 0.0f;
+    voice.targetLeft = command.left;
+    voice.targetRight = command.right;
+}
+
+void AudioMixer::Apply(const AudioCommand &command)
+{
+    PlayingVoice &voice = voices[command.voice];
+    switch (command.type)
+    {
+    case AUDIO_PLAY:
+        if (voice.active && (voice.left != 0.0f || voice.right != 0.0f))
+        {
+            // cutting the old sound off mid-wave would click
+            voice.stopping = true;
+            voice.targetLeft = 0.0f;
+            voice.targetRight = 0.0f;
+            voice.next = command;
+            voice.hasNext = true;
+        }
+        else
+        {
+            Start(voice, command);
+        }
+        break;
+    case AUDIO_STOP:
+        voice.stopping = voice.active;
+        voice.hasNext = false;
+        voice.targetLeft = 0.0f;
+        voice.targetRight = 0.0f;
+        break;
+    case AUDIO_LEVELS:
+        if (voice.hasNext)
+        {
+            voice.next.left = command.left;
+            voice.next.right = command.right;
+        }
+        else if (!voice.stopping)
+        {
+            voice.targetLeft = command.left;
+            voice.targetRight = command.right;
+        }
+        break;
+    }
+}
+
+void AudioMixer::MixSpan(PlayingVoice &voice, float *block, size_t frames, float leftStep, float rightStep)
+{
+    float left = voice.left;
+    float right = voice.right;
+    size_t done = 0;
+    while (done < frames)
+    {
+        if (voice.position >= voice.frames)
+        {
+            if (!voice.loop)
+            {
+                voice.active = false;
+                return;
+            }
+            voice.position = 0;
+        }
+        size_t run = std::min(frames - done, static_cast<size_t>(voice.frames - voice.position));
+        AddFrames(voice.samples + 2 * static_cast<size_t>(voice.position), block + 2 * done, run,
+                  left, right, leftStep, rightStep);
+        left += leftStep * run;
+        right += rightStep * run;
+        voice.position += static_cast<uint32_t>(run);
+        done += run;
+    }
+}
+
+void AudioMixer::MixVoice(PlayingVoice &voice, float *block, size_t frames)
+{
+    // to the new levels over the first RAMP_FRAMES, then at them
+    const size_t ramp = std::min(frames, RAMP_FRAMES);
+    MixSpan(voice, block, ramp, (voice.targetLeft - voice.left) / ramp, (voice.targetRight - voice.right) / ramp);
+    voice.left = voice.targetLeft;
+    voice.right = voice.targetRight;
+    if (voice.stopping)
+    {
+        voice.active = false;
+        voice.stopping = false;
+        if (voice.hasNext)
+        {
+            // the stolen voice faded out, the new sound fades in from here
+            Start(voice, voice.next);
+            if (voice.active && ramp < frames)
+            {
+                MixVoice(voice, block + 2 * ramp, frames - ramp);
+            }
+            return;
+        }
+    }
+    if (voice.active && ramp < frames)
+    {
+        MixSpan(voice, block + 2 * ramp, frames - ramp, 0.0f, 0.0f);
+    }
+}
+
+void AudioMixer::Mix(int16_t *stream, size_t frames)
+{
+    // at most one ring full, so a flood of commands can't hold up the callback
+    AudioCommand command;
+    uint64_t applied = 0;
+    while (applied < AudioCommandQueue::GetCapacity() && queue.TryPop(command))
+    {
+        Apply(command);
+        applied++;
+    }
+    commandCount.fetch_add(applied, std::memory_order_relaxed);
+
+    float block[2 * BLOCK_FRAMES];
+    for (size_t first = 0; first < frames; first += BLOCK_FRAMES)
+    {
+        const size_t count = std::min(BLOCK_FRAMES, frames - first);
+        std::fill(block, block + 2 * count, 0.0f);
+        for (auto &voice : voices)
+        {
+            if (voice.active)
+            {
+                MixVoice(voice, block, count);
+            }
+        }
+        if (music)
+        {
+            music->Mix(block, count);
+        }
+        int16_t *out = stream + 2 * first;
+        for (size_t i = 0; i < 2 * count; i++)
+        {
+            out[i] = static_cast<int16_t>(std::min(std::max(block[i], -32768.0f), 32767.0f));
+        }
+    }
+
+    int playing = 0;
+    for (const auto &voice : voices)
+    {
+        playing += voice.active ? 1 : 0;
+    }
+    playingCount.store(playing, std::memory_order_relaxed);
+}
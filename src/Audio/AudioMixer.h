@@ -0,0 +1,102 @@
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AudioCommandQueue.h"
+
+class MusicPlayer;
+
+// Mixes up to MAX_VOICES sounds into the audio device's 16-bit stereo
+// stream, called from the audio callback, and is played from the game
+// thread without either ever waiting on the other.
+//
+// Play, Stop and SetLevels don't touch the voices; they go to the audio
+// thread as AudioCommands through a lock-free AudioCommandQueue, and Mix
+// takes them up at the start of the next callback, at most one ring full,
+// so the callback always does a bounded amount of work. The game thread
+// never takes the audio lock: commands that find the ring full wait on the
+// game thread and Submit, once a frame, sends them on in order. And as the
+// callback only ever needs what it already has, a long frame on the game
+// thread means late changes, not a gap in the sound.
+//
+// A voice plays interleaved stereo frames already in the device's format,
+// from any offset, once or round and round. Starts fade in, stops fade out
+// and level changes ramp over RAMP_FRAMES, so they don't click; a Play on a
+// voice still sounding, a steal, fades the old sound out first and starts
+// the new one where the fade ends. Music
+// streamed by a MusicPlayer is added in on top of the voices.
+class AudioMixer
+{
+public:
+    static constexpr int MAX_VOICES = 64;
+    // frames mixed at a time, in a stack buffer
+    static constexpr size_t BLOCK_FRAMES = 256;
+    // frames a start, stop or level change takes, about 1.5 ms
+    static constexpr size_t RAMP_FRAMES = 64;
+
+private:
+    // audio thread only
+    struct PlayingVoice
+    {
+        const int16_t *samples = nullptr;
+        uint32_t frames = 0;
+        uint32_t position = 0;
+        bool loop = false;
+        bool active = false;
+        bool stopping = false;
+        float left = 0.0f;
+        float right = 0.0f;
+        float targetLeft = 0.0f;
+        float targetRight = 0.0f;
+        // a Play waiting for the fade out of what the voice still plays
+        AudioCommand next;
+        bool hasNext = false;
+    };
+
+    AudioCommandQueue queue;
+    PlayingVoice voices[MAX_VOICES];
+    // game thread only, commands the ring had no room for yet
+    std::vector<AudioCommand> pending;
+    int frequency;
+    MusicPlayer *music = nullptr;
+    std::atomic<uint64_t> commandCount;
+    std::atomic<int> playingCount;
+
+    void Send(const AudioCommand &command);
+    void Apply(const AudioCommand &command);
+    static void Start(PlayingVoice &voice, const AudioCommand &command);
+    // adds one voice into the block and moves it on
+    void MixVoice(PlayingVoice &voice, float *block, size_t frames);
+    // frames of it with levels going up or down by a step a frame
+    void MixSpan(PlayingVoice &voice, float *block, size_t frames, float leftStep, float rightStep);
+
+public:
+    AudioMixer();
+
+    // frames per second of the device, to turn seconds into frames
+    void SetFrequency(int framesPerSecond) { frequency = framesPerSecond; }
+    int GetFrequency() const { return frequency; }
+    // mixed from the next callback on; before the mixer is hooked in
+    void SetMusic(MusicPlayer *player) { music = player; }
+
+    // game thread. samples are interleaved stereo frames that have to stay
+    // alive as long as the mixer may play them
+    void Play(int voice, const int16_t *samples, uint32_t frames, uint32_t offset, bool loop, float left, float right);
+    void Stop(int voice);
+    void SetLevels(int voice, float left, float right);
+    // sends on what didn't fit before; once a frame
+    void Submit();
+    size_t GetPendingCount() const { return pending.size(); }
+
+    // audio thread, fills the whole stream
+    void Mix(int16_t *stream, size_t frames);
+
+    // any thread, counted by the audio thread
+    uint64_t GetCommandCount() const { return commandCount.load(std::memory_order_relaxed); }
+    int GetPlayingCount() const { return playingCount.load(std::memory_order_relaxed); }
+};
+
+#endif
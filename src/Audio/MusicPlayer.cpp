@@ -0,0 +1,350 @@
+#include "MusicPlayer.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // how often the decoder tops up the rings while music plays, a small
+    // part of what a ring holds
+    const std::chrono::milliseconds FILL_INTERVAL(20);
+
+    // adds run frames into the block, the gain moving a step a frame
+    // towards the target; returns where the gain got to
+    float AddFaded(const int16_t *__restrict samples, float *__restrict block, size_t run,
+                   float gain, float target, float step, float volume)
+    {
+        if (gain == target)
+        {
+            const float level = gain * volume;
+            for (size_t i = 0; i < 2 * run; i++)
+            {
+                block[i] += samples[i] * level;
+            }
+            return gain;
+        }
+        for (size_t i = 0; i < run; i++)
+        {
+            gain = gain < target ? std::min(gain + step, target) : std::max(gain - step, target);
+            block[2 * i] += samples[2 * i] * gain * volume;
+            block[2 * i + 1] += samples[2 * i + 1] * gain * volume;
+        }
+        return gain;
+    }
+}
+
+MusicPlayer::MusicPlayer()
+{
+    decoded.resize(2 * CHUNK_FRAMES);
+}
+
+MusicPlayer::~MusicPlayer()
+{
+    Shutdown();
+}
+
+void MusicPlayer::Start(int framesPerSecond)
+{
+    if (decoder.joinable())
+    {
+        return;
+    }
+    frequency = framesPerSecond;
+    running = true;
+    decoder = std::thread(&MusicPlayer::DecoderLoop, this);
+}
+
+void MusicPlayer::Shutdown()
+{
+    if (!decoder.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    decoder.join();
+}
+
+void MusicPlayer::Play(const std::string &path, float fadeSeconds, bool loop)
+{
+    Request request;
+    request.play = true;
+    request.path = path;
+    request.fadeSeconds = fadeSeconds;
+    request.loop = loop;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(request);
+    }
+    wake.notify_one();
+}
+
+void MusicPlayer::Stop(float fadeSeconds)
+{
+    Request request;
+    request.fadeSeconds = fadeSeconds;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(request);
+    }
+    wake.notify_one();
+}
+
+std::vector<std::string> MusicPlayer::TakeErrors()
+{
+    std::vector<std::string> taken;
+    std::lock_guard<std::mutex> lock(mutex);
+    taken.swap(errors);
+    return taken;
+}
+
+int MusicPlayer::GetPlayingCount() const
+{
+    int playing = 0;
+    for (const auto &deck : decks)
+    {
+        playing += deck.state.load(std::memory_order_relaxed) == DECK_PLAYING ? 1 : 0;
+    }
+    return playing;
+}
+
+float MusicPlayer::FadeStep(float fadeSeconds) const
+{
+    return fadeSeconds > 0.0f ? 1.0f / (fadeSeconds * frequency) : 1.0f;
+}
+
+void MusicPlayer::DecoderLoop()
+{
+    std::vector<Request> taken;
+    bool busy = false;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto asked = [this]
+            { return !running || !requests.empty(); };
+            // idle, nothing to top up, until asked
+            if (busy)
+            {
+                wake.wait_for(lock, FILL_INTERVAL, asked);
+            }
+            else
+            {
+                wake.wait(lock, asked);
+            }
+            if (!running)
+            {
+                return;
+            }
+            taken.swap(requests);
+        }
+        for (const auto &request : taken)
+        {
+            Handle(request);
+        }
+        taken.clear();
+
+        busy = false;
+        for (auto &deck : decks)
+        {
+            if (deck.state.load(std::memory_order_acquire) == DECK_PLAYING)
+            {
+                if (!deck.ended.load(std::memory_order_relaxed))
+                {
+                    Fill(deck);
+                }
+                busy = true;
+            }
+            else if (deck.source.IsOpen())
+            {
+                // faded or played out, handed back by the audio thread
+                deck.source.Close();
+                deck.staged.clear();
+                busy = true;
+            }
+        }
+        if (hasWaiting)
+        {
+            StartWaiting();
+            busy = true;
+        }
+    }
+}
+
+void MusicPlayer::Handle(const Request &request)
+{
+    FadeOut(request.fadeSeconds);
+    // a newer track takes the place of one still waiting
+    waiting = request;
+    hasWaiting = request.play;
+}
+
+void MusicPlayer::FadeOut(float fadeSeconds)
+{
+    for (auto &deck : decks)
+    {
+        if (deck.state.load(std::memory_order_acquire) == DECK_PLAYING)
+        {
+            deck.fadeStep.store(FadeStep(fadeSeconds), std::memory_order_relaxed);
+            deck.targetGain.store(0.0f, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MusicPlayer::StartWaiting()
+{
+    Deck *free = nullptr;
+    for (auto &deck : decks)
+    {
+        if (!free && deck.state.load(std::memory_order_acquire) == DECK_FREE)
+        {
+            free = &deck;
+        }
+    }
+    if (!free)
+    {
+        // both still fading out
+        return false;
+    }
+    hasWaiting = false;
+    Deck &deck = *free;
+    std::string error;
+    if (!deck.source.Open(waiting.path, error))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        errors.push_back("Music " + waiting.path + " " + error);
+        return false;
+    }
+    deck.loop = waiting.loop;
+    deck.step = static_cast<double>(deck.source.GetFrequency()) / frequency;
+    deck.position = 1.0;
+    deck.staged.clear();
+    deck.stagedPosition = 0;
+    deck.ring.Reset();
+    deck.ended.store(false, std::memory_order_relaxed);
+    // a full ring before the audio thread gets the deck
+    Fill(deck);
+    deck.gain = 0.0f;
+    deck.fadeStep.store(FadeStep(waiting.fadeSeconds), std::memory_order_relaxed);
+    deck.targetGain.store(1.0f, std::memory_order_relaxed);
+    deck.state.store(DECK_PLAYING, std::memory_order_release);
+    return true;
+}
+
+bool MusicPlayer::Produce(Deck &deck)
+{
+    size_t count = deck.source.Read(decoded.data(), CHUNK_FRAMES);
+    while (count < CHUNK_FRAMES && deck.loop)
+    {
+        // round again in the same chunk, so the seam has no gap
+        deck.source.Rewind();
+        const size_t more = deck.source.Read(decoded.data() + 2 * count, CHUNK_FRAMES - count);
+        if (more == 0)
+        {
+            break;
+        }
+        count += more;
+    }
+    if (count == 0)
+    {
+        return false;
+    }
+    deck.staged.clear();
+    deck.stagedPosition = 0;
+    if (deck.step == 1.0)
+    {
+        deck.staged.assign(decoded.begin(), decoded.begin() + 2 * count);
+        return true;
+    }
+
+    // linear between source frames, counted from previous at 0 and the
+    // chunk from 1 on; previous carries over to the next chunk
+    double position = deck.position;
+    while (position < count)
+    {
+        const size_t index = static_cast<size_t>(position);
+        const float fraction = static_cast<float>(position - index);
+        const int16_t *a = index == 0 ? deck.previous : decoded.data() + 2 * (index - 1);
+        const int16_t *b = decoded.data() + 2 * index;
+        for (int side = 0; side < 2; side++)
+        {
+            deck.staged.push_back(static_cast<int16_t>(std::lround(a[side] + (b[side] - a[side]) * fraction)));
+        }
+        position += deck.step;
+    }
+    deck.position = position - count;
+    deck.previous[0] = decoded[2 * (count - 1)];
+    deck.previous[1] = decoded[2 * (count - 1) + 1];
+    return true;
+}
+
+bool MusicPlayer::Fill(Deck &deck)
+{
+    while (true)
+    {
+        if (deck.stagedPosition == deck.staged.size() && !Produce(deck))
+        {
+            deck.ended.store(true, std::memory_order_release);
+            return false;
+        }
+        int16_t *frames = nullptr;
+        const size_t room = deck.ring.GetWritable(frames);
+        if (room == 0)
+        {
+            return true;
+        }
+        const size_t count = std::min(room, (deck.staged.size() - deck.stagedPosition) / 2);
+        std::memcpy(frames, deck.staged.data() + deck.stagedPosition, count * 2 * sizeof(int16_t));
+        deck.ring.Commit(count);
+        deck.stagedPosition += 2 * count;
+    }
+}
+
+void MusicPlayer::Mix(float *block, size_t frames)
+{
+    const float level = volume.load(std::memory_order_relaxed);
+    for (auto &deck : decks)
+    {
+        if (deck.state.load(std::memory_order_acquire) != DECK_PLAYING)
+        {
+            continue;
+        }
+        const float target = deck.targetGain.load(std::memory_order_relaxed);
+        const float step = deck.fadeStep.load(std::memory_order_relaxed);
+        // before the ring, so an ended track's last frames are all seen
+        const bool ended = deck.ended.load(std::memory_order_acquire);
+        size_t done = 0;
+        while (done < frames)
+        {
+            const int16_t *samples = nullptr;
+            const size_t run = std::min(frames - done, deck.ring.GetReadable(samples));
+            if (run == 0)
+            {
+                break;
+            }
+            deck.gain = AddFaded(samples, block + 2 * done, run, deck.gain, target, step, level);
+            deck.ring.Consume(run);
+            done += run;
+        }
+        bool finished = target == 0.0f && deck.gain == 0.0f;
+        if (done < frames && !finished)
+        {
+            if (ended)
+            {
+                finished = true;
+            }
+            else
+            {
+                underrunCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (finished)
+        {
+            // back to the decoder
+            deck.state.store(DECK_FREE, std::memory_order_release);
+        }
+    }
+}
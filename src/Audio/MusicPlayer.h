@@ -0,0 +1,187 @@
+#ifndef MUSICPLAYER_H
+#define MUSICPLAYER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MusicSource.h"
+
+// Plays music tracks streamed from disk, decoded on a thread of its own
+// and mixed by the AudioMixer, so a track of any length costs the same
+// few hundred KB and the game thread never decodes.
+//
+// A track plays on one of two decks. The decoder thread reads its
+// MusicSource, converts it to the device's frequency and keeps the deck's
+// ring of RING_FRAMES 16-bit stereo frames topped up, about three quarters
+// of a second. The audio thread takes frames out of the ring as it mixes;
+// the ring is single producer, single consumer and lock-free like the
+// AudioCommandQueue, so neither thread waits for the other and a late
+// decoder is an underrun, counted, not a stall of the callback.
+//
+// A looping track rewinds as it reaches its end while the ring still plays
+// what came before, so the loop has no gap, and the resampler carries on
+// across the seam. Playing another track fades out what plays and fades the
+// new one in on the other deck at the same time, a crossfade. Deck
+// ownership passes between the threads with an atomic state: a FREE deck
+// belongs to the decoder, which readies it and hands it over as PLAYING;
+// the audio thread hands it back once it has faded out or played out.
+//
+// The game thread only asks, through a short lock the audio thread never
+// takes. Errors opening a track are kept for the game thread to log.
+class MusicPlayer
+{
+public:
+    // per deck, about 0.75 s at 44.1 kHz and 128 KB
+    static const size_t RING_FRAMES = 32768;
+    // frames decoded at a time
+    static const size_t CHUNK_FRAMES = 4096;
+    static const int DECK_COUNT = 2;
+
+private:
+    enum DeckState
+    {
+        DECK_FREE,
+        DECK_PLAYING
+    };
+
+    // interleaved stereo frames from the decoder thread to the audio thread
+    class PcmRing
+    {
+    private:
+        static const size_t MASK = RING_FRAMES - 1;
+        static_assert((RING_FRAMES & MASK) == 0, "the ring size must be a power of two");
+
+        std::vector<int16_t> samples;
+        // consumer side
+        alignas(64) std::atomic<size_t> head{0};
+        // producer side
+        alignas(64) std::atomic<size_t> tail{0};
+
+    public:
+        PcmRing() : samples(2 * RING_FRAMES) {}
+
+        // producer only, while the consumer keeps off
+        void Reset()
+        {
+            head.store(0, std::memory_order_relaxed);
+            tail.store(0, std::memory_order_relaxed);
+        }
+        // producer; how many frames fit from here on without wrapping
+        size_t GetWritable(int16_t *&frames)
+        {
+            const size_t position = tail.load(std::memory_order_relaxed);
+            const size_t free = RING_FRAMES - (position - head.load(std::memory_order_acquire));
+            frames = samples.data() + 2 * (position & MASK);
+            return std::min(free, RING_FRAMES - (position & MASK));
+        }
+        void Commit(size_t frames) { tail.store(tail.load(std::memory_order_relaxed) + frames, std::memory_order_release); }
+        // consumer; how many frames can be read from here on without wrapping
+        size_t GetReadable(const int16_t *&frames)
+        {
+            const size_t position = head.load(std::memory_order_relaxed);
+            const size_t used = tail.load(std::memory_order_acquire) - position;
+            frames = samples.data() + 2 * (position & MASK);
+            return std::min(used, RING_FRAMES - (position & MASK));
+        }
+        void Consume(size_t frames) { head.store(head.load(std::memory_order_relaxed) + frames, std::memory_order_release); }
+    };
+
+    struct Deck
+    {
+        PcmRing ring;
+        std::atomic<int> state{DECK_FREE};
+        // set by the decoder, followed by the audio thread a step a frame
+        std::atomic<float> targetGain{0.0f};
+        std::atomic<float> fadeStep{1.0f};
+        // the last frame is in the ring
+        std::atomic<bool> ended{false};
+        // audio thread only, while PLAYING
+        float gain = 0.0f;
+
+        // decoder thread only
+        MusicSource source;
+        bool loop = false;
+        // source frames per device frame, and where the next device frame
+        // falls between previous, the last source frame, and the next ones
+        double step = 1.0;
+        double position = 1.0;
+        int16_t previous[2] = {0, 0};
+        // converted frames not in the ring yet
+        std::vector<int16_t> staged;
+        size_t stagedPosition = 0;
+    };
+
+    struct Request
+    {
+        bool play = false;
+        std::string path;
+        float fadeSeconds = 0.0f;
+        bool loop = true;
+    };
+
+    Deck decks[DECK_COUNT];
+    int frequency = 44100;
+    std::atomic<float> volume{1.0f};
+    std::atomic<uint64_t> underrunCount{0};
+
+    // shared by the game and decoder threads
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Request> requests;
+    std::vector<std::string> errors;
+    bool running = false;
+    std::thread decoder;
+
+    // decoder thread only: a track waiting for a deck to free up, and what
+    // it decodes into
+    Request waiting;
+    bool hasWaiting = false;
+    std::vector<int16_t> decoded;
+
+    void DecoderLoop();
+    void Handle(const Request &request);
+    void FadeOut(float fadeSeconds);
+    bool StartWaiting();
+    // tops up the deck's ring; false once the track has no more frames
+    bool Fill(Deck &deck);
+    // the next chunk of the track into the deck's staged frames
+    bool Produce(Deck &deck);
+    float FadeStep(float fadeSeconds) const;
+
+public:
+    MusicPlayer();
+    ~MusicPlayer();
+
+    // game thread; starts the decoder thread for a device of this frequency
+    void Start(int framesPerSecond);
+    // stops the decoder thread, once the audio thread no longer mixes music
+    void Shutdown();
+    bool IsRunning() const { return decoder.joinable(); }
+
+    // game thread; fades out what plays while the track fades in. Opening
+    // happens on the decoder thread, see TakeErrors
+    void Play(const std::string &path, float fadeSeconds = 1.0f, bool loop = true);
+    void Stop(float fadeSeconds = 1.0f);
+    // 0..1 over every track
+    void SetVolume(float level) { volume.store(level, std::memory_order_relaxed); }
+    float GetVolume() const { return volume.load(std::memory_order_relaxed); }
+    // why tracks didn't play since the last call
+    std::vector<std::string> TakeErrors();
+
+    // audio thread, adds the music into a block of interleaved stereo frames
+    void Mix(float *block, size_t frames);
+
+    // any thread
+    int GetPlayingCount() const;
+    uint64_t GetUnderrunCount() const { return underrunCount.load(std::memory_order_relaxed); }
+    // sample memory of the decks, whatever the tracks
+    static size_t GetRingBytes() { return DECK_COUNT * 2 * RING_FRAMES * sizeof(int16_t); }
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include "MusicSource.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint16_t WAVE_FORMAT_PCM = 0x0001;
+    const uint16_t WAVE_FORMAT_IMA_ADPCM = 0x0011;
+    const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+    // PCM frames read at a time
+    const size_t PCM_CHUNK_FRAMES = 1024;
+
+    const int IMA_STEPS[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+        107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+        876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+        5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+        27086, 29794, 32767};
+    const int IMA_INDEX_CHANGES[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+    uint16_t U16(const uint8_t *bytes) { return static_cast<uint16_t>(bytes[0] | bytes[1] << 8); }
+    uint32_t U32(const uint8_t *bytes) { return static_cast<uint32_t>(U16(bytes)) | static_cast<uint32_t>(U16(bytes + 2)) << 16; }
+
+    // one 4-bit code onto the channel's predictor and step index
+    int16_t DecodeNibble(int nibble, int &predictor, int &index)
+    {
+        const int step = IMA_STEPS[index];
+        int difference = step >> 3;
+        difference += nibble & 1 ? step >> 2 : 0;
+        difference += nibble & 2 ? step >> 1 : 0;
+        difference += nibble & 4 ? step : 0;
+        predictor += nibble & 8 ? -difference : difference;
+        predictor = std::min(std::max(predictor, -32768), 32767);
+        index = std::min(std::max(index + IMA_INDEX_CHANGES[nibble & 7], 0), 88);
+        return static_cast<int16_t>(predictor);
+    }
+}
+
+bool MusicSource::Open(const std::string &path, std::string &error)
+{
+    Close();
+    file.open(path, std::ios::binary);
+    if (!file)
+    {
+        error = "can't be opened";
+        return false;
+    }
+    if (!ReadHeader(error))
+    {
+        Close();
+        return false;
+    }
+    Rewind();
+    return true;
+}
+
+void MusicSource::Close()
+{
+    if (file.is_open())
+    {
+        file.close();
+    }
+    file.clear();
+    frequency = 0;
+    frameCount = 0;
+    dataSize = 0;
+    dataRead = 0;
+    decodedFrames = 0;
+    decodedPosition = 0;
+}
+
+bool MusicSource::ReadHeader(std::string &error)
+{
+    uint8_t riff[12];
+    if (!file.read(reinterpret_cast<char *>(riff), sizeof(riff)) || std::memcmp(riff, "RIFF", 4) != 0 ||
+        std::memcmp(riff + 8, "WAVE", 4) != 0)
+    {
+        error = "is not a WAV file";
+        return false;
+    }
+    bool hasFormat = false;
+    uint16_t tag = 0;
+    size_t blockAlign = 0;
+    size_t samplesPerBlock = 0;
+    uint8_t chunk[8];
+    while (file.read(reinterpret_cast<char *>(chunk), sizeof(chunk)))
+    {
+        const uint32_t size = U32(chunk + 4);
+        if (std::memcmp(chunk, "fmt ", 4) == 0)
+        {
+            std::vector<uint8_t> format(std::max<size_t>(size, 16));
+            if (size < 16 || !file.read(reinterpret_cast<char *>(format.data()), size))
+            {
+                error = "has a broken format chunk";
+                return false;
+            }
+            tag = U16(&format[0]);
+            channels = U16(&format[2]);
+            frequency = static_cast<int>(U32(&format[4]));
+            blockAlign = U16(&format[12]);
+            bitsPerSample = U16(&format[14]);
+            if (tag == WAVE_FORMAT_EXTENSIBLE && size >= 26)
+            {
+                // the first two bytes of the sub format GUID are the format tag
+                tag = U16(&format[24]);
+            }
+            samplesPerBlock = tag == WAVE_FORMAT_IMA_ADPCM && size >= 20 ? U16(&format[18]) : 0;
+            hasFormat = true;
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            dataStart = file.tellg();
+            dataSize = size;
+            break;
+        }
+        else
+        {
+            // chunks are padded to an even size
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    if (!hasFormat || dataStart == 0)
+    {
+        error = "has no format or no data";
+        return false;
+    }
+    if (channels < 1 || channels > 2 || frequency <= 0)
+    {
+        error = "is not mono or stereo";
+        return false;
+    }
+
+    if (tag == WAVE_FORMAT_PCM && (bitsPerSample == 8 || bitsPerSample == 16))
+    {
+        encoding = ENCODING_PCM;
+        blockSize = static_cast<size_t>(channels * bitsPerSample / 8);
+        framesPerBlock = 1;
+        frameCount = dataSize / blockSize;
+        block.resize(PCM_CHUNK_FRAMES * blockSize);
+        return true;
+    }
+    if (tag == WAVE_FORMAT_IMA_ADPCM && bitsPerSample == 4 && blockAlign > static_cast<size_t>(4 * channels))
+    {
+        encoding = ENCODING_IMA_ADPCM;
+        blockSize = blockAlign;
+        // a header sample per channel, then 8 samples per 4 bytes of each channel
+        const size_t groups = (blockAlign - 4 * channels) / (4 * channels);
+        framesPerBlock = samplesPerBlock > 0 ? std::min(samplesPerBlock, 1 + 8 * groups) : 1 + 8 * groups;
+        frameCount = dataSize / blockSize * framesPerBlock;
+        block.resize(blockSize);
+        decoded.resize(2 * (1 + 8 * groups));
+        return true;
+    }
+    error = "is neither 8 or 16-bit PCM nor IMA ADPCM";
+    return false;
+}
+
+size_t MusicSource::ReadPcm(int16_t *out, size_t frames)
+{
+    size_t done = 0;
+    while (done < frames)
+    {
+        const size_t want = std::min(std::min(frames - done, PCM_CHUNK_FRAMES), (dataSize - dataRead) / blockSize);
+        if (want == 0 || !file.read(reinterpret_cast<char *>(block.data()), static_cast<std::streamsize>(want * blockSize)))
+        {
+            break;
+        }
+        dataRead += want * blockSize;
+        const int step = bitsPerSample / 8;
+        for (size_t i = 0; i < want; i++)
+        {
+            const uint8_t *frame = block.data() + i * blockSize;
+            for (int side = 0; side < 2; side++)
+            {
+                const uint8_t *sample = frame + (channels == 2 ? side * step : 0);
+                out[2 * (done + i) + side] = step == 2 ? static_cast<int16_t>(U16(sample)) : static_cast<int16_t>((sample[0] - 128) << 8);
+            }
+        }
+        done += want;
+    }
+    return done;
+}
+
+bool MusicSource::DecodeBlock()
+{
+    const size_t bytes = std::min(blockSize, dataSize - dataRead);
+    const size_t headerSize = static_cast<size_t>(4 * channels);
+    if (bytes <= headerSize || !file.read(reinterpret_cast<char *>(block.data()), static_cast<std::streamsize>(bytes)))
+    {
+        return false;
+    }
+    dataRead += bytes;
+
+    int predictors[2];
+    int indices[2];
+    for (int c = 0; c < channels; c++)
+    {
+        const uint8_t *header = block.data() + 4 * c;
+        predictors[c] = static_cast<int16_t>(U16(header));
+        indices[c] = std::min<int>(header[2], 88);
+        decoded[c] = static_cast<int16_t>(predictors[c]);
+    }
+    // the last block may be short
+    const size_t groups = (bytes - headerSize) / headerSize;
+    const uint8_t *data = block.data() + headerSize;
+    for (size_t group = 0; group < groups; group++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            // 4 bytes of the channel, 8 samples, the low nibble first
+            const uint8_t *codes = data + (group * channels + c) * 4;
+            for (int b = 0; b < 4; b++)
+            {
+                const size_t frame = 1 + group * 8 + b * 2;
+                decoded[2 * frame + c] = DecodeNibble(codes[b] & 0x0F, predictors[c], indices[c]);
+                decoded[2 * (frame + 1) + c] = DecodeNibble(codes[b] >> 4, predictors[c], indices[c]);
+            }
+        }
+    }
+    decodedFrames = std::min(1 + groups * 8, framesPerBlock);
+    if (channels == 1)
+    {
+        for (size_t frame = 0; frame < decodedFrames; frame++)
+        {
+            decoded[2 * frame + 1] = decoded[2 * frame];
+        }
+    }
+    decodedPosition = 0;
+    return true;
+}
+
+size_t MusicSource::Read(int16_t *out, size_t frames)
+{
+    if (!file.is_open())
+    {
+        return 0;
+    }
+    if (encoding == ENCODING_PCM)
+    {
+        return ReadPcm(out, frames);
+    }
+    size_t done = 0;
+    while (done < frames)
+    {
+        if (decodedPosition == decodedFrames && !DecodeBlock())
+        {
+            break;
+        }
+        const size_t count = std::min(frames - done, decodedFrames - decodedPosition);
+        std::memcpy(out + 2 * done, decoded.data() + 2 * decodedPosition, count * 2 * sizeof(int16_t));
+        decodedPosition += count;
+        done += count;
+    }
+    return done;
+}
+
+void MusicSource::Rewind()
+{
+    file.clear();
+    file.seekg(dataStart);
+    dataRead = 0;
+    decodedFrames = 0;
+    decodedPosition = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef MUSICSOURCE_H
+#define MUSICSOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Reads a music file piece by piece, never holding more of it than one
+// block, for the MusicPlayer's decoder thread.
+//
+// Files are WAV, mono or stereo, either 8 or 16-bit PCM or IMA ADPCM, which
+// stores 4 bits a sample, a quarter of 16-bit PCM, and decodes a block of a
+// few hundred frames at a time with a handful of adds and shifts a sample.
+// Whatever the file has comes out as 16-bit stereo at the file's frequency.
+class MusicSource
+{
+private:
+    enum Encoding
+    {
+        ENCODING_PCM,
+        ENCODING_IMA_ADPCM
+    };
+
+    std::ifstream file;
+    Encoding encoding = ENCODING_PCM;
+    int channels = 0;
+    int bitsPerSample = 0;
+    int frequency = 0;
+    // bytes per block, a PCM frame or an ADPCM block
+    size_t blockSize = 0;
+    size_t framesPerBlock = 0;
+    std::streamoff dataStart = 0;
+    size_t dataSize = 0;
+    size_t dataRead = 0;
+    uint64_t frameCount = 0;
+
+    std::vector<uint8_t> block;
+    // the current ADPCM block, decoded to stereo, and how far it is read
+    std::vector<int16_t> decoded;
+    size_t decodedFrames = 0;
+    size_t decodedPosition = 0;
+
+    bool ReadHeader(std::string &error);
+    size_t ReadPcm(int16_t *out, size_t frames);
+    bool DecodeBlock();
+
+public:
+    // logs nothing, the reason goes to error
+    bool Open(const std::string &path, std::string &error);
+    void Close();
+    bool IsOpen() const { return file.is_open(); }
+
+    int GetFrequency() const { return frequency; }
+    uint64_t GetFrameCount() const { return frameCount; }
+
+    // up to frames frames as interleaved 16-bit stereo, mono on both sides;
+    // fewer only at the end of the file
+    size_t Read(int16_t *out, size_t frames);
+    // back to the first frame
+    void Rewind();
+};
+
+#endif
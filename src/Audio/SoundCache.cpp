@@ -0,0 +1,83 @@
+#include "SoundCache.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <SDL2/SDL.h>
+#include "../Logger/Logger.h"
+
+SoundId SoundCache::Load(const std::string &name, const std::string &path)
+{
+    SoundId existing = Find(name);
+    if (existing != NO_SOUND)
+    {
+        return existing;
+    }
+
+    SDL_AudioSpec spec;
+    Uint8 *buffer = nullptr;
+    Uint32 length = 0;
+    if (!SDL_LoadWAV(path.c_str(), &spec, &buffer, &length))
+    {
+        Logger::Err("Sound " + path + " did not load: " + SDL_GetError());
+        return NO_SOUND;
+    }
+    SDL_AudioCVT conversion;
+    if (SDL_BuildAudioCVT(&conversion, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, 2, frequency) < 0)
+    {
+        SDL_FreeWAV(buffer);
+        Logger::Err("Sound " + path + " can't be converted: " + SDL_GetError());
+        return NO_SOUND;
+    }
+    // converted in place, in a buffer with room for what it may grow to
+    std::vector<Uint8> converted(static_cast<size_t>(length) * std::max(conversion.len_mult, 1));
+    std::memcpy(converted.data(), buffer, length);
+    SDL_FreeWAV(buffer);
+    size_t bytes = length;
+    if (conversion.needed)
+    {
+        conversion.buf = converted.data();
+        conversion.len = static_cast<int>(length);
+        if (SDL_ConvertAudio(&conversion) != 0)
+        {
+            Logger::Err("Sound " + path + " can't be converted: " + SDL_GetError());
+            return NO_SOUND;
+        }
+        bytes = static_cast<size_t>(conversion.len_cvt);
+    }
+
+    auto sound = std::make_unique<SoundData>();
+    sound->name = name;
+    sound->frames = static_cast<uint32_t>(bytes / (2 * sizeof(int16_t)));
+    sound->samples.resize(2 * static_cast<size_t>(sound->frames));
+    std::memcpy(sound->samples.data(), converted.data(), sound->samples.size() * sizeof(int16_t));
+    sound->seconds = static_cast<float>(sound->frames) / frequency;
+    byteCount += sound->samples.size() * sizeof(int16_t);
+
+    const SoundId id = static_cast<SoundId>(sounds.size());
+    ids[name] = id;
+    LOGGER_INFO(LOG_AUDIO, "Loaded sound " + name + ": " + std::to_string(sound->seconds) + " s, " +
+                               std::to_string(spec.freq) + " -> " + std::to_string(frequency) + " Hz, " +
+                               std::to_string(sound->samples.size() * sizeof(int16_t) / 1024) + " KB");
+    sounds.push_back(std::move(sound));
+    return id;
+}
+
+int SoundCache::LoadDirectory(const std::string &directory)
+{
+    int loaded = 0;
+    std::error_code error;
+    for (const auto &file : std::filesystem::directory_iterator(directory, error))
+    {
+        if (file.path().extension() == ".wav" && Load(file.path().stem().string(), file.path().string()) != NO_SOUND)
+        {
+            loaded++;
+        }
+    }
+    return loaded;
+}
+
+SoundId SoundCache::Find(const std::string &name) const
+{
+    auto found = ids.find(name);
+    return found != ids.end() ? found->second : NO_SOUND;
+}
@@ -0,0 +1,60 @@
+#ifndef SOUNDCACHE_H
+#define SOUNDCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// index of a sound in its SoundCache
+typedef int SoundId;
+const SoundId NO_SOUND = -1;
+
+// a sound ready for the AudioMixer, shared by everything that plays it
+struct SoundData
+{
+    std::string name;
+    // interleaved 16-bit stereo frames at the cache's frequency
+    std::vector<int16_t> samples;
+    uint32_t frames = 0;
+    float seconds = 0.0f;
+};
+
+// Holds every sound the game plays, decoded and converted once, when it is
+// loaded, into what the mixer plays: 16-bit stereo at the device's
+// frequency, whatever the file had. Playing a sound then costs no decoding,
+// resampling or lookup by name: a sound is known by its SoundId, an index,
+// and every voice playing it reads the same samples.
+//
+// Sounds are named, by default after their file without the extension, and
+// a name is loaded once; loading it again gives back the same id. Sounds
+// stay until the cache goes, so the mixer can hold on to their samples.
+class SoundCache
+{
+private:
+    int frequency = 44100;
+    // stable addresses, the mixer plays straight from the samples
+    std::vector<std::unique_ptr<SoundData>> sounds;
+    std::unordered_map<std::string, SoundId> ids;
+    size_t byteCount = 0;
+
+public:
+    // frames per second the sounds are converted to; before loading any
+    void SetFrequency(int framesPerSecond) { frequency = framesPerSecond; }
+    int GetFrequency() const { return frequency; }
+
+    // a WAV file; logs why and returns NO_SOUND if it can't be loaded
+    SoundId Load(const std::string &name, const std::string &path);
+    // every *.wav in the directory, named after the file; returns how many loaded
+    int LoadDirectory(const std::string &directory);
+
+    SoundId Find(const std::string &name) const;
+    const SoundData &Get(SoundId id) const { return *sounds[id]; }
+    size_t GetCount() const { return sounds.size(); }
+    // sample memory of all the sounds
+    size_t GetByteCount() const { return byteCount; }
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "VoiceAllocator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // quieter than this counts as not heard at all
+    const float MIN_GAIN = 0.002f;
+    // how much louder an emitter on a voice counts for keeping it
+    const float HOLD_BONUS = 1.5f;
+
+    // distance gain and pan of every emitter in [0, count), each on its own
+    // and without branches, so the loop vectorizes
+    void Attenuate(const float *__restrict inX, const float *__restrict inY,
+                   const float *__restrict inVolumes, const float *__restrict inMin, const float *__restrict inMax,
+                   float *__restrict outGains, float *__restrict outPans, size_t count,
+                   float listenerX, float listenerY, float inverseHalfWidth)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            float dx = inX[i] - listenerX;
+            float dy = inY[i] - listenerY;
+            float distance = std::sqrt(dx * dx + dy * dy);
+            // 1 up to the min distance, falling off as a square to 0 at the max
+            float range = std::max(inMax[i] - inMin[i], 1.0f);
+            float fade = std::min(std::max((inMax[i] - distance) / range, 0.0f), 1.0f);
+            outGains[i] = inVolumes[i] * fade * fade;
+            outPans[i] = std::min(std::max(dx * inverseHalfWidth, -1.0f), 1.0f);
+        }
+    }
+}
+
+VoiceAllocator::VoiceAllocator()
+    : audibleCount(0), realCount(0), startCount(0)
+{
+    SetVoiceCount(DEFAULT_VOICES);
+}
+
+void VoiceAllocator::SetVoiceCount(int count)
+{
+    voices.resize(static_cast<size_t>(std::max(count, 0)));
+    busy.resize(voices.size(), 0);
+}
+
+void VoiceAllocator::Clear()
+{
+    positionX.clear();
+    positionY.clear();
+    volumes.clear();
+    minDistances.clear();
+    maxDistances.clear();
+    priorities.clear();
+    heldVoices.clear();
+}
+
+void VoiceAllocator::Reserve(size_t emitters)
+{
+    positionX.reserve(emitters);
+    positionY.reserve(emitters);
+    volumes.reserve(emitters);
+    minDistances.reserve(emitters);
+    maxDistances.reserve(emitters);
+    priorities.reserve(emitters);
+    heldVoices.reserve(emitters);
+    candidates.reserve(emitters);
+}
+
+int VoiceAllocator::AddEmitter(glm::vec2 position, float volume, int priority, float minDistance, float maxDistance, int heldVoice)
+{
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    volumes.push_back(volume);
+    minDistances.push_back(minDistance);
+    maxDistances.push_back(maxDistance);
+    priorities.push_back(priority);
+    heldVoices.push_back(heldVoice >= 0 && heldVoice < GetVoiceCount() ? heldVoice : -1);
+    return static_cast<int>(positionX.size()) - 1;
+}
+
+void VoiceAllocator::Allocate(glm::vec2 listener, float halfWidth)
+{
+    const size_t count = positionX.size();
+    gains.resize(count);
+    pans.resize(count);
+    assignedVoices.assign(count, -1);
+    Attenuate(positionX.data(), positionY.data(), volumes.data(), minDistances.data(), maxDistances.data(),
+              gains.data(), pans.data(), count, listener.x, listener.y, 1.0f / std::max(halfWidth, 1.0f));
+
+    // the audible ones, the most important first
+    candidates.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (gains[i] > MIN_GAIN)
+        {
+            candidates.push_back(static_cast<int>(i));
+        }
+    }
+    audibleCount = candidates.size();
+    const size_t voiceCount = voices.size();
+    if (candidates.size() > voiceCount)
+    {
+        auto score = [this](int emitter)
+        { return heldVoices[emitter] >= 0 ? gains[emitter] * HOLD_BONUS : gains[emitter]; };
+        std::nth_element(candidates.begin(), candidates.begin() + voiceCount, candidates.end(), [&](int a, int b)
+                         {
+                             if (priorities[a] != priorities[b])
+                             {
+                                 return priorities[a] > priorities[b];
+                             }
+                             float scoreA = score(a);
+                             float scoreB = score(b);
+                             return scoreA != scoreB ? scoreA > scoreB : a < b;
+                         });
+        candidates.resize(voiceCount);
+    }
+    realCount = candidates.size();
+
+    // the chosen keep the voice they have, the others wait for a free one
+    for (auto &voice : voices)
+    {
+        voice = Voice();
+    }
+    waiting.clear();
+    for (int emitter : candidates)
+    {
+        int held = heldVoices[emitter];
+        if (held >= 0 && voices[held].emitter < 0)
+        {
+            voices[held].emitter = emitter;
+            assignedVoices[emitter] = held;
+        }
+        else
+        {
+            waiting.push_back(emitter);
+        }
+    }
+    // waiting ones in emitter order, so the same scene comes out the same
+    std::sort(waiting.begin(), waiting.end());
+    startCount = 0;
+    size_t next = 0;
+    for (size_t v = 0; v < voiceCount; v++)
+    {
+        Voice &voice = voices[v];
+        if (voice.emitter < 0 && next < waiting.size())
+        {
+            voice.emitter = waiting[next++];
+            voice.start = true;
+            assignedVoices[voice.emitter] = static_cast<int>(v);
+            startCount++;
+        }
+        // stopped when the one that played on it is gone or gives way
+        voice.stop = busy[v] && (voice.emitter < 0 || voice.start);
+        busy[v] = voice.emitter >= 0;
+        if (voice.emitter >= 0)
+        {
+            // full on both sides in the middle, fading out one side toward the other
+            float gain = gains[voice.emitter];
+            float pan = pans[voice.emitter];
+            voice.left = gain * std::min(1.0f, 1.0f - pan);
+            voice.right = gain * std::min(1.0f, 1.0f + pan);
+        }
+    }
+}
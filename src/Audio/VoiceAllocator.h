@@ -0,0 +1,90 @@
+#ifndef VOICEALLOCATOR_H
+#define VOICEALLOCATOR_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// what a real voice does this frame
+struct Voice
+{
+    // emitter index playing on it, -1 when silent
+    int emitter = -1;
+    // what played on it last frame has to be stopped
+    bool stop = false;
+    // the emitter is new on it and has to be started
+    bool start = false;
+    // 0..1 per side, distance attenuation and panning together
+    float left = 0.0f;
+    float right = 0.0f;
+};
+
+// Decides which of any number of sound emitters get one of a fixed number
+// of real voices, so the mixer never mixes more than that many sounds
+// however many are around. The rest are virtual: nobody hears them, but
+// their owner keeps their time, and they take a voice when they come to
+// matter.
+//
+// Emitters are added every frame as they are, with the voice they got last
+// frame. Allocate() works out the distance gain and the pan of all of them
+// in one branch-free pass over flat arrays, then picks the most important
+// audible ones with nth_element, higher priority first and louder first
+// within a priority, which is O(n) however many voices there are. An
+// emitter already on a voice counts as somewhat louder than it is, so two
+// of about the same loudness don't keep taking the voice from each other.
+// Chosen emitters keep their voice; the others take the voices freed.
+class VoiceAllocator
+{
+private:
+    // per emitter
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> volumes;
+    std::vector<float> minDistances;
+    std::vector<float> maxDistances;
+    std::vector<int> priorities;
+    std::vector<int> heldVoices;
+    std::vector<float> gains;
+    std::vector<float> pans;
+    std::vector<int> assignedVoices;
+
+    std::vector<int> candidates;
+    std::vector<int> waiting;
+    std::vector<Voice> voices;
+    // whether a voice played anything last frame
+    std::vector<char> busy;
+    size_t audibleCount;
+    size_t realCount;
+    size_t startCount;
+
+public:
+    static const int DEFAULT_VOICES = 16;
+
+    VoiceAllocator();
+
+    // voices from the count up are dropped at once, without a stop
+    void SetVoiceCount(int count);
+    int GetVoiceCount() const { return static_cast<int>(voices.size()); }
+
+    void Clear();
+    void Reserve(size_t emitters);
+    // heldVoice is the voice it got last frame, -1 if none. returns the
+    // emitter index, which is simply the insertion index
+    int AddEmitter(glm::vec2 position, float volume, int priority, float minDistance, float maxDistance, int heldVoice);
+    size_t GetEmitterCount() const { return positionX.size(); }
+
+    // the listener stands at the centre, sounds are panned fully to one
+    // side at halfWidth pixels to that side of it
+    void Allocate(glm::vec2 listener, float halfWidth);
+
+    const Voice &GetVoice(int voice) const { return voices[voice]; }
+    // of the last Allocate, per emitter: its voice or -1, and its gain
+    int GetAssignedVoice(int emitter) const { return assignedVoices[emitter]; }
+    float GetGain(int emitter) const { return gains[emitter]; }
+    // emitters that could be heard, those that are, and those that started
+    size_t GetAudibleCount() const { return audibleCount; }
+    size_t GetRealCount() const { return realCount; }
+    size_t GetStartCount() const { return startCount; }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef BOXCOLLIDERCOMPONENT_H
+#define BOXCOLLIDERCOMPONENT_H
+
+#include <glm/glm.hpp>
+
+// collision box in unscaled sprite pixels, relative to the transform position
+struct BoxColliderComponent
+{
+    int width = 0;
+    int height = 0;
+    glm::vec2 offset = glm::vec2(0.0);
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PATHCOMPONENT_H
+#define PATHCOMPONENT_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../Pathfinding/PathService.h"
+
+// a unit's walking order. set goal and repath = true; the PathfindingSystem
+// queues the request and fills in status and tiles when the answer arrives
+struct PathComponent
+{
+    glm::ivec2 goal = glm::ivec2(0);
+    int priority = 0;
+    bool repath = false;
+    PathStatus status = PATH_NONE;
+    // shared with every unit that asked for the same start and goal
+    std::shared_ptr<const std::vector<glm::ivec2>> tiles;
+    // waypoint the unit is heading for
+    size_t nextTile = 0;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef PROJECTILECOMPONENT_H
+#define PROJECTILECOMPONENT_H
+
+// marks fast movers (bullets) that are swept along their path every frame
+// instead of being tested where they end up, see ProjectileSystem
+struct ProjectileComponent
+{
+    // entity that fired it, never hit by its own projectile (-1 = nobody)
+    int shooterId = -1;
+    bool destroyOnHit = true;
+};
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef RIGIDBODYCOMPONENT_H
+#define RIGIDBODYCOMPONENT_H
+
+#include <glm/glm.hpp>
+
+// pixels per second
+struct RigidBodyComponent
+{
+    glm::vec2 velocity = glm::vec2(0.0);
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef SCRIPTCOMPONENT_H
+#define SCRIPTCOMPONENT_H
+
+#include <string>
+
+// runs a Lua behaviour on the entity every frame, see ScriptSystem
+struct ScriptComponent
+{
+    // name of the behaviour, the script file name without .lua
+    std::string behavior;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SOUNDEMITTERCOMPONENT_H
+#define SOUNDEMITTERCOMPONENT_H
+
+#include <string>
+#include "../Audio/SoundCache.h"
+
+// a sound the entity gives off where it stands, see AudioSystem
+struct SoundEmitterComponent
+{
+    // name the sound was loaded under, see SoundCache
+    std::string sound;
+    // 0..1, before distance
+    float volume = 1.0f;
+    // a higher priority gets a voice before a lower one, however loud
+    int priority = 0;
+    // pixels from the camera centre: full volume up to the first, silent from the second
+    float minDistance = 100.0f;
+    float maxDistance = 1500.0f;
+    bool loop = true;
+    // set false when a sound that doesn't loop has played out
+    bool playing = true;
+
+    // kept by the AudioSystem: the sound's id, looked up by name once,
+    // seconds played, real or virtual, and the voice it plays on, -1 while
+    // virtual
+    SoundId soundId = NO_SOUND;
+    float elapsed = 0.0f;
+    int voice = -1;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef STEERINGCOMPONENT_H
+#define STEERINGCOMPONENT_H
+
+// a unit that keeps its distance from the others while it walks, see SteeringSystem
+struct SteeringComponent
+{
+    // pixels, how much room the unit takes up
+    float radius = 12.0f;
+    // pixels per second
+    float maxSpeed = 80.0f;
+};
+
+#endif
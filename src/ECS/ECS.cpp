@@ -1,3 +1,151 @@
 #include "ECS.h"
+#include <algorithm>
+#include <string>
+#include "../Logger/Logger.h"
 
-// TODO implement all the functions of ECS
+int IComponent::nextId = 0;
+
+int Entity::GetId() const
+{
+    return id;
+}
+
+void Entity::Kill()
+{
+    registry->KillEntity(*this);
+}
+
+void System::AddEntityToSystem(Entity entity)
+{
+    entities.push_back(entity);
+}
+
+void System::RemoveEntityFromSystem(Entity entity)
+{
+    entities.erase(std::remove_if(entities.begin(), entities.end(), [&entity](Entity other)
+                                  { return entity == other; }),
+                   entities.end());
+}
+
+const std::vector<Entity> &System::GetEntities() const
+{
+    return entities;
+}
+
+const Signature &System::GetComponentSignature() const
+{
+    return componentSignature;
+}
+
+Entity Registry::CreateEntity()
+{
+    int entityId;
+    if (freeIds.empty())
+    {
+        entityId = numEntities++;
+        if (entityId >= static_cast<int>(entityComponentSignatures.size()))
+        {
+            entityComponentSignatures.resize(entityId + 1);
+        }
+    }
+    else
+    {
+        entityId = freeIds.front();
+        freeIds.pop_front();
+    }
+
+    Entity entity(entityId);
+    entity.registry = this;
+    entitiesToBeAdded.push_back(entity);
+
+    LOGGER_RECORD(LOG_TRACE, LOG_ECS, "Entity created with id = {}", entityId);
+    return entity;
+}
+
+void Registry::ReserveEntities(size_t count)
+{
+    entityComponentSignatures.reserve(static_cast<size_t>(numEntities) + count);
+}
+
+std::vector<Entity> Registry::CreateEntities(size_t count)
+{
+    std::vector<Entity> entities;
+    entities.reserve(count);
+    while (entities.size() < count && !freeIds.empty())
+    {
+        entities.emplace_back(freeIds.front());
+        freeIds.pop_front();
+    }
+    const size_t minted = count - entities.size();
+    const size_t needed = static_cast<size_t>(numEntities) + minted;
+    if (needed > entityComponentSignatures.size())
+    {
+        entityComponentSignatures.resize(needed);
+    }
+    for (size_t i = 0; i < minted; i++)
+    {
+        entities.emplace_back(numEntities++);
+    }
+
+    for (auto &entity : entities)
+    {
+        entity.registry = this;
+    }
+    entitiesToBeAdded.insert(entitiesToBeAdded.end(), entities.begin(), entities.end());
+    LOGGER_RECORD(LOG_TRACE, LOG_ECS, "{} entities created", count);
+    return entities;
+}
+
+void Registry::KillEntity(Entity entity)
+{
+    entitiesToBeKilled.insert(entity);
+}
+
+void Registry::AddEntityToSystems(Entity entity)
+{
+    const auto entityId = entity.GetId();
+    const auto &entityComponentSignature = entityComponentSignatures[entityId];
+
+    for (auto &system : systems)
+    {
+        const auto &systemComponentSignature = system.second->GetComponentSignature();
+        bool isInterested = (entityComponentSignature & systemComponentSignature) == systemComponentSignature;
+        if (isInterested)
+        {
+            system.second->AddEntityToSystem(entity);
+        }
+    }
+}
+
+void Registry::RemoveEntityFromSystems(Entity entity)
+{
+    for (auto &system : systems)
+    {
+        system.second->RemoveEntityFromSystem(entity);
+    }
+}
+
+void Registry::Update()
+{
+    for (auto entity : entitiesToBeAdded)
+    {
+        AddEntityToSystems(entity);
+    }
+    entitiesToBeAdded.clear();
+
+    for (auto entity : entitiesToBeKilled)
+    {
+        RemoveEntityFromSystems(entity);
+        entityComponentSignatures[entity.GetId()].reset();
+        for (auto &pool : componentPools)
+        {
+            if (pool)
+            {
+                pool->RemoveEntityFromPool(entity.GetId());
+            }
+        }
+        freeIds.push_back(entity.GetId());
+        LOGGER_RECORD(LOG_TRACE, LOG_ECS, "Entity killed with id = {}", entity.GetId());
+    }
+    entitiesToBeKilled.clear();
+}
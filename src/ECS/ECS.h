@@ -1,20 +1,367 @@
 #ifndef ECS_H
 #define ECS_H
 
-class Component
+#include <bitset>
+#include <deque>
+#include <memory>
+#include <set>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include "../Memory/ObjectPool.h"
+
+const unsigned int MAX_COMPONENTS = 32;
+
+// one bit per component type: which components an entity has, or which
+// components a system is interested in
+typedef std::bitset<MAX_COMPONENTS> Signature;
+
+struct IComponent
 {
+protected:
+    static int nextId;
+};
+
+// hands out a unique id per component type
+template <typename T>
+class Component : public IComponent
+{
+public:
+    static int GetId()
+    {
+        static auto id = nextId++;
+        return id;
+    }
 };
 
 class Entity
 {
+private:
+    int id;
+
+public:
+    Entity(int id) : id(id){};
+    Entity(const Entity &entity) = default;
+    Entity &operator=(const Entity &other) = default;
+    int GetId() const;
+    void Kill();
+
+    bool operator==(const Entity &other) const { return id == other.id; }
+    bool operator!=(const Entity &other) const { return id != other.id; }
+    bool operator<(const Entity &other) const { return id < other.id; }
+    bool operator>(const Entity &other) const { return id > other.id; }
+
+    template <typename TComponent, typename... TArgs>
+    void AddComponent(TArgs &&...args);
+    template <typename TComponent>
+    void RemoveComponent();
+    template <typename TComponent>
+    bool HasComponent() const;
+    template <typename TComponent>
+    TComponent &GetComponent() const;
+
+    // the registry that created this entity
+    class Registry *registry = nullptr;
 };
 
+// a system processes every entity whose signature contains its required components
 class System
 {
+private:
+    Signature componentSignature;
+    std::vector<Entity> entities;
+
+public:
+    System() = default;
+    virtual ~System() = default;
+
+    // virtual so systems that keep per-entity state can follow along
+    virtual void AddEntityToSystem(Entity entity);
+    virtual void RemoveEntityFromSystem(Entity entity);
+    const std::vector<Entity> &GetEntities() const;
+    const Signature &GetComponentSignature() const;
+
+    template <typename TComponent>
+    void RequireComponent();
 };
 
+class IPool
+{
+public:
+    virtual ~IPool() = default;
+    virtual void RemoveEntityFromPool(int entityId) = 0;
+};
+
+// Storage for one component type, indexed by entity id. The components
+// themselves live in an ObjectPool, so adding and removing them never goes
+// through the general heap and components created together stay together.
+template <typename T>
+class Pool : public IPool
+{
+private:
+    ObjectPool<T> storage;
+    std::vector<T *> data;
+
+public:
+    Pool(int capacity = 100) { data.resize(capacity, nullptr); }
+    virtual ~Pool() { Clear(); }
+
+    bool IsEmpty() const { return storage.LiveCount() == 0; }
+    int GetSize() const { return static_cast<int>(data.size()); }
+    void Resize(int n) { data.resize(n, nullptr); }
+    // room for count more components without growing the storage
+    void Reserve(size_t count) { storage.Reserve(storage.LiveCount() + count); }
+
+    void Clear()
+    {
+        for (T *component : data)
+        {
+            storage.Delete(component);
+        }
+        data.clear();
+    }
+
+    void Set(int entityId, T object)
+    {
+        if (data[entityId])
+        {
+            *data[entityId] = std::move(object);
+        }
+        else
+        {
+            data[entityId] = storage.New(std::move(object));
+        }
+    }
+
+    void Remove(int entityId)
+    {
+        storage.Delete(data[entityId]);
+        data[entityId] = nullptr;
+    }
+
+    void RemoveEntityFromPool(int entityId) override
+    {
+        if (entityId < GetSize() && data[entityId])
+        {
+            Remove(entityId);
+        }
+    }
+
+    T &Get(int entityId) { return *data[entityId]; }
+};
+
+// creates and destroys entities, owns the component pools and the systems
 class Registry
 {
+private:
+    int numEntities = 0;
+
+    // componentPools[componentId] stores every component of that type
+    std::vector<std::shared_ptr<IPool>> componentPools;
+    // entityComponentSignatures[entityId] says which components an entity has
+    std::vector<Signature> entityComponentSignatures;
+    std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
+
+    // entities are only handed to the systems (or taken away) in Update(),
+    // never in the middle of a frame
+    // a new id can't come up twice before Update, so a vector does for the
+    // added; an entity may be killed twice, so the killed stay a set
+    std::vector<Entity> entitiesToBeAdded;
+    std::set<Entity> entitiesToBeKilled;
+    // ids of killed entities, reused before new ones are minted
+    std::deque<int> freeIds;
+
+    template <typename TComponent>
+    Pool<TComponent> &GetPool();
+
+public:
+    Registry() = default;
+
+    void Update();
+
+    Entity CreateEntity();
+    void KillEntity(Entity entity);
+
+    // for loading many entities at once: reserve room for all of them first,
+    // then create them together and add each component type to all of them
+    // in one go, instead of one create and one add per component and entity
+    void ReserveEntities(size_t count);
+    template <typename TComponent>
+    void ReserveComponents(size_t count);
+    std::vector<Entity> CreateEntities(size_t count);
+    // entities[i] gets make(i)
+    template <typename TComponent, typename TMake>
+    void AddComponents(const std::vector<Entity> &entities, TMake make);
+
+    template <typename TComponent, typename... TArgs>
+    void AddComponent(Entity entity, TArgs &&...args);
+    template <typename TComponent>
+    void RemoveComponent(Entity entity);
+    template <typename TComponent>
+    bool HasComponent(Entity entity) const;
+    template <typename TComponent>
+    TComponent &GetComponent(Entity entity) const;
+
+    template <typename TSystem, typename... TArgs>
+    void AddSystem(TArgs &&...args);
+    template <typename TSystem>
+    void RemoveSystem();
+    template <typename TSystem>
+    bool HasSystem() const;
+    template <typename TSystem>
+    TSystem &GetSystem() const;
+
+    // adds or removes the entity from every system whose signature it matches
+    void AddEntityToSystems(Entity entity);
+    void RemoveEntityFromSystems(Entity entity);
 };
 
+template <typename TComponent>
+void System::RequireComponent()
+{
+    const auto componentId = Component<TComponent>::GetId();
+    componentSignature.set(componentId);
+}
+
+// the pool of the component type, made on first use
+template <typename TComponent>
+Pool<TComponent> &Registry::GetPool()
+{
+    const auto componentId = Component<TComponent>::GetId();
+    if (componentId >= static_cast<int>(componentPools.size()))
+    {
+        componentPools.resize(componentId + 1, nullptr);
+    }
+    if (!componentPools[componentId])
+    {
+        componentPools[componentId] = std::make_shared<Pool<TComponent>>();
+    }
+    return *static_cast<Pool<TComponent> *>(componentPools[componentId].get());
+}
+
+template <typename TComponent>
+void Registry::ReserveComponents(size_t count)
+{
+    GetPool<TComponent>().Reserve(count);
+}
+
+template <typename TComponent, typename TMake>
+void Registry::AddComponents(const std::vector<Entity> &entities, TMake make)
+{
+    const auto componentId = Component<TComponent>::GetId();
+    Pool<TComponent> &componentPool = GetPool<TComponent>();
+    if (componentPool.GetSize() < numEntities)
+    {
+        componentPool.Resize(numEntities);
+    }
+    componentPool.Reserve(entities.size());
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        const auto entityId = entities[i].GetId();
+        componentPool.Set(entityId, make(i));
+        entityComponentSignatures[entityId].set(componentId);
+    }
+}
+
+template <typename TComponent, typename... TArgs>
+void Registry::AddComponent(Entity entity, TArgs &&...args)
+{
+    const auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
+
+    Pool<TComponent> &componentPool = GetPool<TComponent>();
+    if (entityId >= componentPool.GetSize())
+    {
+        componentPool.Resize(numEntities);
+    }
+
+    TComponent newComponent{std::forward<TArgs>(args)...};
+    componentPool.Set(entityId, std::move(newComponent));
+    entityComponentSignatures[entityId].set(componentId);
+}
+
+template <typename TComponent>
+void Registry::RemoveComponent(Entity entity)
+{
+    const auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
+    if (HasComponent<TComponent>(entity))
+    {
+        std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId])->Remove(entityId);
+    }
+    entityComponentSignatures[entityId].set(componentId, false);
+}
+
+template <typename TComponent>
+bool Registry::HasComponent(Entity entity) const
+{
+    const auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
+    return entityComponentSignatures[entityId].test(componentId);
+}
+
+template <typename TComponent>
+TComponent &Registry::GetComponent(Entity entity) const
+{
+    const auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
+    // raw pointer: no shared_ptr refcount traffic on the hottest call in the ECS
+    auto componentPool = static_cast<Pool<TComponent> *>(componentPools[componentId].get());
+    return componentPool->Get(entityId);
+}
+
+template <typename TSystem, typename... TArgs>
+void Registry::AddSystem(TArgs &&...args)
+{
+    std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
+    systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
+}
+
+template <typename TSystem>
+void Registry::RemoveSystem()
+{
+    auto system = systems.find(std::type_index(typeid(TSystem)));
+    if (system != systems.end())
+    {
+        systems.erase(system);
+    }
+}
+
+template <typename TSystem>
+bool Registry::HasSystem() const
+{
+    return systems.find(std::type_index(typeid(TSystem))) != systems.end();
+}
+
+template <typename TSystem>
+TSystem &Registry::GetSystem() const
+{
+    auto system = systems.find(std::type_index(typeid(TSystem)));
+    return *(std::static_pointer_cast<TSystem>(system->second));
+}
+
+template <typename TComponent, typename... TArgs>
+void Entity::AddComponent(TArgs &&...args)
+{
+    registry->AddComponent<TComponent>(*this, std::forward<TArgs>(args)...);
+}
+
+template <typename TComponent>
+void Entity::RemoveComponent()
+{
+    registry->RemoveComponent<TComponent>(*this);
+}
+
+template <typename TComponent>
+bool Entity::HasComponent() const
+{
+    return registry->HasComponent<TComponent>(*this);
+}
+
+template <typename TComponent>
+TComponent &Entity::GetComponent() const
+{
+    return registry->GetComponent<TComponent>(*this);
+}
+
 #endif
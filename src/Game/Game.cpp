@@ -2,12 +2,27 @@
 #include <iostream>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
 #include <glm/glm.hpp>
 #include "../Logger/Logger.h"
+#include "../Memory/FrameArena.h"
+#include "../Memory/AllocationCounter.h"
+#include "../Systems/CollisionSystem.h"
+#include "../Systems/ProjectileSystem.h"
+#include "../Systems/PathfindingSystem.h"
+#include "../Systems/SteeringSystem.h"
+#include "../Systems/MovementSystem.h"
+#include "../Systems/ScriptSystem.h"
+#include "../Systems/AudioSystem.h"
+#include "../Jobs/JobSystem.h"
+#include "../Level/LevelLoader.h"
 
 Game::Game()
 {
     isRunning = false;
+    heapAllocationsAtFrameStart = 0;
+    heapAllocationsLastFrame = 0;
+    registry = std::make_unique<Registry>();
     Logger::Log("Game constructor is called!");
 }
 
@@ -48,6 +63,14 @@ void Game::Initialize()
         return;
     }
     SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
+    // the world is drawn unscrolled for now
+    camera = {0, 0, windowWidth, windowHeight};
+    // the game runs on without sound if there is no audio device
+    if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, 1024) != 0)
+    {
+        Logger::Err(std::string("Error in opening audio: ") + Mix_GetError());
+    }
+    JobSystem::Initialize();
     isRunning = true;
 }
 
@@ -58,6 +81,42 @@ void Game::Setup()
 {
     playerPosition = glm::vec2(10.0, 20.0);
     playerVelocity = glm::vec2(10.0, 0.0);
+
+    registry->AddSystem<CollisionSystem>();
+    registry->AddSystem<ProjectileSystem>();
+    registry->AddSystem<PathfindingSystem>(pathService);
+    registry->AddSystem<SteeringSystem>();
+    registry->AddSystem<MovementSystem>();
+    // one Lua state per JobSystem thread, all running at once
+    registry->AddSystem<ScriptSystem>(0u);
+    registry->AddSystem<AudioSystem>();
+    // every sound decoded and converted for the mixer once, here
+    registry->GetSystem<AudioSystem>().GetSounds().LoadDirectory("./assets/sounds");
+
+    // the level's objects join the systems with the first registry update;
+    // level files are packed and cached like scripts
+    LevelLoader levels;
+    levels.GetLoader().OpenPack("./assets/scripts.pack");
+    levels.GetLoader().SetCacheDirectory("./cache/scripts");
+    Level level;
+    if (levels.Load("./assets/levels/jungle.lua", *registry, level))
+    {
+        terrain.LoadFromFile(level.map, TileProperties::Jungle(), level.tileSize);
+        if (!level.music.empty())
+        {
+            // streamed, decoded on the music thread as it plays
+            registry->GetSystem<AudioSystem>().GetMusic().Play(level.music, 2.0f, true);
+        }
+    }
+    registry->GetSystem<CollisionSystem>().SetTerrain(&terrain);
+    pathfinder.Build(terrain);
+    pathService.SetPathfinder(&pathfinder);
+    // scripts come from the bytecode pack (make scriptpack) when it is there
+    // and up to date, else from the cache, and are only compiled when changed
+    auto &scripts = registry->GetSystem<ScriptSystem>();
+    scripts.GetLoader().OpenPack("./assets/scripts.pack");
+    scripts.GetLoader().SetCacheDirectory("./cache/scripts");
+    scripts.LoadBehaviors("./assets/scripts");
     millisecsPreviousFrame = SDL_GetTicks();
 }
 
@@ -78,13 +137,39 @@ void Game::Update()
     // update player locations etc.
     playerPosition.x += playerVelocity.x * deltaTime;
     playerPosition.y += playerVelocity.y * deltaTime;
+
+    // entities created or killed during the last frame take effect here
+    registry->Update();
+
+    // scripts run first, so what they order is acted on this frame
+    registry->GetSystem<ScriptSystem>().Update(deltaTime);
+
+    // paths in, velocities out of the steering, then everything moves
+    registry->GetSystem<PathfindingSystem>().Update(terrain);
+    registry->GetSystem<SteeringSystem>().Update(deltaTime, terrain);
+    registry->GetSystem<MovementSystem>().Update(deltaTime);
+
+    registry->GetSystem<CollisionSystem>().Update();
+    registry->GetSystem<ProjectileSystem>().Update(deltaTime, registry->GetSystem<CollisionSystem>());
+
+    // heard where everything ended up
+    registry->GetSystem<AudioSystem>().Update(deltaTime, camera);
 }
 
 void Game::Run()
 {
     Setup();
+    heapAllocationsAtFrameStart = AllocationCounter::Total();
     while (isRunning)
     {
+        // everything allocated from the frame arenas last frame is dead now
+        FrameArena::NewFrame();
+        uint64_t heapAllocations = AllocationCounter::Total();
+        heapAllocationsLastFrame = heapAllocations - heapAllocationsAtFrameStart;
+        heapAllocationsAtFrameStart = heapAllocations;
+        LOGGER_RECORD(LOG_TRACE, LOG_MEMORY, "Heap allocations last frame: {}, frame arena high-water mark: {} bytes",
+                      heapAllocationsLastFrame, FrameArena::ForThread().HighWaterMark());
+
         ProcessInput();
         Update(); // <-- delay implementation
         Render();
@@ -132,7 +217,15 @@ void Game::Render()
 }
 void Game::Destroy()
 {
-    SDL_DestroyWindow(window);
+    // the systems go first: the AudioSystem unhooks from the mixer and stops
+    // the music thread, and nothing hands the workers new jobs
+    registry.reset();
+    // finishes the queued jobs, path searches among them, before SDL goes
+    JobSystem::Shutdown();
+    Mix_CloseAudio();
     SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
     SDL_Quit();
+    // flush whatever is still staged for the binary log
+    Logger::CloseBinarySink();
 }
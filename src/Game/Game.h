@@ -2,6 +2,12 @@
 #ifndef GAME_H
 #define GAME_H
 #include <SDL2/SDL.h>
+#include <cstdint>
+#include <memory>
+#include "../ECS/ECS.h"
+#include "../Terrain/TerrainMap.h"
+#include "../Pathfinding/GridPathfinder.h"
+#include "../Pathfinding/PathService.h"
 
 const int FPS = 60;
 const int MILLISECS_PER_FRAME = 1000 / FPS;
@@ -14,6 +20,18 @@ private:
     int millisecsPreviousFrame;
     SDL_Window *window;
     SDL_Renderer *renderer;
+    // part of the world on screen; sounds are heard from its centre
+    SDL_Rect camera;
+    // heap allocation instrumentation, see Game::Run
+    uint64_t heapAllocationsAtFrameStart;
+    uint64_t heapAllocationsLastFrame;
+
+    std::unique_ptr<Registry> registry;
+    // collision view of the level's tile map
+    TerrainMap terrain;
+    GridPathfinder pathfinder;
+    // unit path requests, answered by the workers over the next frames
+    PathService pathService;
 
 public:
     Game();
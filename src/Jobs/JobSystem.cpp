@@ -0,0 +1,165 @@
+#include "JobSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsAvailable;
+    bool stopping = false;
+
+    void WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(jobsMutex);
+                jobsAvailable.wait(lock, []
+                                   { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    // one ParallelFor call. helpers that only get scheduled after the caller
+    // returned still hold a reference, so the batch lives in a shared_ptr
+    struct Batch
+    {
+        std::function<void(size_t, size_t)> body;
+        size_t count;
+        size_t chunkSize;
+        size_t chunks;
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> doneChunks{0};
+        std::mutex doneMutex;
+        std::condition_variable done;
+
+        void RunChunks()
+        {
+            size_t chunk;
+            while ((chunk = nextChunk.fetch_add(1)) < chunks)
+            {
+                size_t begin = chunk * chunkSize;
+                size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+                body(begin, end);
+                if (doneChunks.fetch_add(1) + 1 == chunks)
+                {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    done.notify_all();
+                }
+            }
+        }
+    };
+}
+
+void JobSystem::Initialize(unsigned workerCount)
+{
+    if (!workers.empty())
+    {
+        return;
+    }
+    if (workerCount == 0)
+    {
+        unsigned cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 1;
+    }
+    stopping = false;
+    for (unsigned i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(WorkerLoop);
+    }
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsAvailable.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+unsigned JobSystem::GetWorkerCount()
+{
+    return static_cast<unsigned>(workers.size());
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push_back(std::move(job));
+    }
+    jobsAvailable.notify_one();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (grain == 0)
+    {
+        grain = 1;
+    }
+    // a few chunks per thread so uneven chunks even out
+    size_t threads = workers.size() + 1;
+    size_t chunkSize = (count + threads * 4 - 1) / (threads * 4);
+    if (chunkSize < grain)
+    {
+        chunkSize = grain;
+    }
+    size_t chunks = (count + chunkSize - 1) / chunkSize;
+    if (workers.empty() || chunks == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->body = body;
+    batch->count = count;
+    batch->chunkSize = chunkSize;
+    batch->chunks = chunks;
+
+    size_t helpers = chunks - 1 < workers.size() ? chunks - 1 : workers.size();
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        for (size_t i = 0; i < helpers; i++)
+        {
+            jobs.push_back([batch]
+                           { batch->RunChunks(); });
+        }
+    }
+    jobsAvailable.notify_all();
+
+    batch->RunChunks();
+    std::unique_lock<std::mutex> lock(batch->doneMutex);
+    batch->done.wait(lock, [&]
+                     { return batch->doneChunks.load() == batch->chunks; });
+}
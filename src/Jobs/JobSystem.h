@@ -0,0 +1,27 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <cstddef>
+#include <functional>
+
+// Fixed pool of worker threads shared by the engine. Game::Initialize starts
+// it and Game::Destroy stops it; until then everything simply runs on the
+// calling thread, so code using it also works in tools and benchmarks.
+class JobSystem
+{
+public:
+    // workers = 0 picks one thread per core, minus the main thread
+    static void Initialize(unsigned workers = 0);
+    static void Shutdown();
+    static unsigned GetWorkerCount();
+
+    // queues a fire-and-forget job for the workers (runs inline without workers)
+    static void Submit(std::function<void()> job);
+
+    // splits [0, count) into chunks of at least grain items and runs
+    // body(begin, end) on them, on the workers and the calling thread.
+    // returns once every chunk is done
+    static void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body);
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "LevelLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "../Components/TransformerComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/PathComponent.h"
+#include "../Components/SteeringComponent.h"
+#include "../Components/ScriptComponent.h"
+#include "../Components/SoundEmitterComponent.h"
+#include "../Logger/Logger.h"
+
+namespace
+{
+    struct Archetype
+    {
+        std::string name;
+        bool hasCollider = false;
+        BoxColliderComponent collider;
+        bool hasBody = false;
+        bool hasPath = false;
+        // where every object of the archetype is sent, in pixels
+        bool hasGoal = false;
+        glm::vec2 goal = glm::vec2(0.0f);
+        bool hasSteering = false;
+        SteeringComponent steering;
+        std::string script;
+        std::string sound;
+        // x, y pairs
+        std::vector<float> positions;
+
+        size_t Count() const { return positions.size() / 2; }
+    };
+
+    bool ReadArchetype(const sol::table &description, Archetype &archetype, std::string &error)
+    {
+        sol::object collider = description["collider"];
+        if (collider.valid())
+        {
+            sol::optional<sol::table> box = collider.as<sol::optional<sol::table>>();
+            sol::optional<int> width = box ? (*box)[1] : sol::optional<int>();
+            sol::optional<int> height = box ? (*box)[2] : sol::optional<int>();
+            if (!width || !height)
+            {
+                error = "collider must be { width, height [, offset x, offset y] }";
+                return false;
+            }
+            archetype.hasCollider = true;
+            archetype.collider.width = *width;
+            archetype.collider.height = *height;
+            archetype.collider.offset = glm::vec2((*box)[3].get_or(0.0f), (*box)[4].get_or(0.0f));
+        }
+        archetype.hasBody = description["body"].get_or(false);
+        archetype.hasPath = description["path"].get_or(false);
+        sol::object goal = description["goal"];
+        if (goal.valid())
+        {
+            sol::optional<sol::table> point = goal.as<sol::optional<sol::table>>();
+            sol::optional<float> x = point ? (*point)[1] : sol::optional<float>();
+            sol::optional<float> y = point ? (*point)[2] : sol::optional<float>();
+            if (!x || !y)
+            {
+                error = "goal must be { x, y } in pixels";
+                return false;
+            }
+            archetype.hasPath = true;
+            archetype.hasGoal = true;
+            archetype.goal = glm::vec2(*x, *y);
+        }
+        sol::object steering = description["steering"];
+        if (steering.valid())
+        {
+            if (!steering.is<sol::table>())
+            {
+                error = "steering must be { radius = ..., speed = ... }";
+                return false;
+            }
+            sol::table settings = steering.as<sol::table>();
+            archetype.hasSteering = true;
+            archetype.steering.radius = settings["radius"].get_or(archetype.steering.radius);
+            archetype.steering.maxSpeed = settings["speed"].get_or(archetype.steering.maxSpeed);
+        }
+        archetype.script = description["script"].get_or(std::string());
+        if (archetype.hasSteering && !archetype.script.empty())
+        {
+            // both would write the body's velocity every frame
+            error = "steering and script both move the unit, give it one of them";
+            return false;
+        }
+        archetype.sound = description["sound"].get_or(std::string());
+        return true;
+    }
+
+    // the x, y pairs of the table on top of the stack
+    bool ReadPositions(lua_State *state, std::vector<float> &positions, std::string &error)
+    {
+        const lua_Integer length = static_cast<lua_Integer>(lua_rawlen(state, -1));
+        if (length % 2 != 0)
+        {
+            error = "has an x without its y";
+            return false;
+        }
+        positions.resize(static_cast<size_t>(length));
+        for (lua_Integer i = 1; i <= length; i++)
+        {
+            lua_rawgeti(state, -1, i);
+            int isNumber = 0;
+            lua_Number value = lua_tonumberx(state, -1, &isNumber);
+            lua_pop(state, 1);
+            if (!isNumber)
+            {
+                error = "entry " + std::to_string(i) + " is not a number";
+                return false;
+            }
+            positions[static_cast<size_t>(i - 1)] = static_cast<float>(value);
+        }
+        return true;
+    }
+}
+
+bool LevelLoader::Load(const std::string &path, Registry &registry, Level &level)
+{
+    auto start = std::chrono::steady_clock::now();
+    sol::state lua;
+    lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::table, sol::lib::string);
+    sol::load_result chunk = loader.Load(lua, path);
+    if (!chunk.valid())
+    {
+        sol::error error = chunk;
+        Logger::Err("Level " + path + " does not compile: " + error.what());
+        return false;
+    }
+    sol::protected_function_result result = chunk();
+    if (!result.valid() || result.get_type() != sol::type::table)
+    {
+        std::string reason = result.valid() ? "it does not return a table" : result.get<sol::error>().what();
+        Logger::Err("Level " + path + " did not load: " + reason);
+        return false;
+    }
+    sol::table description = result;
+
+    // first everything is read and checked, so a broken level creates nothing
+    std::vector<Archetype> archetypes;
+    sol::optional<sol::table> archetypeTable = description["archetypes"];
+    if (archetypeTable)
+    {
+        for (const auto &entry : *archetypeTable)
+        {
+            Archetype archetype;
+            std::string error;
+            if (!entry.first.is<std::string>() || !entry.second.is<sol::table>())
+            {
+                Logger::Err("Level " + path + ": archetypes must be a table of named tables");
+                return false;
+            }
+            archetype.name = entry.first.as<std::string>();
+            if (!ReadArchetype(entry.second.as<sol::table>(), archetype, error))
+            {
+                Logger::Err("Level " + path + ": archetype " + archetype.name + ": " + error);
+                return false;
+            }
+            archetypes.push_back(std::move(archetype));
+        }
+    }
+    // by name, so ids come out the same every run whatever order Lua's hash has
+    std::sort(archetypes.begin(), archetypes.end(), [](const Archetype &a, const Archetype &b)
+              { return a.name < b.name; });
+
+    sol::optional<sol::table> objectTable = description["objects"];
+    if (objectTable)
+    {
+        lua_State *state = lua.lua_state();
+        objectTable->push();
+        lua_pushnil(state);
+        while (lua_next(state, -2))
+        {
+            std::string name = lua_type(state, -2) == LUA_TSTRING ? lua_tostring(state, -2) : "";
+            auto archetype = std::find_if(archetypes.begin(), archetypes.end(), [&](const Archetype &candidate)
+                                          { return candidate.name == name; });
+            std::string error;
+            if (archetype == archetypes.end())
+            {
+                error = "is not an archetype";
+            }
+            else if (!lua_istable(state, -1))
+            {
+                error = "must be a table of x, y pairs";
+            }
+            else
+            {
+                ReadPositions(state, archetype->positions, error);
+            }
+            if (!error.empty())
+            {
+                lua_settop(state, 0);
+                Logger::Err("Level " + path + ": objects." + name + " " + error);
+                return false;
+            }
+            lua_pop(state, 1);
+        }
+        lua_pop(state, 1);
+    }
+
+    level = Level();
+    level.map = description["map"].get_or(std::string());
+    level.tileSize = description["tile_size"].get_or(level.tileSize);
+    level.music = description["music"].get_or(std::string());
+
+    // counted, now storage for all of them at once and one archetype at a time
+    size_t colliders = 0;
+    size_t bodies = 0;
+    size_t paths = 0;
+    size_t steering = 0;
+    size_t scripts = 0;
+    size_t sounds = 0;
+    for (const auto &archetype : archetypes)
+    {
+        level.objectCount += archetype.Count();
+        colliders += archetype.hasCollider ? archetype.Count() : 0;
+        bodies += archetype.hasBody ? archetype.Count() : 0;
+        paths += archetype.hasPath ? archetype.Count() : 0;
+        steering += archetype.hasSteering ? archetype.Count() : 0;
+        scripts += !archetype.script.empty() ? archetype.Count() : 0;
+        sounds += !archetype.sound.empty() ? archetype.Count() : 0;
+    }
+    registry.ReserveEntities(level.objectCount);
+    registry.ReserveComponents<TransformerComponent>(level.objectCount);
+    registry.ReserveComponents<BoxColliderComponent>(colliders);
+    registry.ReserveComponents<RigidBodyComponent>(bodies);
+    registry.ReserveComponents<PathComponent>(paths);
+    registry.ReserveComponents<SteeringComponent>(steering);
+    registry.ReserveComponents<ScriptComponent>(scripts);
+    registry.ReserveComponents<SoundEmitterComponent>(sounds);
+
+    for (const auto &archetype : archetypes)
+    {
+        level.counts.emplace_back(archetype.name, archetype.Count());
+        if (archetype.Count() == 0)
+        {
+            continue;
+        }
+        std::vector<Entity> entities = registry.CreateEntities(archetype.Count());
+        const float *positions = archetype.positions.data();
+        registry.AddComponents<TransformerComponent>(entities, [positions](size_t i)
+                                                     { return TransformerComponent{glm::vec2(positions[2 * i], positions[2 * i + 1]), glm::vec2(1.0f), 0.0}; });
+        if (archetype.hasCollider)
+        {
+            registry.AddComponents<BoxColliderComponent>(entities, [&](size_t)
+                                                         { return archetype.collider; });
+        }
+        if (archetype.hasBody)
+        {
+            registry.AddComponents<RigidBodyComponent>(entities, [](size_t)
+                                                       { return RigidBodyComponent(); });
+        }
+        if (archetype.hasPath)
+        {
+            // with a goal the PathfindingSystem asks for the way there on its first Update
+            PathComponent path;
+            if (archetype.hasGoal)
+            {
+                path.goal = glm::ivec2(static_cast<int>(std::floor(archetype.goal.x / level.tileSize)),
+                                       static_cast<int>(std::floor(archetype.goal.y / level.tileSize)));
+                path.repath = true;
+            }
+            registry.AddComponents<PathComponent>(entities, [&](size_t)
+                                                  { return path; });
+        }
+        if (archetype.hasSteering)
+        {
+            registry.AddComponents<SteeringComponent>(entities, [&](size_t)
+                                                      { return archetype.steering; });
+        }
+        if (!archetype.script.empty())
+        {
+            registry.AddComponents<ScriptComponent>(entities, [&](size_t)
+                                                    { return ScriptComponent{archetype.script}; });
+        }
+        if (!archetype.sound.empty())
+        {
+            SoundEmitterComponent emitter;
+            emitter.sound = archetype.sound;
+            registry.AddComponents<SoundEmitterComponent>(entities, [&](size_t)
+                                                          { return emitter; });
+        }
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOGGER_INFO(LOG_ECS, "Loaded level " + path + ": " + std::to_string(level.objectCount) + " objects in " +
+                             std::to_string(archetypes.size()) + " archetypes, " + std::to_string(milliseconds) + " ms");
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef LEVELLOADER_H
+#define LEVELLOADER_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../Scripting/ScriptLoader.h"
+
+// what a level file says besides its objects
+struct Level
+{
+    // tile map file and the size of a tile in pixels
+    std::string map;
+    float tileSize = 32.0f;
+    // music track played while the level runs, none if empty
+    std::string music;
+    // objects placed per archetype, by archetype name
+    std::vector<std::pair<std::string, size_t>> counts;
+    size_t objectCount = 0;
+};
+
+// Loads levels described as Lua tables:
+//
+//   return {
+//       map = "./assets/tilemaps/jungle.map",
+//       tile_size = 32,
+//       music = "./assets/music/jungle.wav",
+//       archetypes = {
+//           tank = { collider = { 32, 32 }, body = true, script = "patrol" },
+//           truck = { collider = { 32, 32 }, body = true, goal = { 640, 400 },
+//                     steering = { radius = 12, speed = 90 } },
+//           tree = { collider = { 16, 16, 8, 16 } },
+//           chopper = { sound = "helicopter" },
+//       },
+//       objects = {
+//           tank = { 160, 96, 224, 96 },   -- x, y pairs in pixels
+//           tree = { 40, 40 },
+//       },
+//   }
+//
+// Every object gets a TransformerComponent at its position, and what its
+// archetype lists: collider = { width, height [, offset x, offset y] } a
+// BoxColliderComponent, body a RigidBodyComponent, path a PathComponent,
+// goal = { x, y } a PathComponent already asking for the way to that pixel,
+// steering a SteeringComponent, script a ScriptComponent and sound a
+// looping SoundEmitterComponent. Steering and a script both set the body's
+// velocity, so an archetype has one or the other. Level files are Lua, so
+// big or generated levels can build their tables in loops.
+//
+// Placements come as flat coordinate arrays per archetype, not a table per
+// object, which keeps a 100k object level cheap to build in Lua and to read.
+// The whole file is read and checked first, counting the objects of each
+// archetype; only then is storage reserved for all of them and every
+// archetype created in bulk through the Registry. A broken level creates
+// nothing. Levels go through the ScriptLoader, so they come from the
+// bytecode pack or cache as scripts do.
+class LevelLoader
+{
+private:
+    ScriptLoader loader;
+
+public:
+    // bytecode cache and pack used for level files
+    ScriptLoader &GetLoader() { return loader; }
+
+    // creates the level's objects in the registry; they join the systems
+    // with the next Registry::Update. Logs why and returns false if the
+    // file can't be loaded
+    bool Load(const std::string &path, Registry &registry, Level &level);
+};
+
+#endif
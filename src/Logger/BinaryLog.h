@@ -0,0 +1,102 @@
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// On-disk layout of the binary log sink, shared by the Logger and the
+// offline decoder (tools/LogDecoder.cpp). Everything is in host byte order.
+//
+//  file header   : "2DLG" | u16 version | i64 wall clock in microseconds at steady time 0
+//  format record : u8 RECORD_FORMAT | u32 id | u8 level | str category | str argument codes | str format
+//  event record  : u8 RECORD_EVENT | u32 format id | i64 steady nanoseconds | u32 thread | u16 size | argument bytes
+//
+// "str" is a u16 length followed by the bytes. A format is written once, the
+// first time its call site fires; events only carry the id and the raw values.
+namespace BinaryLog
+{
+    const char MAGIC[4] = {'2', 'D', 'L', 'G'};
+    const uint16_t VERSION = 1;
+
+    enum RecordKind : uint8_t
+    {
+        RECORD_FORMAT = 1,
+        RECORD_EVENT = 2
+    };
+
+    // one character per argument in the format record
+    const char ARG_INT = 'i';    // int64
+    const char ARG_UINT = 'u';   // uint64
+    const char ARG_DOUBLE = 'd'; // double
+    const char ARG_BOOL = 'b';   // uint8
+    const char ARG_STRING = 's'; // u16 length + bytes
+
+    template <typename T>
+    struct UnsupportedArgument : std::false_type
+    {
+    };
+
+    template <typename T>
+    constexpr char ArgCode()
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, bool>)
+            return ARG_BOOL;
+        else if constexpr (std::is_enum_v<U> || (std::is_integral_v<U> && std::is_signed_v<U>))
+            return ARG_INT;
+        else if constexpr (std::is_integral_v<U>)
+            return ARG_UINT;
+        else if constexpr (std::is_floating_point_v<U>)
+            return ARG_DOUBLE;
+        else if constexpr (std::is_same_v<U, const char *> || std::is_same_v<U, char *> || std::is_same_v<U, std::string>)
+            return ARG_STRING;
+        else
+            static_assert(UnsupportedArgument<U>::value, "binary log arguments must be numbers, bools or strings");
+    }
+
+    template <typename... Args>
+    struct Signature
+    {
+        static constexpr char codes[] = {ArgCode<Args>()..., '\0'};
+    };
+
+    template <typename T>
+    inline void Put(std::vector<char> &out, const T &value)
+    {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    inline void PutString(std::vector<char> &out, const char *text, size_t length)
+    {
+        uint16_t size = static_cast<uint16_t>(length > UINT16_MAX ? UINT16_MAX : length);
+        Put(out, size);
+        out.insert(out.end(), text, text + size);
+    }
+
+    template <typename T>
+    inline void EncodeArg(std::vector<char> &out, const T &value)
+    {
+        constexpr char code = ArgCode<T>();
+        if constexpr (code == ARG_BOOL)
+            Put(out, static_cast<uint8_t>(value ? 1 : 0));
+        else if constexpr (code == ARG_INT)
+            Put(out, static_cast<int64_t>(value));
+        else if constexpr (code == ARG_UINT)
+            Put(out, static_cast<uint64_t>(value));
+        else if constexpr (code == ARG_DOUBLE)
+            Put(out, static_cast<double>(value));
+        else if constexpr (std::is_same_v<std::decay_t<T>, std::string>)
+            PutString(out, value.data(), value.size());
+        else
+        {
+            // a literal or char buffer arrives as an array, which is never null
+            const char *text = value;
+            PutString(out, text ? text : "(null)", text ? strlen(text) : 6);
+        }
+    }
+}
+
+#endif
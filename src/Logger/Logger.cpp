@@ -3,36 +3,287 @@
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
 
 using namespace std;
 
 // everything we *declare* in .h needs to be *defined* here.
 std::vector<LogEntry> Logger::messages;
+LogType Logger::thresholds[LOG_CATEGORY_COUNT] = {LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO};
+std::atomic<bool> Logger::binarySinkOpen(false);
 
-string CurrentDataTimeToString()
+namespace
 {
-    static time_t givemetime = chrono::system_clock::to_time_t(chrono::system_clock::now());
-    string timeStr = ctime(&givemetime);
-    timeStr.erase(timeStr.length() - 1);
-    return timeStr;
+    // steady_clock never jumps, so we pair it once with the wall clock and
+    // derive every wall-clock time from that anchor
+    struct ClockAnchor
+    {
+        chrono::steady_clock::time_point steady;
+        chrono::system_clock::time_point system;
+    };
+
+    const ClockAnchor &GetClockAnchor()
+    {
+        static const ClockAnchor anchor = {chrono::steady_clock::now(), chrono::system_clock::now()};
+        return anchor;
+    }
+
+    struct FormatDefinition
+    {
+        uint32_t id;
+        LogType type;
+        LogCategory category;
+        const char *format;
+        const char *argCodes;
+    };
+
+    // everything the binary sink touches is behind one mutex; the hot path
+    // only appends bytes to the staging buffer, which goes out in big writes
+    const size_t BINARY_FLUSH_SIZE = 64 * 1024;
+    std::mutex binaryMutex;
+    FILE *binaryFile = nullptr;
+    std::vector<char> binaryBuffer;
+    std::vector<FormatDefinition> formatDefinitions;
+
+    uint32_t CurrentThreadIndex()
+    {
+        static std::atomic<uint32_t> nextIndex(1);
+        thread_local uint32_t index = nextIndex.fetch_add(1);
+        return index;
+    }
+
+    void FlushBinaryBuffer()
+    {
+        if (binaryFile && !binaryBuffer.empty())
+        {
+            fwrite(binaryBuffer.data(), 1, binaryBuffer.size(), binaryFile);
+        }
+        binaryBuffer.clear();
+    }
+
+    void PutFormatDefinition(const FormatDefinition &definition)
+    {
+        BinaryLog::Put(binaryBuffer, BinaryLog::RECORD_FORMAT);
+        BinaryLog::Put(binaryBuffer, definition.id);
+        BinaryLog::Put(binaryBuffer, static_cast<uint8_t>(definition.type));
+        const char *category = Logger::CategoryName(definition.category);
+        BinaryLog::PutString(binaryBuffer, category, strlen(category));
+        BinaryLog::PutString(binaryBuffer, definition.argCodes, strlen(definition.argCodes));
+        BinaryLog::PutString(binaryBuffer, definition.format, strlen(definition.format));
+    }
 }
 
-void Logger::Log(const std::string &message)
+string Logger::FormatTimestamp(chrono::steady_clock::time_point timestamp)
+{
+    const ClockAnchor &anchor = GetClockAnchor();
+    auto wallTime = anchor.system + chrono::duration_cast<chrono::system_clock::duration>(timestamp - anchor.steady);
+    auto sinceEpoch = chrono::duration_cast<chrono::microseconds>(wallTime.time_since_epoch());
+    time_t seconds = static_cast<time_t>(sinceEpoch.count() / 1000000);
+    long micros = static_cast<long>(sinceEpoch.count() % 1000000);
+    if (micros < 0)
+    {
+        seconds -= 1;
+        micros += 1000000;
+    }
+
+    // the date/time part only changes once per second, so we keep it around
+    // and only redo the calendar conversion when the second rolls over
+    thread_local time_t cachedSecond = -1;
+    thread_local char cachedPrefix[32] = "";
+    if (seconds != cachedSecond)
+    {
+        tm localTime;
+        localtime_r(&seconds, &localTime);
+        strftime(cachedPrefix, sizeof(cachedPrefix), "%d-%b-%Y %H:%M:%S", &localTime);
+        cachedSecond = seconds;
+    }
+
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%s.%06ld", cachedPrefix, micros);
+    return buffer;
+}
+
+void Logger::Write(const LogEntry &entry)
+{
+    const char *color = "\033[0;32m";
+    const char *label = "LOG";
+    switch (entry.type)
+    {
+    case LOG_TRACE:
+        color = "\033[0;90m";
+        label = "TRC";
+        break;
+    case LOG_DEBUG:
+        color = "\033[0;36m";
+        label = "DBG";
+        break;
+    case LOG_INFO:
+        break;
+    case LOG_WARNING:
+        color = "\033[0;33m";
+        label = "WRN";
+        break;
+    case LOG_ERROR:
+        color = "\033[0;31m";
+        label = "ERR";
+        break;
+    }
+    ostream &out = entry.type == LOG_ERROR ? cerr : cout;
+    out << color
+        << label << " | " << FormatTimestamp(entry.timestamp) << " - " << entry.message << "\033[0m" << endl;
+}
+
+const char *Logger::CategoryName(LogCategory category)
+{
+    switch (category)
+    {
+    case LOG_GENERAL:
+        return "general";
+    case LOG_ECS:
+        return "ecs";
+    case LOG_RENDER:
+        return "render";
+    case LOG_MEMORY:
+        return "memory";
+    case LOG_PHYSICS:
+        return "physics";
+    case LOG_SCRIPT:
+        return "script";
+    case LOG_AUDIO:
+        return "audio";
+    default:
+        return "unknown";
+    }
+}
+
+void Logger::SetThreshold(LogCategory category, LogType type)
+{
+    thresholds[category] = type;
+}
+
+void Logger::Add(LogType type, LogCategory category, const std::string &message)
 {
     LogEntry LogEntry;
-    LogEntry.type = LOG_INFO;
+    LogEntry.type = type;
+    LogEntry.category = category;
+    LogEntry.timestamp = chrono::steady_clock::now();
     LogEntry.message = message;
-    cout << "\033[0;32m"
-         << "LOG | " << CurrentDataTimeToString() << " - " << message << "\033[0m" << endl;
+    Write(LogEntry);
     messages.push_back(LogEntry);
 }
 
+void Logger::Log(const std::string &message)
+{
+    if (IsEnabled(LOG_INFO, LOG_GENERAL))
+    {
+        Add(LOG_INFO, LOG_GENERAL, message);
+    }
+}
+
+void Logger::Warn(const std::string &message)
+{
+    if (IsEnabled(LOG_WARNING, LOG_GENERAL))
+    {
+        Add(LOG_WARNING, LOG_GENERAL, message);
+    }
+}
+
 void Logger::Err(const std::string &message)
 {
-    LogEntry LogEntry;
-    LogEntry.type = LOG_ERROR;
-    LogEntry.message = message;
-    cerr << "\033[0;31m"
-         << "ERR | " << CurrentDataTimeToString() << " - " << message << "\033[0m" << endl;
-    messages.push_back(LogEntry);
+    if (IsEnabled(LOG_ERROR, LOG_GENERAL))
+    {
+        Add(LOG_ERROR, LOG_GENERAL, message);
+    }
+}
+
+bool Logger::OpenBinarySink(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(binaryMutex);
+    if (binaryFile)
+    {
+        FlushBinaryBuffer();
+        fclose(binaryFile);
+    }
+    binaryFile = fopen(path.c_str(), "wb");
+    if (!binaryFile)
+    {
+        binarySinkOpen.store(false);
+        return false;
+    }
+
+    const ClockAnchor &anchor = GetClockAnchor();
+    auto wallAtAnchor = chrono::duration_cast<chrono::microseconds>(anchor.system.time_since_epoch());
+    auto steadyAtAnchor = chrono::duration_cast<chrono::microseconds>(anchor.steady.time_since_epoch());
+    int64_t wallAtSteadyZero = static_cast<int64_t>((wallAtAnchor - steadyAtAnchor).count());
+    binaryBuffer.insert(binaryBuffer.end(), BinaryLog::MAGIC, BinaryLog::MAGIC + sizeof(BinaryLog::MAGIC));
+    BinaryLog::Put(binaryBuffer, BinaryLog::VERSION);
+    BinaryLog::Put(binaryBuffer, wallAtSteadyZero);
+
+    // call sites interned before this file was opened won't announce themselves again
+    for (const FormatDefinition &definition : formatDefinitions)
+    {
+        PutFormatDefinition(definition);
+    }
+    binarySinkOpen.store(true);
+    return true;
+}
+
+void Logger::CloseBinarySink()
+{
+    std::lock_guard<std::mutex> lock(binaryMutex);
+    binarySinkOpen.store(false);
+    if (binaryFile)
+    {
+        FlushBinaryBuffer();
+        fclose(binaryFile);
+        binaryFile = nullptr;
+    }
+}
+
+uint32_t Logger::InternFormat(LogType type, LogCategory category, const char *format, const char *argCodes)
+{
+    std::lock_guard<std::mutex> lock(binaryMutex);
+    FormatDefinition definition;
+    definition.id = static_cast<uint32_t>(formatDefinitions.size() + 1);
+    definition.type = type;
+    definition.category = category;
+    definition.format = format;
+    definition.argCodes = argCodes;
+    formatDefinitions.push_back(definition);
+    if (binaryFile)
+    {
+        PutFormatDefinition(definition);
+    }
+    return definition.id;
+}
+
+void Logger::WriteRecord(uint32_t formatId, chrono::steady_clock::time_point timestamp, const std::vector<char> &payload)
+{
+    int64_t nanoseconds = chrono::duration_cast<chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+    uint32_t thread = CurrentThreadIndex();
+    // a cut payload would end in the middle of an argument and the decoder
+    // would misread every record after it, so an oversized one is dropped
+    if (payload.size() > UINT16_MAX)
+    {
+        return;
+    }
+    uint16_t size = static_cast<uint16_t>(payload.size());
+
+    std::lock_guard<std::mutex> lock(binaryMutex);
+    if (!binaryFile)
+    {
+        return;
+    }
+    BinaryLog::Put(binaryBuffer, BinaryLog::RECORD_EVENT);
+    BinaryLog::Put(binaryBuffer, formatId);
+    BinaryLog::Put(binaryBuffer, nanoseconds);
+    BinaryLog::Put(binaryBuffer, thread);
+    BinaryLog::Put(binaryBuffer, size);
+    binaryBuffer.insert(binaryBuffer.end(), payload.begin(), payload.end());
+    if (binaryBuffer.size() >= BINARY_FLUSH_SIZE)
+    {
+        FlushBinaryBuffer();
+    }
 }
@@ -2,26 +2,169 @@
 #define LOGGER_H
 #include <string>
 #include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include "BinaryLog.h"
+
+// numeric levels so the preprocessor can compare them
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_ERROR 4
+
+// anything below this level is compiled out of the LOGGER_* macros,
+// e.g. build with -DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO to strip trace/debug
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
 
 enum LogType
 {
-    LOG_INFO,
-    LOG_WARNING,
-    LOG_ERROR
+    LOG_TRACE = LOG_LEVEL_TRACE,
+    LOG_DEBUG = LOG_LEVEL_DEBUG,
+    LOG_INFO = LOG_LEVEL_INFO,
+    LOG_WARNING = LOG_LEVEL_WARNING,
+    LOG_ERROR = LOG_LEVEL_ERROR
+};
+
+enum LogCategory
+{
+    LOG_GENERAL,
+    LOG_ECS,
+    LOG_RENDER,
+    LOG_MEMORY,
+    LOG_PHYSICS,
+    LOG_SCRIPT,
+    LOG_AUDIO,
+    LOG_CATEGORY_COUNT
 };
 
 struct LogEntry
 {
     LogType type;
+    LogCategory category;
+    // raw monotonic time taken at the call site, only turned into text by the sink
+    std::chrono::steady_clock::time_point timestamp;
     std::string message;
 };
 
 class Logger
 {
+private:
+    static void Write(const LogEntry &entry);
+    static std::atomic<bool> binarySinkOpen;
+    static void WriteRecord(uint32_t formatId, std::chrono::steady_clock::time_point timestamp, const std::vector<char> &payload);
+
 public:
     static std::vector<LogEntry> messages;
+    // runtime minimum level per category (defaults to LOG_INFO)
+    static LogType thresholds[LOG_CATEGORY_COUNT];
+
+    static bool IsEnabled(LogType type, LogCategory category)
+    {
+        return type >= thresholds[category];
+    }
+    static void SetThreshold(LogCategory category, LogType type);
+
+    static void Add(LogType type, LogCategory category, const std::string &message);
     static void Log(const std::string &message);
+    static void Warn(const std::string &message);
     static void Err(const std::string &message);
+    static const char *CategoryName(LogCategory category);
+
+    // binary sink: records are format id + timestamp + thread + raw argument
+    // bytes, turned back into text offline by the logdecoder tool
+    static bool OpenBinarySink(const std::string &path);
+    static void CloseBinarySink();
+    static bool HasBinarySink()
+    {
+        return binarySinkOpen.load(std::memory_order_relaxed);
+    }
+    static uint32_t InternFormat(LogType type, LogCategory category, const char *format, const char *argCodes);
+
+    template <typename... Args>
+    static void Record(std::atomic<uint32_t> &formatId, LogType type, LogCategory category, const char *format, const Args &...args)
+    {
+        auto timestamp = std::chrono::steady_clock::now();
+        uint32_t id = formatId.load(std::memory_order_acquire);
+        if (id == 0)
+        {
+            id = InternFormat(type, category, format, BinaryLog::Signature<Args...>::codes);
+            formatId.store(id, std::memory_order_release);
+        }
+        thread_local std::vector<char> payload;
+        payload.clear();
+        (BinaryLog::EncodeArg(payload, args), ...);
+        WriteRecord(id, timestamp, payload);
+    }
+
+    // wall-clock text ("19-Oct-2026 14:03:27.123456") for a steady_clock timestamp
+    static std::string FormatTimestamp(std::chrono::steady_clock::time_point timestamp);
 };
 
+// the message expression is only evaluated when the level passes both the
+// compile-time and the runtime check; disabled levels never build their string
+#define LOGGER_AT(type, category, message)              \
+    do                                                  \
+    {                                                   \
+        if (Logger::IsEnabled((type), (category)))      \
+        {                                               \
+            Logger::Add((type), (category), (message)); \
+        }                                               \
+    } while (0)
+
+// compiled-out levels keep the message in an unevaluated sizeof so that
+// variables only used for logging don't turn into warnings
+#define LOGGER_DISCARD(category, message) \
+    do                                    \
+    {                                     \
+        (void)sizeof(category);           \
+        (void)sizeof(message);            \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TRACE
+#define LOGGER_TRACE(category, message) LOGGER_AT(LOG_TRACE, category, message)
+#else
+#define LOGGER_TRACE(category, message) LOGGER_DISCARD(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOGGER_DEBUG(category, message) LOGGER_AT(LOG_DEBUG, category, message)
+#else
+#define LOGGER_DEBUG(category, message) LOGGER_DISCARD(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOGGER_INFO(category, message) LOGGER_AT(LOG_INFO, category, message)
+#else
+#define LOGGER_INFO(category, message) LOGGER_DISCARD(category, message)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARNING
+#define LOGGER_WARN(category, message) LOGGER_AT(LOG_WARNING, category, message)
+#else
+#define LOGGER_WARN(category, message) LOGGER_DISCARD(category, message)
+#endif
+
+// errors are never compiled out
+#define LOGGER_ERR(category, message) LOGGER_AT(LOG_ERROR, category, message)
+
+// binary record, e.g. LOGGER_RECORD(LOG_DEBUG, LOG_ECS, "entity {} at {}, {}", id, x, y);
+// the format must be a string literal with one {} per argument. the format id
+// is interned the first time the call site fires, afterwards only raw values
+// are copied out. nothing is recorded until a sink is open, in the game with
+// --binary-log <file>; a record whose arguments take more than 64 KB is dropped
+#define LOGGER_RECORD(type, category, format, ...)                                     \
+    do                                                                                 \
+    {                                                                                  \
+        if ((type) >= LOG_COMPILE_LEVEL && Logger::HasBinarySink() &&                 \
+            Logger::IsEnabled((type), (category)))                                     \
+        {                                                                              \
+            static std::atomic<uint32_t> loggerFormatId{0};                            \
+            Logger::Record(loggerFormatId, (type), (category), format, ##__VA_ARGS__); \
+        }                                                                              \
+    } while (0)
+
 #endif
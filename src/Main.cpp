@@ -1,8 +1,61 @@
 #include <iostream>
+#include <string>
 #include "./Game/Game.h"
+#include "./Logger/Logger.h"
 
+namespace
+{
+    // --log-level trace|debug|info|warning|error for every category
+    bool ParseLogLevel(const std::string &name, LogType &type)
+    {
+        const char *names[] = {"trace", "debug", "info", "warning", "error"};
+        for (int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_ERROR; level++)
+        {
+            if (name == names[level])
+            {
+                type = static_cast<LogType>(level);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+// --binary-log <file> sends LOGGER_RECORD call sites to a binary log, read
+// back with the logdecoder tool; the per-frame trace sites only record with
+// --log-level trace
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        if (i + 1 == argc)
+        {
+            Logger::Err("Option " + option + " needs a value");
+            break;
+        }
+        const std::string value = argv[i + 1];
+        LogType type;
+        if (option == "--binary-log")
+        {
+            if (!Logger::OpenBinarySink(value))
+            {
+                Logger::Err("Binary log " + value + " can't be opened");
+            }
+        }
+        else if (option == "--log-level" && ParseLogLevel(value, type))
+        {
+            for (int category = 0; category < LOG_CATEGORY_COUNT; category++)
+            {
+                Logger::SetThreshold(static_cast<LogCategory>(category), type);
+            }
+        }
+        else
+        {
+            Logger::Err("Unknown option " + option + " " + value);
+        }
+    }
+
     Game game;
     game.Initialize();
     game.Run();
@@ -0,0 +1,104 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<uint64_t> heapAllocations(0);
+
+    void *CountedAllocate(std::size_t size)
+    {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        void *memory = std::malloc(size ? size : 1);
+        if (!memory)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    void *CountedAllocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        std::size_t align = static_cast<std::size_t>(alignment);
+        if (align < sizeof(void *))
+        {
+            align = sizeof(void *);
+        }
+        void *memory = nullptr;
+        if (posix_memalign(&memory, align, size ? size : 1) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+}
+
+uint64_t AllocationCounter::Total()
+{
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+
+// replacements for the global allocation functions; the array, sized and
+// nothrow forms of the standard library all end up in these
+
+void *operator new(std::size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return CountedAllocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
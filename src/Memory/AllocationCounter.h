@@ -0,0 +1,14 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+// counts every trip through the global operator new (replaced in
+// AllocationCounter.cpp) so Game can report heap allocations per frame
+class AllocationCounter
+{
+public:
+    static uint64_t Total();
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdlib>
+
+std::atomic<uint64_t> FrameArena::currentFrame(0);
+
+FrameArena::FrameArena(size_t capacity)
+{
+    Block block;
+    block.capacity = capacity;
+    block.memory = static_cast<char *>(std::malloc(capacity));
+    if (!block.memory)
+    {
+        throw std::bad_alloc();
+    }
+    blocks.push_back(block);
+    blockIndex = 0;
+    offset = 0;
+    usedInPreviousBlocks = 0;
+    highWaterMark = 0;
+    overflowCount = 0;
+    frame = currentFrame.load(std::memory_order_relaxed);
+}
+
+FrameArena::~FrameArena()
+{
+    for (Block &block : blocks)
+    {
+        std::free(block.memory);
+    }
+}
+
+size_t FrameArena::Capacity() const
+{
+    size_t capacity = 0;
+    for (const Block &block : blocks)
+    {
+        capacity += block.capacity;
+    }
+    return capacity;
+}
+
+void FrameArena::Reset()
+{
+    highWaterMark = std::max(highWaterMark, BytesUsed());
+    // a frame spilled into extra blocks: merge them into one big block so the
+    // next frames fit again without chaining
+    if (blocks.size() > 1)
+    {
+        size_t capacity = Capacity();
+        // the old blocks stay until the merged one is there
+        char *memory = static_cast<char *>(std::malloc(capacity));
+        if (!memory)
+        {
+            throw std::bad_alloc();
+        }
+        for (Block &block : blocks)
+        {
+            std::free(block.memory);
+        }
+        blocks.resize(1);
+        blocks[0].capacity = capacity;
+        blocks[0].memory = memory;
+    }
+    blockIndex = 0;
+    offset = 0;
+    usedInPreviousBlocks = 0;
+    frame = currentFrame.load(std::memory_order_relaxed);
+}
+
+void *FrameArena::AllocateSlow(size_t size, size_t alignment)
+{
+    usedInPreviousBlocks += offset;
+    offset = 0;
+    blockIndex++;
+    if (blockIndex == blocks.size() || blocks[blockIndex].capacity < size + alignment)
+    {
+        Block block;
+        block.capacity = std::max(blocks[0].capacity, size + alignment);
+        block.memory = static_cast<char *>(std::malloc(block.capacity));
+        if (!block.memory)
+        {
+            throw std::bad_alloc();
+        }
+        blocks.insert(blocks.begin() + blockIndex, block);
+        overflowCount++;
+    }
+    return Allocate(size, alignment);
+}
+
+FrameArena &FrameArena::ForThread()
+{
+    thread_local FrameArena arena;
+    return arena;
+}
+
+void FrameArena::NewFrame()
+{
+    currentFrame.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,113 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump-pointer allocator for data that only lives until the end of the frame
+// (render queues, collision pairs, scratch strings...). Every thread owns one
+// through ForThread(). Game::Run calls NewFrame() at the top of each loop
+// iteration; each arena notices the new frame on its next allocation and
+// rewinds, so no thread ever touches another thread's arena.
+//
+// Nothing allocated here is ever freed or destroyed individually, and
+// nothing may be kept past the frame it was allocated in.
+class FrameArena
+{
+private:
+    struct Block
+    {
+        char *memory;
+        size_t capacity;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockIndex;
+    size_t offset;
+    size_t usedInPreviousBlocks;
+    size_t highWaterMark;
+    size_t overflowCount;
+    uint64_t frame;
+
+    static std::atomic<uint64_t> currentFrame;
+
+    void Reset();
+    void *AllocateSlow(size_t size, size_t alignment);
+
+public:
+    static const size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+    FrameArena(size_t capacity = DEFAULT_CAPACITY);
+    ~FrameArena();
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        if (frame != currentFrame.load(std::memory_order_relaxed))
+        {
+            Reset();
+        }
+        const Block &block = blocks[blockIndex];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.memory);
+        uintptr_t address = (base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (address + size <= base + block.capacity)
+        {
+            offset = address + size - base;
+            return reinterpret_cast<void *>(address);
+        }
+        return AllocateSlow(size, alignment);
+    }
+
+    template <typename T, typename... TArgs>
+    T *New(TArgs &&...args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "frame arena objects are never destroyed");
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+    }
+
+    // bytes handed out since the last rewind (including alignment padding)
+    size_t BytesUsed() const { return usedInPreviousBlocks + offset; }
+    // largest BytesUsed() seen at the end of any frame so far
+    size_t HighWaterMark() const { return highWaterMark; }
+    size_t Capacity() const;
+    // how many times a frame ran out of room and had to grab another block
+    size_t OverflowCount() const { return overflowCount; }
+
+    static FrameArena &ForThread();
+    static void NewFrame();
+};
+
+// STL adapter, e.g. std::vector<Pair, FrameAllocator<Pair>>.
+// Memory comes from the arena of the thread that grows the container and
+// deallocate is a no-op. The container must not outlive the frame.
+template <typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+
+    FrameAllocator() noexcept {}
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &) noexcept {}
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(FrameArena::ForThread().Allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *, size_t) noexcept {}
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &) { return false; }
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
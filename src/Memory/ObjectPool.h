@@ -0,0 +1,265 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+const size_t CACHE_LINE_SIZE = 64;
+
+// Fixed-size allocator for one type. Objects are carved out of cache-line
+// aligned slabs and freed slots are chained through an intrusive free list,
+// so New/Delete are a couple of pointer moves and objects allocated together
+// sit next to each other in memory.
+//
+// A pool is single-threaded by default. Constructed with threadCaches = true
+// it can be shared between threads: every thread then keeps a small private
+// stack of free slots and only takes the pool lock to trade a batch of them
+// with the shared free list. When a thread exits, the slots left in its
+// caches go back to the shared free lists of the pools still alive.
+//
+// The pool never runs destructors on its own; Delete every object before the
+// pool goes away.
+template <typename T>
+class ObjectPool
+{
+private:
+    union Slot
+    {
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static const size_t SLOT_ALIGNMENT = alignof(Slot) > CACHE_LINE_SIZE ? alignof(Slot) : CACHE_LINE_SIZE;
+    static const size_t CACHE_SIZE = 64;
+
+    struct ThreadCache
+    {
+        Slot *slots[CACHE_SIZE];
+        size_t count = 0;
+    };
+
+    // one thread's caches, one per pool of this type, by cache index
+    struct ThreadCaches
+    {
+        std::vector<ThreadCache> caches;
+
+        ~ThreadCaches()
+        {
+            // under the registry lock, so no pool goes away meanwhile
+            std::lock_guard<std::mutex> lock(RegistryMutex());
+            const std::vector<ObjectPool *> &pools = LivePools();
+            for (size_t i = 0; i < caches.size() && i < pools.size(); i++)
+            {
+                if (pools[i] && caches[i].count > 0)
+                {
+                    pools[i]->FlushCache(caches[i]);
+                }
+            }
+        }
+    };
+
+    size_t slotsPerSlab;
+    bool threadCaches;
+    size_t cacheIndex;
+    std::vector<Slot *> slabs;
+    Slot *freeList;
+    std::mutex mutex;
+    // slots taken from the shared free list; with thread caches this also
+    // counts the free slots parked in the caches
+    size_t liveCount;
+
+    // every pool that uses thread caches gets its own slot in each thread's
+    // cache table; indices are never reused so a dead pool's slot is just ignored
+    static size_t NextCacheIndex()
+    {
+        static std::atomic<size_t> nextIndex(0);
+        return nextIndex.fetch_add(1);
+    }
+
+    // pools with thread caches by cache index, null once destroyed, for
+    // exiting threads to hand their cached slots back to
+    static std::mutex &RegistryMutex()
+    {
+        static std::mutex registryMutex;
+        return registryMutex;
+    }
+    static std::vector<ObjectPool *> &LivePools()
+    {
+        static std::vector<ObjectPool *> pools;
+        return pools;
+    }
+
+    ThreadCache &GetThreadCache()
+    {
+        thread_local ThreadCaches threadCaches;
+        std::vector<ThreadCache> &caches = threadCaches.caches;
+        if (cacheIndex >= caches.size())
+        {
+            caches.resize(cacheIndex + 1);
+        }
+        return caches[cacheIndex];
+    }
+
+    void FlushCache(ThreadCache &cache)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (cache.count > 0)
+        {
+            PushShared(cache.slots[--cache.count]);
+        }
+    }
+
+    void AddSlab()
+    {
+        Slot *slab = static_cast<Slot *>(::operator new(slotsPerSlab * sizeof(Slot), std::align_val_t(SLOT_ALIGNMENT)));
+        slabs.push_back(slab);
+        // chain back to front so the free list hands out ascending addresses
+        for (size_t i = slotsPerSlab; i-- > 0;)
+        {
+            slab[i].next = freeList;
+            freeList = &slab[i];
+        }
+    }
+
+    Slot *PopShared()
+    {
+        if (!freeList)
+        {
+            AddSlab();
+        }
+        Slot *slot = freeList;
+        freeList = slot->next;
+        liveCount++;
+        return slot;
+    }
+
+    void PushShared(Slot *slot)
+    {
+        slot->next = freeList;
+        freeList = slot;
+        liveCount--;
+    }
+
+public:
+    ObjectPool(size_t slotsPerSlab = 256, bool threadCaches = false)
+        : slotsPerSlab(slotsPerSlab ? slotsPerSlab : 1),
+          threadCaches(threadCaches),
+          cacheIndex(threadCaches ? NextCacheIndex() : 0),
+          freeList(nullptr),
+          liveCount(0)
+    {
+        if (threadCaches)
+        {
+            std::lock_guard<std::mutex> lock(RegistryMutex());
+            std::vector<ObjectPool *> &pools = LivePools();
+            if (cacheIndex >= pools.size())
+            {
+                pools.resize(cacheIndex + 1, nullptr);
+            }
+            pools[cacheIndex] = this;
+        }
+    }
+
+    ~ObjectPool()
+    {
+        if (threadCaches)
+        {
+            std::lock_guard<std::mutex> lock(RegistryMutex());
+            LivePools()[cacheIndex] = nullptr;
+        }
+        for (Slot *slab : slabs)
+        {
+            ::operator delete(slab, std::align_val_t(SLOT_ALIGNMENT));
+        }
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    // raw storage for one T
+    void *Allocate()
+    {
+        if (!threadCaches)
+        {
+            return PopShared()->storage;
+        }
+
+        ThreadCache &cache = GetThreadCache();
+        if (cache.count == 0)
+        {
+            // refill half of the cache in one go
+            std::lock_guard<std::mutex> lock(mutex);
+            while (cache.count < CACHE_SIZE / 2)
+            {
+                cache.slots[cache.count++] = PopShared();
+            }
+        }
+        return cache.slots[--cache.count]->storage;
+    }
+
+    void Free(void *memory)
+    {
+        Slot *slot = reinterpret_cast<Slot *>(memory);
+        if (!threadCaches)
+        {
+            PushShared(slot);
+            return;
+        }
+
+        ThreadCache &cache = GetThreadCache();
+        if (cache.count == CACHE_SIZE)
+        {
+            // hand half of the cache back so other threads can reuse it
+            std::lock_guard<std::mutex> lock(mutex);
+            while (cache.count > CACHE_SIZE / 2)
+            {
+                PushShared(cache.slots[--cache.count]);
+            }
+        }
+        cache.slots[cache.count++] = slot;
+    }
+
+    template <typename... TArgs>
+    T *New(TArgs &&...args)
+    {
+        void *memory = Allocate();
+        try
+        {
+            return new (memory) T(std::forward<TArgs>(args)...);
+        }
+        catch (...)
+        {
+            Free(memory);
+            throw;
+        }
+    }
+
+    void Delete(T *object)
+    {
+        if (object)
+        {
+            object->~T();
+            Free(object);
+        }
+    }
+
+    // makes sure at least count objects fit without growing mid-frame
+    void Reserve(size_t count)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (Capacity() < count)
+        {
+            AddSlab();
+        }
+    }
+
+    size_t Capacity() const { return slabs.size() * slotsPerSlab; }
+    size_t LiveCount() const { return liveCount; }
+};
+
+#endif
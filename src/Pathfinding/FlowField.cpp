@@ -0,0 +1,417 @@
+#include "FlowField.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "IndexedHeap.h"
+#include "../Jobs/JobSystem.h"
+
+namespace
+{
+    const int STEP_X[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    const int STEP_Y[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    const float STEP_LENGTH[8] = {1.0f, 1.41421356f, 1.0f, 1.41421356f, 1.0f, 1.41421356f, 1.0f, 1.41421356f};
+    const float INFINITE = std::numeric_limits<float>::infinity();
+    const float GROUND_COST = 1.0f;
+    const float ROAD_COST = 0.5f;
+    // width of the key band one round solves, in tiles of ground
+    const float BAND = 2.0f * FlowField::CHUNK_SIZE;
+    const int NOT_OPEN = -1;
+    const int CLOSED = -2;
+
+    struct ChunkRect
+    {
+        int firstColumn;
+        int firstRow;
+        int columns;
+        int rows;
+    };
+
+    // calls visit(index, column, row) for the ring of tiles around the chunk:
+    // the row above, the row below, then the column left and right of it
+    template <typename TVisit>
+    void ForEachRingTile(const ChunkRect &rect, TVisit visit)
+    {
+        int index = 0;
+        for (int column = rect.firstColumn - 1; column <= rect.firstColumn + rect.columns; column++)
+        {
+            visit(index++, column, rect.firstRow - 1);
+            visit(index++, column, rect.firstRow + rect.rows);
+        }
+        for (int row = rect.firstRow; row < rect.firstRow + rect.rows; row++)
+        {
+            visit(index++, rect.firstColumn - 1, row);
+            visit(index++, rect.firstColumn + rect.columns, row);
+        }
+    }
+
+    const int RING_SIZE = 4 * FlowField::CHUNK_SIZE + 4;
+
+    struct HeapIndexOf
+    {
+        int *heapIndices;
+        int &operator()(int node) const { return heapIndices[node]; }
+    };
+
+    // per-thread scratch for solving one chunk
+    struct ChunkScratch
+    {
+        float cost[FlowField::CHUNK_SIZE * FlowField::CHUNK_SIZE];
+        int heapIndex[FlowField::CHUNK_SIZE * FlowField::CHUNK_SIZE];
+        IndexedHeap<HeapIndexOf> open{HeapIndexOf{heapIndex}};
+    };
+}
+
+FlowField::FlowField()
+    : terrain(nullptr), goal(0, 0), width(0), height(0), chunksX(0), chunksY(0), roundCount(0), chunkSolveCount(0)
+{
+}
+
+void FlowField::PrepareTiles(int firstRow, int lastRow)
+{
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        for (int column = 0; column < width; column++)
+        {
+            size_t tile = static_cast<size_t>(row) * width + column;
+            uint8_t mask = 0;
+            if (terrain->IsBlocked(column, row))
+            {
+                enterCosts[tile] = INFINITE;
+            }
+            else
+            {
+                enterCosts[tile] = (terrain->GetFlags(column, row) & TILE_ROAD) ? ROAD_COST : GROUND_COST;
+                for (int direction = 0; direction < 8; direction++)
+                {
+                    int dx = STEP_X[direction];
+                    int dy = STEP_Y[direction];
+                    bool open = !terrain->IsBlocked(column + dx, row + dy) &&
+                                ((direction & 1) == 0 || (!terrain->IsBlocked(column + dx, row) && !terrain->IsBlocked(column, row + dy)));
+                    mask |= open ? 1 << direction : 0;
+                }
+            }
+            moves[tile] = mask;
+        }
+    }
+}
+
+void FlowField::SolveChunk(int chunk, const float *ring, bool seedGoal, float *neighbourChanges)
+{
+    thread_local ChunkScratch scratch;
+
+    ChunkRect rect;
+    rect.firstColumn = (chunk % chunksX) << CHUNK_SHIFT;
+    rect.firstRow = (chunk / chunksX) << CHUNK_SHIFT;
+    rect.columns = std::min(CHUNK_SIZE, width - rect.firstColumn);
+    rect.rows = std::min(CHUNK_SIZE, height - rect.firstRow);
+    auto localOf = [&](int column, int row)
+    {
+        return (row - rect.firstRow) * CHUNK_SIZE + column - rect.firstColumn;
+    };
+    auto inside = [&](int column, int row)
+    {
+        return column >= rect.firstColumn && row >= rect.firstRow &&
+               column < rect.firstColumn + rect.columns && row < rect.firstRow + rect.rows;
+    };
+
+    for (int row = rect.firstRow; row < rect.firstRow + rect.rows; row++)
+    {
+        for (int column = rect.firstColumn; column < rect.firstColumn + rect.columns; column++)
+        {
+            int local = localOf(column, row);
+            scratch.cost[local] = integration[row * width + column];
+            scratch.heapIndex[local] = NOT_OPEN;
+        }
+    }
+    scratch.open.Clear();
+
+    auto improve = [&](int local, float cost)
+    {
+        if (cost < scratch.cost[local])
+        {
+            scratch.cost[local] = cost;
+            if (scratch.heapIndex[local] == NOT_OPEN)
+            {
+                scratch.open.Push(local, cost);
+            }
+            else
+            {
+                scratch.open.DecreaseKey(local, cost);
+            }
+        }
+    };
+
+    if (seedGoal)
+    {
+        scratch.cost[localOf(goal.x, goal.y)] = INFINITE;
+        improve(localOf(goal.x, goal.y), 0.0f);
+    }
+    // what the neighbours know flows in through the ring
+    ForEachRingTile(rect, [&](int index, int column, int row)
+                    {
+                        if (ring[index] == INFINITE)
+                        {
+                            return;
+                        }
+                        float enter = enterCosts[row * width + column];
+                        for (int direction = 0; direction < 8; direction++)
+                        {
+                            int fromColumn = column + STEP_X[direction];
+                            int fromRow = row + STEP_Y[direction];
+                            // direction ^ 4 is the opposite direction, from the chunk tile to the ring tile
+                            if (inside(fromColumn, fromRow) && (moves[fromRow * width + fromColumn] >> (direction ^ 4) & 1))
+                            {
+                                improve(localOf(fromColumn, fromRow), ring[index] + enter * STEP_LENGTH[direction]);
+                            }
+                        }
+                    });
+
+    while (!scratch.open.IsEmpty())
+    {
+        int local = scratch.open.Pop();
+        scratch.heapIndex[local] = CLOSED;
+        int column = rect.firstColumn + local % CHUNK_SIZE;
+        int row = rect.firstRow + local / CHUNK_SIZE;
+        float enter = enterCosts[row * width + column];
+        for (int direction = 0; direction < 8; direction++)
+        {
+            int fromColumn = column + STEP_X[direction];
+            int fromRow = row + STEP_Y[direction];
+            if (!inside(fromColumn, fromRow) || !(moves[fromRow * width + fromColumn] >> (direction ^ 4) & 1))
+            {
+                continue;
+            }
+            int from = localOf(fromColumn, fromRow);
+            if (scratch.heapIndex[from] != CLOSED)
+            {
+                improve(from, scratch.cost[local] + enter * STEP_LENGTH[direction]);
+            }
+        }
+    }
+
+    std::fill(neighbourChanges, neighbourChanges + 8, INFINITE);
+    const int lastColumn = rect.firstColumn + rect.columns - 1;
+    const int lastRow = rect.firstRow + rect.rows - 1;
+    for (int row = rect.firstRow; row <= lastRow; row++)
+    {
+        for (int column = rect.firstColumn; column <= lastColumn; column++)
+        {
+            float &value = integration[row * width + column];
+            float cost = scratch.cost[localOf(column, row)];
+            if (cost >= value)
+            {
+                continue;
+            }
+            value = cost;
+            // which neighbouring chunks touch this tile: the sides it is on,
+            // and the diagonal one as well for a corner tile
+            int vertical = row == rect.firstRow ? 0 : (row == lastRow ? 4 : -1);
+            int horizontal = column == rect.firstColumn ? 6 : (column == lastColumn ? 2 : -1);
+            if (vertical >= 0)
+            {
+                neighbourChanges[vertical] = std::min(neighbourChanges[vertical], cost);
+            }
+            if (horizontal >= 0)
+            {
+                neighbourChanges[horizontal] = std::min(neighbourChanges[horizontal], cost);
+            }
+            if (vertical >= 0 && horizontal >= 0)
+            {
+                // NE, SE, SW and NW sit between their two sides
+                int diagonal = vertical == 0 ? (horizontal == 2 ? 1 : 7) : (horizontal == 2 ? 3 : 5);
+                neighbourChanges[diagonal] = std::min(neighbourChanges[diagonal], cost);
+            }
+        }
+    }
+}
+
+void FlowField::BuildDirections(int firstRow, int lastRow)
+{
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        for (int column = 0; column < width; column++)
+        {
+            uint8_t &direction = directions[row * width + column];
+            if (integration[row * width + column] == INFINITE)
+            {
+                direction = UNREACHABLE;
+                continue;
+            }
+            if (column == goal.x && row == goal.y)
+            {
+                direction = AT_GOAL;
+                continue;
+            }
+            // the neighbour the integration came from
+            float best = INFINITE;
+            direction = UNREACHABLE;
+            uint8_t mask = moves[row * width + column];
+            for (int step = 0; step < 8; step++)
+            {
+                if (!(mask >> step & 1))
+                {
+                    continue;
+                }
+                int next = (row + STEP_Y[step]) * width + column + STEP_X[step];
+                float cost = integration[next] + enterCosts[next] * STEP_LENGTH[step];
+                if (cost < best)
+                {
+                    best = cost;
+                    direction = static_cast<uint8_t>(step);
+                }
+            }
+        }
+    }
+}
+
+void FlowField::Build(const TerrainMap &terrainMap, glm::ivec2 goalTile)
+{
+    terrain = &terrainMap;
+    goal = goalTile;
+    width = terrainMap.GetWidth();
+    height = terrainMap.GetHeight();
+    chunksX = (width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    chunksY = (height + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    integration.assign(static_cast<size_t>(width) * height, INFINITE);
+    directions.assign(static_cast<size_t>(width) * height, static_cast<uint8_t>(UNREACHABLE));
+    roundCount = 0;
+    chunkSolveCount = 0;
+    if (terrainMap.IsBlocked(goal.x, goal.y))
+    {
+        return;
+    }
+
+    enterCosts.resize(integration.size());
+    moves.resize(integration.size());
+    JobSystem::ParallelFor(height, 32, [&](size_t begin, size_t end)
+                           { PrepareTiles(static_cast<int>(begin), static_cast<int>(end) - 1); });
+
+    const int goalChunk = (goal.y >> CHUNK_SHIFT) * chunksX + (goal.x >> CHUNK_SHIFT);
+    // queued chunks and the lowest border value that changed next to them
+    std::vector<float> keys(static_cast<size_t>(chunksX) * chunksY, INFINITE);
+    std::vector<int> queue(1, goalChunk);
+    keys[goalChunk] = 0.0f;
+    std::vector<int> active;
+    std::vector<float> rings;
+    std::vector<float> changes;
+
+    while (!queue.empty())
+    {
+        roundCount++;
+        float lowest = INFINITE;
+        for (int chunk : queue)
+        {
+            lowest = std::min(lowest, keys[chunk]);
+        }
+        active.clear();
+        size_t kept = 0;
+        for (int chunk : queue)
+        {
+            if (keys[chunk] <= lowest + BAND)
+            {
+                keys[chunk] = INFINITE;
+                active.push_back(chunk);
+            }
+            else
+            {
+                queue[kept++] = chunk;
+            }
+        }
+        queue.resize(kept);
+        chunkSolveCount += static_cast<int>(active.size());
+
+        // read every ring before any chunk of the round writes, so chunks
+        // never see a neighbour halfway through its update
+        rings.resize(active.size() * RING_SIZE);
+        JobSystem::ParallelFor(active.size(), 16, [&](size_t begin, size_t end)
+                               {
+                                   for (size_t i = begin; i < end; i++)
+                                   {
+                                       ChunkRect rect;
+                                       rect.firstColumn = (active[i] % chunksX) << CHUNK_SHIFT;
+                                       rect.firstRow = (active[i] / chunksX) << CHUNK_SHIFT;
+                                       rect.columns = std::min(CHUNK_SIZE, width - rect.firstColumn);
+                                       rect.rows = std::min(CHUNK_SIZE, height - rect.firstRow);
+                                       float *ring = &rings[i * RING_SIZE];
+                                       ForEachRingTile(rect, [&](int index, int column, int row)
+                                                       { ring[index] = terrain->IsInside(column, row) ? integration[row * width + column] : INFINITE; });
+                                   }
+                               });
+
+        changes.resize(active.size() * 8);
+        const bool firstRound = roundCount == 1;
+        JobSystem::ParallelFor(active.size(), 1, [&](size_t begin, size_t end)
+                               {
+                                   for (size_t i = begin; i < end; i++)
+                                   {
+                                       SolveChunk(active[i], &rings[i * RING_SIZE], firstRound, &changes[i * 8]);
+                                   }
+                               });
+
+        for (size_t i = 0; i < active.size(); i++)
+        {
+            int chunkX = active[i] % chunksX;
+            int chunkY = active[i] / chunksX;
+            for (int direction = 0; direction < 8; direction++)
+            {
+                float change = changes[i * 8 + direction];
+                int x = chunkX + STEP_X[direction];
+                int y = chunkY + STEP_Y[direction];
+                if (change == INFINITE || x < 0 || y < 0 || x >= chunksX || y >= chunksY)
+                {
+                    continue;
+                }
+                int neighbour = y * chunksX + x;
+                if (keys[neighbour] == INFINITE)
+                {
+                    queue.push_back(neighbour);
+                }
+                keys[neighbour] = std::min(keys[neighbour], change);
+            }
+        }
+    }
+
+    JobSystem::ParallelFor(height, 32, [&](size_t begin, size_t end)
+                           { BuildDirections(static_cast<int>(begin), static_cast<int>(end) - 1); });
+    std::vector<float>().swap(enterCosts);
+    std::vector<uint8_t>().swap(moves);
+}
+
+float FlowField::GetCost(int column, int row) const
+{
+    if (!terrain || !terrain->IsInside(column, row))
+    {
+        return INFINITE;
+    }
+    return integration[row * width + column];
+}
+
+uint8_t FlowField::GetDirectionIndex(int column, int row) const
+{
+    if (!terrain || !terrain->IsInside(column, row))
+    {
+        return UNREACHABLE;
+    }
+    return directions[row * width + column];
+}
+
+glm::vec2 FlowField::GetDirection(int column, int row) const
+{
+    static const glm::vec2 UNIT[8] = {
+        glm::vec2(0.0f, -1.0f), glm::normalize(glm::vec2(1.0f, -1.0f)),
+        glm::vec2(1.0f, 0.0f), glm::normalize(glm::vec2(1.0f, 1.0f)),
+        glm::vec2(0.0f, 1.0f), glm::normalize(glm::vec2(-1.0f, 1.0f)),
+        glm::vec2(-1.0f, 0.0f), glm::normalize(glm::vec2(-1.0f, -1.0f))};
+    uint8_t direction = GetDirectionIndex(column, row);
+    return direction < 8 ? UNIT[direction] : glm::vec2(0.0f);
+}
+
+glm::vec2 FlowField::Sample(glm::vec2 position) const
+{
+    if (!terrain)
+    {
+        return glm::vec2(0.0f);
+    }
+    float tileSize = terrain->GetTileSize();
+    return GetDirection(static_cast<int>(std::floor(position.x / tileSize)), static_cast<int>(std::floor(position.y / tileSize)));
+}
@@ -0,0 +1,80 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../Terrain/TerrainMap.h"
+
+// Directions toward one goal tile for every tile of the map, so any number
+// of units heading to the same place can each just look up where to go.
+//
+// Build() first fills the integration field (the cost of the cheapest way
+// from each tile to the goal, Dijkstra from the goal outwards) and then the
+// direction field (which neighbour each tile should step to). Road tiles
+// cost half as much to cross as plain ground; movement rules match
+// GridPathfinder: 8 directions, no corner cutting.
+//
+// The integration runs in chunk wavefronts: every chunk solves its own
+// tiles exactly from the values on the ring of tiles around it, and
+// whenever a chunk improves its border its neighbours are queued, keyed by
+// the lowest value that changed. Each round takes the queued chunks whose
+// key lies within one band of the lowest key and solves them in parallel
+// on the JobSystem; the band keeps chunks from being solved early from
+// poor values and again once the real front arrives. The rounds repeat
+// until nothing improves, which gives the same field as one global
+// Dijkstra.
+class FlowField
+{
+private:
+    const TerrainMap *terrain;
+    glm::ivec2 goal;
+    int width;
+    int height;
+    int chunksX;
+    int chunksY;
+    std::vector<float> integration;
+    std::vector<uint8_t> directions;
+    int roundCount;
+    int chunkSolveCount;
+
+    // only needed while building: the cost of stepping onto each tile
+    // (infinite if blocked) and a bit per direction the tile can step in
+    std::vector<float> enterCosts;
+    std::vector<uint8_t> moves;
+
+    void PrepareTiles(int firstRow, int lastRow);
+    // neighbourChanges gets, for each of the 8 neighbouring chunks, the
+    // smallest new value on the edge tiles next to it (infinite if none improved)
+    void SolveChunk(int chunk, const float *ring, bool seedGoal, float *neighbourChanges);
+    void BuildDirections(int firstRow, int lastRow);
+
+public:
+    static const int CHUNK_SHIFT = 5;
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    // direction index of the goal tile itself, and of tiles that cannot reach it
+    static const uint8_t AT_GOAL = 8;
+    static const uint8_t UNREACHABLE = 255;
+
+    FlowField();
+
+    void Build(const TerrainMap &terrainMap, glm::ivec2 goalTile);
+
+    glm::ivec2 GetGoal() const { return goal; }
+    // wavefront rounds the last build needed
+    int GetRoundCount() const { return roundCount; }
+    // chunk solves over all rounds of the last build
+    int GetChunkSolveCount() const { return chunkSolveCount; }
+
+    // integration value, infinite if the goal cannot be reached from there
+    float GetCost(int column, int row) const;
+    // 0..7 clockwise from north, or AT_GOAL / UNREACHABLE
+    uint8_t GetDirectionIndex(int column, int row) const;
+    // unit vector toward the next tile, zero at the goal, off the map and
+    // where the goal cannot be reached
+    glm::vec2 GetDirection(int column, int row) const;
+    // same for a world (pixel) position
+    glm::vec2 Sample(glm::vec2 position) const;
+};
+
+#endif
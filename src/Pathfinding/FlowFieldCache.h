@@ -0,0 +1,83 @@
+#ifndef FLOWFIELDCACHE_H
+#define FLOWFIELDCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "FlowField.h"
+#include "../Terrain/TerrainMap.h"
+
+// Flow fields by goal tile, so every group sent to the same place shares one
+// field. Least recently used fields are dropped once there are more than the
+// capacity; units keep theirs alive through the shared_ptr until they let go.
+// Not thread-safe: GetField builds on the calling thread and changes the
+// LRU state, so only the thread giving the orders may call it.
+class FlowFieldCache
+{
+private:
+    struct Entry
+    {
+        std::shared_ptr<const FlowField> field;
+        uint64_t lastUsed;
+    };
+
+    const TerrainMap *terrain;
+    size_t capacity;
+    std::unordered_map<int, Entry> entries;
+    uint64_t useCounter;
+    size_t buildCount;
+
+public:
+    FlowFieldCache(size_t capacity = 16) : terrain(nullptr), capacity(capacity), useCounter(0), buildCount(0) {}
+
+    void SetTerrain(const TerrainMap *newTerrain)
+    {
+        terrain = newTerrain;
+        Invalidate();
+    }
+
+    // every field is stale once the terrain changed
+    void Invalidate() { entries.clear(); }
+
+    // the field toward the goal tile, built on first use; nullptr without a terrain
+    std::shared_ptr<const FlowField> GetField(glm::ivec2 goal)
+    {
+        if (!terrain)
+        {
+            return nullptr;
+        }
+        int key = goal.y * terrain->GetWidth() + goal.x;
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            found->second.lastUsed = ++useCounter;
+            return found->second.field;
+        }
+
+        if (entries.size() >= capacity)
+        {
+            auto oldest = entries.begin();
+            for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+            {
+                if (entry->second.lastUsed < oldest->second.lastUsed)
+                {
+                    oldest = entry;
+                }
+            }
+            entries.erase(oldest);
+        }
+
+        auto field = std::make_shared<FlowField>();
+        field->Build(*terrain, goal);
+        buildCount++;
+        entries[key] = {field, ++useCounter};
+        return field;
+    }
+
+    size_t GetSize() const { return entries.size(); }
+    // fields built so far, a hit costs nothing
+    size_t GetBuildCount() const { return buildCount; }
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include "GridPathfinder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+    // N, NE, E, SE, S, SW, W, NW: straight directions are even, diagonals odd
+    const int DIRECTION_X[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    const int DIRECTION_Y[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    const float SQRT2 = 1.41421356f;
+
+    int Sign(int value)
+    {
+        return (value > 0) - (value < 0);
+    }
+
+    int DirectionOf(int dx, int dy)
+    {
+        for (int direction = 0; direction < 8; direction++)
+        {
+            if (DIRECTION_X[direction] == dx && DIRECTION_Y[direction] == dy)
+            {
+                return direction;
+            }
+        }
+        return -1;
+    }
+
+    float Octile(int x, int y, glm::ivec2 goal)
+    {
+        int dx = std::abs(x - goal.x);
+        int dy = std::abs(y - goal.y);
+        return static_cast<float>(dx + dy) + (SQRT2 - 2.0f) * static_cast<float>(std::min(dx, dy));
+    }
+}
+
+GridPathfinder::SearchContext::SearchContext()
+    : open(HeapIndexOf{&records}), generation(0), lastCost(0.0f), lastExpanded(0), goal(0), jump(true)
+{
+}
+
+GridPathfinder::GridPathfinder()
+    : terrain(nullptr), width(0), height(0)
+{
+}
+
+bool GridPathfinder::CanStep(int x, int y, int direction) const
+{
+    int dx = DIRECTION_X[direction];
+    int dy = DIRECTION_Y[direction];
+    if (!IsWalkable(x + dx, y + dy))
+    {
+        return false;
+    }
+    return (direction & 1) == 0 || (IsWalkable(x + dx, y) && IsWalkable(x, y + dy));
+}
+
+bool GridPathfinder::IsStraightJumpPoint(int x, int y, int direction) const
+{
+    // (x, y) was entered moving in the direction; it is a jump point when a
+    // tile beside it opens up right after a blocked one, since that tile
+    // can only be reached optimally by turning here
+    int dx = DIRECTION_X[direction];
+    int dy = DIRECTION_Y[direction];
+    if (dx != 0)
+    {
+        return (IsWalkable(x, y - 1) && !IsWalkable(x - dx, y - 1)) ||
+               (IsWalkable(x, y + 1) && !IsWalkable(x - dx, y + 1));
+    }
+    return (IsWalkable(x - 1, y) && !IsWalkable(x - 1, y - dy)) ||
+           (IsWalkable(x + 1, y) && !IsWalkable(x + 1, y - dy));
+}
+
+void GridPathfinder::BuildDirection(int direction)
+{
+    // walk against the direction so the tile one step ahead is always done
+    int dx = DIRECTION_X[direction];
+    int dy = DIRECTION_Y[direction];
+    int horizontal = dx > 0 ? 2 : 6;
+    int vertical = dy > 0 ? 4 : 0;
+    for (int row = 0; row < height; row++)
+    {
+        int y = dy > 0 ? height - 1 - row : row;
+        for (int column = 0; column < width; column++)
+        {
+            int x = dx > 0 ? width - 1 - column : column;
+            int16_t &distance = jumpDistances[(y * width + x) * DIRECTIONS + direction];
+            if (!IsWalkable(x, y) || !CanStep(x, y, direction))
+            {
+                distance = 0;
+                continue;
+            }
+
+            const int16_t *next = &jumpDistances[((y + dy) * width + x + dx) * DIRECTIONS];
+            bool jumpPoint;
+            if ((direction & 1) == 0)
+            {
+                jumpPoint = IsStraightJumpPoint(x + dx, y + dy, direction);
+            }
+            else
+            {
+                // a diagonal run stops where one of its straight parts finds a jump point
+                jumpPoint = next[horizontal] > 0 || next[vertical] > 0;
+            }
+
+            if (jumpPoint)
+            {
+                distance = 1;
+            }
+            else
+            {
+                distance = next[direction] > 0 ? next[direction] + 1 : next[direction] - 1;
+            }
+        }
+    }
+}
+
+void GridPathfinder::Build(const TerrainMap &terrainMap)
+{
+    terrain = &terrainMap;
+    width = terrainMap.GetWidth();
+    height = terrainMap.GetHeight();
+
+    // distances are stored in 16 bits, which covers maps up to 32767 tiles across
+    jumpDistances.assign(static_cast<size_t>(width) * height * DIRECTIONS, 0);
+    for (int direction = 0; direction < DIRECTIONS; direction += 2)
+    {
+        BuildDirection(direction);
+    }
+    for (int direction = 1; direction < DIRECTIONS; direction += 2)
+    {
+        BuildDirection(direction);
+    }
+
+    context.records.assign(static_cast<size_t>(width) * height, NodeRecord());
+    context.generation = 0;
+}
+
+GridPathfinder::NodeRecord &GridPathfinder::Touch(SearchContext &search, int node) const
+{
+    NodeRecord &record = search.records[node];
+    if (record.generation != search.generation)
+    {
+        record.generation = search.generation;
+        record.heapIndex = NOT_OPEN;
+        record.cost = std::numeric_limits<float>::infinity();
+        record.parent = -1;
+    }
+    return record;
+}
+
+void GridPathfinder::PrepareContext(SearchContext &search) const
+{
+    size_t tiles = static_cast<size_t>(width) * height;
+    if (search.records.size() != tiles)
+    {
+        // a context first used on this map
+        search.records.assign(tiles, NodeRecord());
+        search.generation = 0;
+    }
+}
+
+void GridPathfinder::BeginQuery(SearchContext &search) const
+{
+    PrepareContext(search);
+    search.generation++;
+    if (search.generation == 0)
+    {
+        // the id wrapped around, old records could look current again
+        for (auto &record : search.records)
+        {
+            record.generation = 0;
+        }
+        search.generation = 1;
+    }
+    search.open.Clear();
+    search.lastExpanded = 0;
+}
+
+void GridPathfinder::Relax(SearchContext &search, int node, int successor, float stepCost, glm::ivec2 goal) const
+{
+    NodeRecord &record = Touch(search, successor);
+    if (record.heapIndex == CLOSED)
+    {
+        return;
+    }
+    float cost = search.records[node].cost + stepCost;
+    if (cost >= record.cost)
+    {
+        return;
+    }
+    record.cost = cost;
+    record.parent = node;
+    float estimate = cost + Octile(successor % width, successor / width, goal);
+    if (record.heapIndex == NOT_OPEN)
+    {
+        search.open.Push(successor, estimate);
+    }
+    else
+    {
+        search.open.DecreaseKey(successor, estimate);
+    }
+}
+
+void GridPathfinder::ExpandNeighbors(SearchContext &search, int node, glm::ivec2 goal) const
+{
+    int x = node % width;
+    int y = node / width;
+    for (int direction = 0; direction < DIRECTIONS; direction++)
+    {
+        if (CanStep(x, y, direction))
+        {
+            int successor = node + DIRECTION_Y[direction] * width + DIRECTION_X[direction];
+            Relax(search, node, successor, (direction & 1) ? SQRT2 : 1.0f, goal);
+        }
+    }
+}
+
+void GridPathfinder::ExpandJump(SearchContext &search, int node, glm::ivec2 goal) const
+{
+    int x = node % width;
+    int y = node / width;
+
+    // the start looks everywhere; otherwise a straight arrival goes on, turns
+    // 45 or 90 degrees, and a diagonal one goes on or follows either of its parts
+    int first = 0;
+    int last = DIRECTIONS - 1;
+    int parent = search.records[node].parent;
+    if (parent >= 0)
+    {
+        int arrival = DirectionOf(Sign(x - parent % width), Sign(y - parent / width));
+        int spread = (arrival & 1) ? 1 : 2;
+        first = arrival - spread;
+        last = arrival + spread;
+    }
+
+    const int16_t *distances = &jumpDistances[node * DIRECTIONS];
+    int toGoalX = goal.x - x;
+    int toGoalY = goal.y - y;
+    for (int turn = first; turn <= last; turn++)
+    {
+        int direction = turn & 7;
+        int dx = DIRECTION_X[direction];
+        int dy = DIRECTION_Y[direction];
+        int distance = distances[direction];
+        int reach = std::abs(distance);
+
+        int steps = 0;
+        if ((direction & 1) == 0)
+        {
+            // the goal on this line and no further than the run reaches
+            bool inLine = dx != 0 ? (toGoalY == 0 && Sign(toGoalX) == dx) : (toGoalX == 0 && Sign(toGoalY) == dy);
+            int goalSteps = dx != 0 ? std::abs(toGoalX) : std::abs(toGoalY);
+            if (inLine && goalSteps <= reach)
+            {
+                steps = goalSteps;
+            }
+        }
+        else if (Sign(toGoalX) == dx && Sign(toGoalY) == dy)
+        {
+            // stop on the goal's row or column, from there a straight run can reach it
+            int goalSteps = std::min(std::abs(toGoalX), std::abs(toGoalY));
+            if (goalSteps <= reach)
+            {
+                steps = goalSteps;
+            }
+        }
+        if (steps == 0 && distance > 0)
+        {
+            steps = distance;
+        }
+        if (steps == 0)
+        {
+            continue;
+        }
+
+        int successor = node + steps * (dy * width + dx);
+        Relax(search, node, successor, static_cast<float>(steps) * ((direction & 1) ? SQRT2 : 1.0f), goal);
+    }
+}
+
+bool GridPathfinder::Begin(SearchContext &search, glm::ivec2 start, glm::ivec2 goal, bool jump) const
+{
+    search.lastCost = 0.0f;
+    search.lastExpanded = 0;
+    search.open.Clear();
+    if (!terrain || !IsWalkable(start.x, start.y) || !IsWalkable(goal.x, goal.y))
+    {
+        return false;
+    }
+
+    BeginQuery(search);
+    search.goal = goal;
+    search.jump = jump;
+    int startNode = start.y * width + start.x;
+    Touch(search, startNode).cost = 0.0f;
+    search.open.Push(startNode, Octile(start.x, start.y, goal));
+    return true;
+}
+
+GridPathfinder::SearchStatus GridPathfinder::ContinuePath(SearchContext &search, int maxExpansions, std::vector<glm::ivec2> &path) const
+{
+    path.clear();
+    const glm::ivec2 goal = search.goal;
+    const int goalNode = goal.y * width + goal.x;
+    for (int expanded = 0; expanded < maxExpansions; expanded++)
+    {
+        if (search.open.IsEmpty())
+        {
+            return SEARCH_FAILED;
+        }
+        int node = search.open.Pop();
+        search.records[node].heapIndex = CLOSED;
+        search.lastExpanded++;
+        if (node == goalNode)
+        {
+            for (int step = goalNode; step >= 0; step = search.records[step].parent)
+            {
+                path.push_back(glm::ivec2(step % width, step / width));
+            }
+            std::reverse(path.begin(), path.end());
+            search.lastCost = search.records[goalNode].cost;
+            search.open.Clear();
+            return SEARCH_FOUND;
+        }
+        if (search.jump)
+        {
+            ExpandJump(search, node, goal);
+        }
+        else
+        {
+            ExpandNeighbors(search, node, goal);
+        }
+    }
+    return search.open.IsEmpty() ? SEARCH_FAILED : SEARCH_RUNNING;
+}
+
+bool GridPathfinder::Search(SearchContext &search, glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path, bool jump) const
+{
+    path.clear();
+    if (!Begin(search, start, goal, jump))
+    {
+        return false;
+    }
+    return ContinuePath(search, std::numeric_limits<int>::max(), path) == SEARCH_FOUND;
+}
+
+bool GridPathfinder::BeginPath(glm::ivec2 start, glm::ivec2 goal, SearchContext &search) const
+{
+    return Begin(search, start, goal, true);
+}
+
+bool GridPathfinder::FindPath(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path)
+{
+    return Search(context, start, goal, path, true);
+}
+
+bool GridPathfinder::FindPath(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path, SearchContext &search) const
+{
+    return Search(search, start, goal, path, true);
+}
+
+bool GridPathfinder::FindPathAStar(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path)
+{
+    return Search(context, start, goal, path, false);
+}
@@ -0,0 +1,137 @@
+#ifndef GRIDPATHFINDER_H
+#define GRIDPATHFINDER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "IndexedHeap.h"
+#include "../Terrain/TerrainMap.h"
+
+// Shortest paths on the tile grid of a TerrainMap, 8-connected with
+// diagonal steps of cost sqrt(2) that may not cut the corner of a blocked
+// tile.
+//
+// FindPath is Jump Point Search with the jump distances precomputed (JPS+):
+// Build() stores, for every tile and each of the 8 directions, how far the
+// search may jump before it reaches a jump point or a wall, so a query only
+// ever touches jump points. FindPathAStar is plain A* over the same grid and
+// is kept as the reference the jump search is checked against.
+//
+// Per-node search state lives in flat arrays indexed by tile. Every record
+// carries the id of the query that last wrote it, so a new query just bumps
+// the id instead of clearing the arrays. The arrays belong to a
+// SearchContext; the jump distances are only read by queries, so threads
+// with a context each can search the same built pathfinder at once.
+class GridPathfinder
+{
+private:
+    struct NodeRecord
+    {
+        uint32_t generation = 0;
+        // position in the open heap, or NOT_OPEN / CLOSED
+        int heapIndex = 0;
+        float cost = 0.0f;
+        int parent = -1;
+    };
+
+    struct HeapIndexOf
+    {
+        std::vector<NodeRecord> *records;
+        int &operator()(int node) const { return (*records)[node].heapIndex; }
+    };
+
+    static const int NOT_OPEN = -1;
+    static const int CLOSED = -2;
+    static const int DIRECTIONS = 8;
+
+public:
+    enum SearchStatus
+    {
+        SEARCH_FOUND,
+        SEARCH_FAILED,
+        // ran out of expansions, ContinuePath carries on from there
+        SEARCH_RUNNING
+    };
+
+    class SearchContext
+    {
+    private:
+        friend class GridPathfinder;
+        std::vector<NodeRecord> records;
+        IndexedHeap<HeapIndexOf> open;
+        uint32_t generation;
+        float lastCost;
+        int lastExpanded;
+        // the search in progress
+        glm::ivec2 goal;
+        bool jump;
+
+    public:
+        SearchContext();
+        SearchContext(const SearchContext &) = delete;
+        SearchContext &operator=(const SearchContext &) = delete;
+
+        // length of the last path found with this context, in tiles
+        float GetLastCost() const { return lastCost; }
+        int GetLastExpandedCount() const { return lastExpanded; }
+    };
+
+private:
+
+    const TerrainMap *terrain;
+    int width;
+    int height;
+    // jumpDistances[tile * 8 + direction]: > 0 jump point that many steps
+    // away, <= 0 a wall after -distance free steps
+    std::vector<int16_t> jumpDistances;
+    // used by the FindPath overloads without a context
+    SearchContext context;
+
+    bool IsWalkable(int x, int y) const { return !terrain->IsBlocked(x, y); }
+    // a diagonal step also needs both tiles it squeezes between
+    bool CanStep(int x, int y, int direction) const;
+    bool IsStraightJumpPoint(int x, int y, int direction) const;
+    void BuildDirection(int direction);
+
+    NodeRecord &Touch(SearchContext &search, int node) const;
+    void BeginQuery(SearchContext &search) const;
+    void Relax(SearchContext &search, int node, int successor, float stepCost, glm::ivec2 goal) const;
+    bool Begin(SearchContext &search, glm::ivec2 start, glm::ivec2 goal, bool jump) const;
+    bool Search(SearchContext &search, glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path, bool jump) const;
+    void ExpandJump(SearchContext &search, int node, glm::ivec2 goal) const;
+    void ExpandNeighbors(SearchContext &search, int node, glm::ivec2 goal) const;
+
+public:
+    GridPathfinder();
+    GridPathfinder(const GridPathfinder &) = delete;
+    GridPathfinder &operator=(const GridPathfinder &) = delete;
+
+    // precomputes the jump distances; call again after the terrain changed
+    void Build(const TerrainMap &terrainMap);
+
+    // path from start to goal in tiles, both included. consecutive points
+    // are one straight or diagonal run apart. false if there is no path
+    bool FindPath(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path);
+    // same, with the caller's search state; safe to call from several
+    // threads at once as long as each brings its own context
+    bool FindPath(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path, SearchContext &search) const;
+    // the same search in slices, for a caller with a time budget: BeginPath
+    // sets it up in the context (false if start or goal is blocked), then
+    // each ContinuePath expands at most maxExpansions nodes and returns
+    // SEARCH_RUNNING until the path is found or there is none. the context
+    // belongs to that search until then, and the terrain must not change
+    bool BeginPath(glm::ivec2 start, glm::ivec2 goal, SearchContext &search) const;
+    // sizes the context's per-tile arrays for this map, which the first
+    // search with it would otherwise do; they are megabytes on a big map
+    void PrepareContext(SearchContext &search) const;
+    SearchStatus ContinuePath(SearchContext &search, int maxExpansions, std::vector<glm::ivec2> &path) const;
+    // same search without jump points, every point is one step from the next
+    bool FindPathAStar(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &path);
+
+    // length of the last path found, in tiles
+    float GetLastCost() const { return context.GetLastCost(); }
+    // nodes taken off the open list by the last query
+    int GetLastExpandedCount() const { return context.GetLastExpandedCount(); }
+};
+
+#endif
@@ -0,0 +1,611 @@
+#include "HierarchicalPathfinder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+    const int STEP_X[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    const int STEP_Y[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    const float SQRT2 = 1.41421356f;
+    const float UNREACHABLE = std::numeric_limits<float>::infinity();
+    const float DEFAULT_HEURISTIC_WEIGHT = 1.2f;
+
+    // an open stretch of border shorter than this gets one entrance in the
+    // middle, a longer one an entrance at each end
+    const int LONG_ENTRANCE = 6;
+
+    float Octile(glm::ivec2 a, glm::ivec2 b)
+    {
+        int dx = std::abs(a.x - b.x);
+        int dy = std::abs(a.y - b.y);
+        return static_cast<float>(dx + dy) + (SQRT2 - 2.0f) * static_cast<float>(std::min(dx, dy));
+    }
+}
+
+HierarchicalPathfinder::HierarchicalPathfinder()
+    : terrain(nullptr), clusterSize(0), maxNodesPerCluster(0), clustersX(0), clustersY(0), rebuiltClusters(0),
+      open(HeapIndexOf{&records}), generation(0), heuristicWeight(DEFAULT_HEURISTIC_WEIGHT), lastCost(0.0f), lastExpanded(0),
+      localOpen(LocalHeapIndexOf{&localHeapIndex})
+{
+}
+
+int HierarchicalPathfinder::LocalIndexOf(const Cluster &cluster, int tile) const
+{
+    for (size_t i = 0; i < cluster.tiles.size(); i++)
+    {
+        if (cluster.tiles[i] == tile)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+glm::ivec2 HierarchicalPathfinder::TileOfNode(int node, glm::ivec2 start, glm::ivec2 goal) const
+{
+    int startNode = static_cast<int>(clusters.size()) * maxNodesPerCluster;
+    if (node == startNode)
+    {
+        return start;
+    }
+    if (node == startNode + 1)
+    {
+        return goal;
+    }
+    int tile = clusters[node / maxNodesPerCluster].tiles[node % maxNodesPerCluster];
+    return glm::ivec2(tile % GetWidth(), tile / GetWidth());
+}
+
+void HierarchicalPathfinder::AddTransitions(std::vector<Transition> &transitions, int fixedA, int fixedB, int from, int to, bool vertical)
+{
+    // fixedA / fixedB: the column (vertical border) or row (horizontal border)
+    // on this side and on the far side; from..to runs along the border
+    auto tileAt = [&](int fixed, int along)
+    {
+        return vertical ? along * GetWidth() + fixed : fixed * GetWidth() + along;
+    };
+    auto isOpen = [&](int along)
+    {
+        return vertical ? !terrain->IsBlocked(fixedA, along) && !terrain->IsBlocked(fixedB, along)
+                        : !terrain->IsBlocked(along, fixedA) && !terrain->IsBlocked(along, fixedB);
+    };
+
+    int runStart = -1;
+    for (int along = from; along <= to + 1; along++)
+    {
+        bool openHere = along <= to && isOpen(along);
+        if (openHere && runStart < 0)
+        {
+            runStart = along;
+        }
+        else if (!openHere && runStart >= 0)
+        {
+            int runEnd = along - 1;
+            if (runEnd - runStart + 1 < LONG_ENTRANCE)
+            {
+                int middle = (runStart + runEnd) / 2;
+                transitions.push_back({tileAt(fixedA, middle), tileAt(fixedB, middle)});
+            }
+            else
+            {
+                transitions.push_back({tileAt(fixedA, runStart), tileAt(fixedB, runStart)});
+                transitions.push_back({tileAt(fixedA, runEnd), tileAt(fixedB, runEnd)});
+            }
+            runStart = -1;
+        }
+    }
+}
+
+void HierarchicalPathfinder::BuildBorders(int cluster)
+{
+    const Cluster &self = clusters[cluster];
+    eastTransitions[cluster].clear();
+    southTransitions[cluster].clear();
+    if (cluster % clustersX + 1 < clustersX)
+    {
+        AddTransitions(eastTransitions[cluster], self.lastColumn, self.lastColumn + 1, self.firstRow, self.lastRow, true);
+    }
+    if (cluster / clustersX + 1 < clustersY)
+    {
+        AddTransitions(southTransitions[cluster], self.lastRow, self.lastRow + 1, self.firstColumn, self.lastColumn, false);
+    }
+}
+
+void HierarchicalPathfinder::BuildNodes(int cluster)
+{
+    Cluster &self = clusters[cluster];
+    self.tiles.clear();
+    auto addTile = [&](int tile)
+    {
+        if (LocalIndexOf(self, tile) < 0 && static_cast<int>(self.tiles.size()) < maxNodesPerCluster)
+        {
+            self.tiles.push_back(tile);
+        }
+    };
+    for (const auto &transition : eastTransitions[cluster])
+    {
+        addTile(transition.inside);
+    }
+    for (const auto &transition : southTransitions[cluster])
+    {
+        addTile(transition.inside);
+    }
+    if (cluster % clustersX > 0)
+    {
+        for (const auto &transition : eastTransitions[cluster - 1])
+        {
+            addTile(transition.outside);
+        }
+    }
+    if (cluster / clustersX > 0)
+    {
+        for (const auto &transition : southTransitions[cluster - clustersX])
+        {
+            addTile(transition.outside);
+        }
+    }
+
+    const size_t count = self.tiles.size();
+    self.distances.assign(count * count, UNREACHABLE);
+    for (size_t i = 0; i < count; i++)
+    {
+        SearchCluster(self, self.tiles[i], -1);
+        for (size_t j = 0; j < count; j++)
+        {
+            self.distances[i * count + j] = LocalDistance(self, self.tiles[j]);
+        }
+    }
+}
+
+void HierarchicalPathfinder::LinkNodes(int cluster)
+{
+    Cluster &self = clusters[cluster];
+    self.links.assign(self.tiles.size() * 2, -1);
+    auto link = [&](int tile, int otherTile)
+    {
+        int local = LocalIndexOf(self, tile);
+        int otherCluster = ClusterOfTile(otherTile);
+        int otherLocal = LocalIndexOf(clusters[otherCluster], otherTile);
+        if (local < 0 || otherLocal < 0)
+        {
+            return;
+        }
+        int node = otherCluster * maxNodesPerCluster + otherLocal;
+        int *slots = &self.links[local * 2];
+        if (slots[0] != node && slots[1] != node)
+        {
+            slots[slots[0] < 0 ? 0 : 1] = node;
+        }
+    };
+    for (const auto &transition : eastTransitions[cluster])
+    {
+        link(transition.inside, transition.outside);
+    }
+    for (const auto &transition : southTransitions[cluster])
+    {
+        link(transition.inside, transition.outside);
+    }
+    if (cluster % clustersX > 0)
+    {
+        for (const auto &transition : eastTransitions[cluster - 1])
+        {
+            link(transition.outside, transition.inside);
+        }
+    }
+    if (cluster / clustersX > 0)
+    {
+        for (const auto &transition : southTransitions[cluster - clustersX])
+        {
+            link(transition.outside, transition.inside);
+        }
+    }
+}
+
+void HierarchicalPathfinder::SearchCluster(const Cluster &cluster, int fromTile, int targetTile)
+{
+    const int width = GetWidth();
+    const int clusterWidth = cluster.lastColumn - cluster.firstColumn + 1;
+    const int count = clusterWidth * (cluster.lastRow - cluster.firstRow + 1);
+    auto localOf = [&](int tile)
+    {
+        return (tile / width - cluster.firstRow) * clusterWidth + tile % width - cluster.firstColumn;
+    };
+
+    std::fill(localCost.begin(), localCost.begin() + count, UNREACHABLE);
+    std::fill(localParent.begin(), localParent.begin() + count, -1);
+    std::fill(localHeapIndex.begin(), localHeapIndex.begin() + count, NOT_OPEN);
+    localOpen.Clear();
+
+    int target = targetTile >= 0 ? localOf(targetTile) : -1;
+    int from = localOf(fromTile);
+    localCost[from] = 0.0f;
+    localOpen.Push(from, 0.0f);
+    while (!localOpen.IsEmpty())
+    {
+        int node = localOpen.Pop();
+        localHeapIndex[node] = CLOSED;
+        if (node == target)
+        {
+            return;
+        }
+        int x = cluster.firstColumn + node % clusterWidth;
+        int y = cluster.firstRow + node / clusterWidth;
+        for (int direction = 0; direction < 8; direction++)
+        {
+            int nx = x + STEP_X[direction];
+            int ny = y + STEP_Y[direction];
+            if (nx < cluster.firstColumn || nx > cluster.lastColumn || ny < cluster.firstRow || ny > cluster.lastRow ||
+                terrain->IsBlocked(nx, ny))
+            {
+                continue;
+            }
+            bool diagonal = direction & 1;
+            if (diagonal && (terrain->IsBlocked(nx, y) || terrain->IsBlocked(x, ny)))
+            {
+                continue;
+            }
+            int next = (ny - cluster.firstRow) * clusterWidth + nx - cluster.firstColumn;
+            if (localHeapIndex[next] == CLOSED)
+            {
+                continue;
+            }
+            float cost = localCost[node] + (diagonal ? SQRT2 : 1.0f);
+            if (cost < localCost[next])
+            {
+                localCost[next] = cost;
+                localParent[next] = node;
+                if (localHeapIndex[next] == NOT_OPEN)
+                {
+                    localOpen.Push(next, cost);
+                }
+                else
+                {
+                    localOpen.DecreaseKey(next, cost);
+                }
+            }
+        }
+    }
+}
+
+float HierarchicalPathfinder::LocalDistance(const Cluster &cluster, int tile) const
+{
+    const int width = GetWidth();
+    const int clusterWidth = cluster.lastColumn - cluster.firstColumn + 1;
+    return localCost[(tile / width - cluster.firstRow) * clusterWidth + tile % width - cluster.firstColumn];
+}
+
+void HierarchicalPathfinder::Build(const TerrainMap &terrainMap, int size)
+{
+    terrain = &terrainMap;
+    clusterSize = std::max(size, 2);
+    // a border side holds at most one entrance per two tiles, so this is plenty
+    maxNodesPerCluster = 4 * clusterSize;
+    clustersX = (terrainMap.GetWidth() + clusterSize - 1) / clusterSize;
+    clustersY = (terrainMap.GetHeight() + clusterSize - 1) / clusterSize;
+
+    const int clusterCount = clustersX * clustersY;
+    clusters.assign(clusterCount, Cluster());
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        Cluster &self = clusters[cluster];
+        self.firstColumn = (cluster % clustersX) * clusterSize;
+        self.firstRow = (cluster / clustersX) * clusterSize;
+        self.lastColumn = std::min(self.firstColumn + clusterSize, terrainMap.GetWidth()) - 1;
+        self.lastRow = std::min(self.firstRow + clusterSize, terrainMap.GetHeight()) - 1;
+    }
+    eastTransitions.assign(clusterCount, std::vector<Transition>());
+    southTransitions.assign(clusterCount, std::vector<Transition>());
+    localCost.resize(clusterSize * clusterSize);
+    localParent.resize(clusterSize * clusterSize);
+    localHeapIndex.resize(clusterSize * clusterSize);
+
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        BuildBorders(cluster);
+    }
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        BuildNodes(cluster);
+    }
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        LinkNodes(cluster);
+    }
+    rebuiltClusters = clusterCount;
+
+    records.assign(static_cast<size_t>(clusterCount) * maxNodesPerCluster + 2, NodeRecord());
+    generation = 0;
+}
+
+void HierarchicalPathfinder::OnTilesChanged(int firstColumn, int firstRow, int lastColumn, int lastRow)
+{
+    // one tile of margin: a changed tile also decides whether the diagonal
+    // steps around it cut a corner, and those may belong to the next cluster
+    firstColumn = std::max(firstColumn - 1, 0);
+    firstRow = std::max(firstRow - 1, 0);
+    lastColumn = std::min(lastColumn + 1, terrain->GetWidth() - 1);
+    lastRow = std::min(lastRow + 1, terrain->GetHeight() - 1);
+    if (firstColumn > lastColumn || firstRow > lastRow)
+    {
+        rebuiltClusters = 0;
+        return;
+    }
+
+    const int clusterCount = clustersX * clustersY;
+    // 1 = tiles changed, 2 = node list changed, 3 = links changed
+    std::vector<char> touched(clusterCount, 0);
+    auto mark = [&](int clusterX, int clusterY, char level)
+    {
+        if (clusterX >= 0 && clusterY >= 0 && clusterX < clustersX && clusterY < clustersY)
+        {
+            char &value = touched[clusterY * clustersX + clusterX];
+            value = value == 0 ? level : std::min(value, level);
+        }
+    };
+
+    int firstClusterX = firstColumn / clusterSize;
+    int firstClusterY = firstRow / clusterSize;
+    int lastClusterX = lastColumn / clusterSize;
+    int lastClusterY = lastRow / clusterSize;
+    for (int clusterY = firstClusterY; clusterY <= lastClusterY; clusterY++)
+    {
+        for (int clusterX = firstClusterX; clusterX <= lastClusterX; clusterX++)
+        {
+            mark(clusterX, clusterY, 1);
+        }
+    }
+    // the borders of a changed cluster are shared with its neighbours, whose
+    // nodes change with them; the neighbours of those only need new links
+    for (int clusterY = firstClusterY - 1; clusterY <= lastClusterY + 1; clusterY++)
+    {
+        for (int clusterX = firstClusterX - 1; clusterX <= lastClusterX + 1; clusterX++)
+        {
+            bool sharesBorder = (clusterX >= firstClusterX && clusterX <= lastClusterX) ||
+                                (clusterY >= firstClusterY && clusterY <= lastClusterY);
+            mark(clusterX, clusterY, sharesBorder ? 2 : 3);
+        }
+    }
+    for (int clusterY = firstClusterY - 2; clusterY <= lastClusterY + 2; clusterY++)
+    {
+        for (int clusterX = firstClusterX - 2; clusterX <= lastClusterX + 2; clusterX++)
+        {
+            mark(clusterX, clusterY, 3);
+        }
+    }
+
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        if (touched[cluster] == 1)
+        {
+            BuildBorders(cluster);
+            if (cluster % clustersX > 0)
+            {
+                BuildBorders(cluster - 1);
+            }
+            if (cluster / clustersX > 0)
+            {
+                BuildBorders(cluster - clustersX);
+            }
+        }
+    }
+    rebuiltClusters = 0;
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        if (touched[cluster] == 1 || touched[cluster] == 2)
+        {
+            BuildNodes(cluster);
+            rebuiltClusters++;
+        }
+    }
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        if (touched[cluster] != 0)
+        {
+            LinkNodes(cluster);
+        }
+    }
+}
+
+HierarchicalPathfinder::NodeRecord &HierarchicalPathfinder::Touch(int node)
+{
+    NodeRecord &record = records[node];
+    if (record.generation != generation)
+    {
+        record.generation = generation;
+        record.heapIndex = NOT_OPEN;
+        record.cost = UNREACHABLE;
+        record.parent = -1;
+    }
+    return record;
+}
+
+void HierarchicalPathfinder::BeginQuery()
+{
+    generation++;
+    if (generation == 0)
+    {
+        for (auto &record : records)
+        {
+            record.generation = 0;
+        }
+        generation = 1;
+    }
+    open.Clear();
+    lastExpanded = 0;
+}
+
+void HierarchicalPathfinder::Relax(int node, int successor, float stepCost)
+{
+    NodeRecord &record = Touch(successor);
+    if (record.heapIndex == CLOSED)
+    {
+        return;
+    }
+    float cost = records[node].cost + stepCost;
+    if (cost >= record.cost)
+    {
+        return;
+    }
+    record.cost = cost;
+    record.parent = node;
+    float estimate = cost + heuristicWeight * Octile(TileOfNode(successor, queryStart, queryGoal), queryGoal);
+    if (record.heapIndex == NOT_OPEN)
+    {
+        open.Push(successor, estimate);
+    }
+    else
+    {
+        open.DecreaseKey(successor, estimate);
+    }
+}
+
+bool HierarchicalPathfinder::FindPath(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &waypoints)
+{
+    waypoints.clear();
+    lastCost = 0.0f;
+    lastExpanded = 0;
+    if (!terrain || terrain->IsBlocked(start.x, start.y) || terrain->IsBlocked(goal.x, goal.y))
+    {
+        return false;
+    }
+
+    const int width = GetWidth();
+    const int startCluster = ClusterOf(start.x, start.y);
+    const int goalCluster = ClusterOf(goal.x, goal.y);
+    const int startNode = static_cast<int>(clusters.size()) * maxNodesPerCluster;
+    const int goalNode = startNode + 1;
+
+    // hook start and goal into the graph through the nodes of their clusters
+    const Cluster &first = clusters[startCluster];
+    SearchCluster(first, start.y * width + start.x, -1);
+    startDistances.resize(first.tiles.size());
+    for (size_t i = 0; i < first.tiles.size(); i++)
+    {
+        startDistances[i] = LocalDistance(first, first.tiles[i]);
+    }
+    float direct = startCluster == goalCluster ? LocalDistance(first, goal.y * width + goal.x) : UNREACHABLE;
+
+    const Cluster &last = clusters[goalCluster];
+    SearchCluster(last, goal.y * width + goal.x, -1);
+    goalDistances.resize(last.tiles.size());
+    for (size_t i = 0; i < last.tiles.size(); i++)
+    {
+        goalDistances[i] = LocalDistance(last, last.tiles[i]);
+    }
+
+    BeginQuery();
+    queryStart = start;
+    queryGoal = goal;
+    Touch(startNode).cost = 0.0f;
+    open.Push(startNode, Octile(start, goal));
+    while (!open.IsEmpty())
+    {
+        int node = open.Pop();
+        records[node].heapIndex = CLOSED;
+        lastExpanded++;
+
+        if (node == goalNode)
+        {
+            for (int step = goalNode; step >= 0; step = records[step].parent)
+            {
+                glm::ivec2 tile = TileOfNode(step, start, goal);
+                if (waypoints.empty() || waypoints.back() != tile)
+                {
+                    waypoints.push_back(tile);
+                }
+            }
+            std::reverse(waypoints.begin(), waypoints.end());
+            lastCost = records[goalNode].cost;
+            return true;
+        }
+
+        if (node == startNode)
+        {
+            for (size_t i = 0; i < first.tiles.size(); i++)
+            {
+                if (startDistances[i] < UNREACHABLE)
+                {
+                    Relax(node, startCluster * maxNodesPerCluster + static_cast<int>(i), startDistances[i]);
+                }
+            }
+            if (direct < UNREACHABLE)
+            {
+                Relax(node, goalNode, direct);
+            }
+            continue;
+        }
+
+        const int cluster = node / maxNodesPerCluster;
+        const int local = node % maxNodesPerCluster;
+        const Cluster &self = clusters[cluster];
+        const size_t count = self.tiles.size();
+        for (size_t other = 0; other < count; other++)
+        {
+            float distance = self.distances[local * count + other];
+            if (static_cast<int>(other) != local && distance < UNREACHABLE)
+            {
+                Relax(node, cluster * maxNodesPerCluster + static_cast<int>(other), distance);
+            }
+        }
+        for (int slot = 0; slot < 2; slot++)
+        {
+            if (self.links[local * 2 + slot] >= 0)
+            {
+                Relax(node, self.links[local * 2 + slot], 1.0f);
+            }
+        }
+        if (cluster == goalCluster && goalDistances[local] < UNREACHABLE)
+        {
+            Relax(node, goalNode, goalDistances[local]);
+        }
+    }
+    return false;
+}
+
+bool HierarchicalPathfinder::RefineSegment(glm::ivec2 from, glm::ivec2 to, std::vector<glm::ivec2> &tiles)
+{
+    if (from == to)
+    {
+        return true;
+    }
+    const int width = GetWidth();
+    const int fromCluster = ClusterOf(from.x, from.y);
+    if (fromCluster != ClusterOf(to.x, to.y))
+    {
+        // an entrance pair, one straight step across the border
+        if (std::abs(from.x - to.x) + std::abs(from.y - to.y) != 1)
+        {
+            return false;
+        }
+        tiles.push_back(to);
+        return true;
+    }
+
+    const Cluster &cluster = clusters[fromCluster];
+    SearchCluster(cluster, from.y * width + from.x, to.y * width + to.x);
+    if (LocalDistance(cluster, to.y * width + to.x) == UNREACHABLE)
+    {
+        return false;
+    }
+    const int clusterWidth = cluster.lastColumn - cluster.firstColumn + 1;
+    size_t firstNew = tiles.size();
+    int start = (from.y - cluster.firstRow) * clusterWidth + from.x - cluster.firstColumn;
+    for (int node = (to.y - cluster.firstRow) * clusterWidth + to.x - cluster.firstColumn; node != start; node = localParent[node])
+    {
+        tiles.push_back(glm::ivec2(cluster.firstColumn + node % clusterWidth, cluster.firstRow + node / clusterWidth));
+    }
+    std::reverse(tiles.begin() + firstNew, tiles.end());
+    return true;
+}
+
+int HierarchicalPathfinder::GetNodeCount() const
+{
+    int count = 0;
+    for (const auto &cluster : clusters)
+    {
+        count += static_cast<int>(cluster.tiles.size());
+    }
+    return count;
+}
@@ -0,0 +1,152 @@
+#ifndef HIERARCHICALPATHFINDER_H
+#define HIERARCHICALPATHFINDER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "IndexedHeap.h"
+#include "../Terrain/TerrainMap.h"
+
+// Long-range paths through an abstract graph over the tile grid (HPA*).
+//
+// The map is cut into square clusters. Wherever two neighbouring clusters
+// share an open stretch of border, one or two entrance tile pairs are placed
+// on it; every entrance tile is a node of the abstract graph. Nodes of the
+// same cluster are joined by their precomputed shortest distance inside the
+// cluster, entrance pairs by a single step. A query links start and goal to
+// the nodes of their clusters and searches only this small graph, so its
+// cost follows the number of clusters crossed rather than the number of
+// tiles.
+//
+// FindPath returns the entrance waypoints; RefineSegment turns one leg into
+// tiles when the unit gets there. When tiles change, OnTilesChanged rebuilds
+// the entrances and distances of the clusters around them and nothing else.
+//
+// The abstract search inflates its heuristic by a small weight: paths come
+// out a few percent longer than the best route through the graph, but on
+// big maps the search expands several times fewer nodes.
+//
+// Movement rules match GridPathfinder: 8 directions, no corner cutting.
+class HierarchicalPathfinder
+{
+private:
+    struct Cluster
+    {
+        int firstColumn;
+        int firstRow;
+        int lastColumn;
+        int lastRow;
+        // entrance nodes by local index: their tile, the node on the other
+        // side of the border (up to two, -1 if none) and the n x n distances
+        std::vector<int> tiles;
+        std::vector<int> links;
+        std::vector<float> distances;
+    };
+
+    struct Transition
+    {
+        int inside;
+        int outside;
+    };
+
+    struct NodeRecord
+    {
+        uint32_t generation = 0;
+        int heapIndex = 0;
+        float cost = 0.0f;
+        int parent = -1;
+    };
+
+    struct HeapIndexOf
+    {
+        std::vector<NodeRecord> *records;
+        int &operator()(int node) const { return (*records)[node].heapIndex; }
+    };
+
+    struct LocalHeapIndexOf
+    {
+        std::vector<int> *heapIndices;
+        int &operator()(int node) const { return (*heapIndices)[node]; }
+    };
+
+    static const int NOT_OPEN = -1;
+    static const int CLOSED = -2;
+
+    const TerrainMap *terrain;
+    int clusterSize;
+    // the most nodes one cluster can have, abstract node id = cluster * this + local index
+    int maxNodesPerCluster;
+    int clustersX;
+    int clustersY;
+    std::vector<Cluster> clusters;
+    // entrances on the east and south border of each cluster
+    std::vector<std::vector<Transition>> eastTransitions;
+    std::vector<std::vector<Transition>> southTransitions;
+    int rebuiltClusters;
+
+    // abstract search, START and GOAL are two extra ids after the cluster nodes
+    std::vector<NodeRecord> records;
+    IndexedHeap<HeapIndexOf> open;
+    uint32_t generation;
+    std::vector<float> startDistances;
+    std::vector<float> goalDistances;
+    glm::ivec2 queryStart;
+    glm::ivec2 queryGoal;
+    float heuristicWeight;
+    float lastCost;
+    int lastExpanded;
+
+    // search inside one cluster
+    std::vector<float> localCost;
+    std::vector<int> localParent;
+    std::vector<int> localHeapIndex;
+    IndexedHeap<LocalHeapIndexOf> localOpen;
+
+    int GetWidth() const { return terrain->GetWidth(); }
+    int ClusterOf(int column, int row) const { return (row / clusterSize) * clustersX + column / clusterSize; }
+    int ClusterOfTile(int tile) const { return ClusterOf(tile % GetWidth(), tile / GetWidth()); }
+    int LocalIndexOf(const Cluster &cluster, int tile) const;
+    glm::ivec2 TileOfNode(int node, glm::ivec2 start, glm::ivec2 goal) const;
+
+    void BuildBorders(int cluster);
+    void AddTransitions(std::vector<Transition> &transitions, int fixedA, int fixedB, int from, int to, bool vertical);
+    void BuildNodes(int cluster);
+    void LinkNodes(int cluster);
+    // Dijkstra from the tile inside the cluster; stops early once the target is
+    // settled, or covers the cluster when target is -1
+    void SearchCluster(const Cluster &cluster, int fromTile, int targetTile);
+    float LocalDistance(const Cluster &cluster, int tile) const;
+
+    NodeRecord &Touch(int node);
+    void BeginQuery();
+    void Relax(int node, int successor, float stepCost);
+
+public:
+    HierarchicalPathfinder();
+    HierarchicalPathfinder(const HierarchicalPathfinder &) = delete;
+    HierarchicalPathfinder &operator=(const HierarchicalPathfinder &) = delete;
+
+    void Build(const TerrainMap &terrainMap, int clusterSize = 16);
+    // call after TerrainMap::SetTile for the changed tile rectangle
+    void OnTilesChanged(int firstColumn, int firstRow, int lastColumn, int lastRow);
+
+    // 1 searches the graph exactly, larger values trade path length for speed
+    void SetHeuristicWeight(float weight) { heuristicWeight = weight; }
+
+    // start, entrance waypoints, goal. consecutive waypoints are either in
+    // the same cluster or one step apart across a border. false if there is no path
+    bool FindPath(glm::ivec2 start, glm::ivec2 goal, std::vector<glm::ivec2> &waypoints);
+    // appends the tiles after from up to and including to, for two
+    // consecutive waypoints of a FindPath result
+    bool RefineSegment(glm::ivec2 from, glm::ivec2 to, std::vector<glm::ivec2> &tiles);
+
+    // length of the last path found, in tiles
+    float GetLastCost() const { return lastCost; }
+    // abstract nodes taken off the open list by the last query
+    int GetLastExpandedCount() const { return lastExpanded; }
+    int GetNodeCount() const;
+    // clusters whose nodes were rebuilt by the last Build / OnTilesChanged
+    int GetRebuiltClusterCount() const { return rebuiltClusters; }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef INDEXEDHEAP_H
+#define INDEXEDHEAP_H
+
+#include <vector>
+
+// Binary min-heap of node ids keyed by cost, with decrease-key.
+//
+// The heap does not own the "where is this node in the heap" table, the
+// search does (it lives next to the rest of the node record), and hands in
+// a functor that returns a reference to it: indexOf(node) -> int &.
+template <typename TIndexOf>
+class IndexedHeap
+{
+private:
+    struct Entry
+    {
+        float key;
+        int node;
+    };
+
+    std::vector<Entry> entries;
+    TIndexOf indexOf;
+
+    void Place(int position, const Entry &entry)
+    {
+        entries[position] = entry;
+        indexOf(entry.node) = position;
+    }
+
+    void SiftUp(int position)
+    {
+        Entry entry = entries[position];
+        while (position > 0)
+        {
+            int parent = (position - 1) >> 1;
+            if (entries[parent].key <= entry.key)
+            {
+                break;
+            }
+            Place(position, entries[parent]);
+            position = parent;
+        }
+        Place(position, entry);
+    }
+
+    void SiftDown(int position)
+    {
+        Entry entry = entries[position];
+        const int count = static_cast<int>(entries.size());
+        while (true)
+        {
+            int child = 2 * position + 1;
+            if (child >= count)
+            {
+                break;
+            }
+            if (child + 1 < count && entries[child + 1].key < entries[child].key)
+            {
+                child++;
+            }
+            if (entry.key <= entries[child].key)
+            {
+                break;
+            }
+            Place(position, entries[child]);
+            position = child;
+        }
+        Place(position, entry);
+    }
+
+public:
+    explicit IndexedHeap(TIndexOf indexOf) : indexOf(indexOf) {}
+
+    bool IsEmpty() const { return entries.empty(); }
+    size_t GetSize() const { return entries.size(); }
+    void Clear() { entries.clear(); }
+
+    void Push(int node, float key)
+    {
+        entries.push_back({key, node});
+        SiftUp(static_cast<int>(entries.size()) - 1);
+    }
+
+    // the node must be in the heap and the new key no larger than the old one
+    void DecreaseKey(int node, float key)
+    {
+        int position = indexOf(node);
+        entries[position].key = key;
+        SiftUp(position);
+    }
+
+    // removes the node with the smallest key; its index is left for the caller to mark
+    int Pop()
+    {
+        int node = entries[0].node;
+        Entry last = entries.back();
+        entries.pop_back();
+        if (!entries.empty())
+        {
+            entries[0] = last;
+            SiftDown(0);
+        }
+        return node;
+    }
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include "PathService.h"
+#include <algorithm>
+#include <chrono>
+#include "../Jobs/JobSystem.h"
+
+namespace
+{
+    // nodes a main thread search expands between two looks at the clock
+    const int EXPANSIONS_PER_SLICE = 256;
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+PathService::PathService(size_t cacheCapacity)
+    : pathfinder(nullptr), frameBudgetMs(2.0), useWorkers(true), cacheCapacity(cacheCapacity),
+      nextId(1), sequence(0), cacheGeneration(0), useCounter(0), inFlight(0), resumableStarted(false),
+      searchCount(0), cacheHits(0), sharedCount(0), lastUpdateMs(0.0)
+{
+}
+
+PathService::~PathService()
+{
+    WaitForWorkers();
+}
+
+bool PathService::RunsLater(const QueueEntry &a, const QueueEntry &b)
+{
+    return a.priority != b.priority ? a.priority < b.priority : a.sequence > b.sequence;
+}
+
+uint64_t PathService::KeyOf(glm::ivec2 start, glm::ivec2 goal) const
+{
+    // tile coordinates fit 16 bits, the pathfinder's jump distances need that too
+    return (static_cast<uint64_t>(static_cast<uint16_t>(start.x)) << 48) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(start.y)) << 32) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(goal.x)) << 16) |
+           static_cast<uint64_t>(static_cast<uint16_t>(goal.y));
+}
+
+void PathService::SetPathfinder(const GridPathfinder *newPathfinder)
+{
+    WaitForWorkers();
+    pathfinder = newPathfinder;
+    InvalidateCache();
+    if (pathfinder)
+    {
+        // not in the middle of the first Update's budget
+        pathfinder->PrepareContext(mainSearch);
+    }
+    if (resumable && !pathfinder)
+    {
+        resumable->result = PathResult();
+        resumable->result.status = PATH_FAILED;
+        Finish(*resumable);
+        resumable.reset();
+    }
+}
+
+PathRequestId PathService::Request(glm::ivec2 start, glm::ivec2 goal, int priority)
+{
+    PathRequestId id = nextId++;
+    if (nextId == 0)
+    {
+        nextId = 1;
+    }
+    if (!pathfinder)
+    {
+        PathResult failed;
+        failed.status = PATH_FAILED;
+        finished.push_back({id, failed});
+        return id;
+    }
+
+    uint64_t key = KeyOf(start, goal);
+    auto cached = cache.find(key);
+    if (cached != cache.end())
+    {
+        cached->second.lastUsed = ++useCounter;
+        finished.push_back({id, cached->second.result});
+        cacheHits++;
+        return id;
+    }
+
+    requests[id] = key;
+    auto existing = jobs.find(key);
+    if (existing != jobs.end())
+    {
+        Job &job = *existing->second;
+        job.waiters.push_back(id);
+        sharedCount++;
+        if (!job.dispatched && priority > job.priority)
+        {
+            // queue it again at the new priority, the old entry is skipped once it ran
+            job.priority = priority;
+            queue.push_back({priority, sequence++, existing->second});
+            std::push_heap(queue.begin(), queue.end(), RunsLater);
+        }
+        return id;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->start = start;
+    job->goal = goal;
+    job->key = key;
+    job->priority = priority;
+    job->dispatched = false;
+    job->cacheGeneration = cacheGeneration;
+    job->waiters.push_back(id);
+    jobs[key] = job;
+    queue.push_back({priority, sequence++, job});
+    std::push_heap(queue.begin(), queue.end(), RunsLater);
+    return id;
+}
+
+void PathService::Cancel(PathRequestId id)
+{
+    // answered from the cache but not delivered yet
+    finished.erase(std::remove_if(finished.begin(), finished.end(), [id](const PathCompletion &completion)
+                                  { return completion.id == id; }),
+                   finished.end());
+    auto request = requests.find(id);
+    if (request == requests.end())
+    {
+        return;
+    }
+    auto job = jobs.find(request->second);
+    requests.erase(request);
+    if (job == jobs.end())
+    {
+        return;
+    }
+    auto &waiters = job->second->waiters;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), id), waiters.end());
+    if (waiters.empty() && !job->second->dispatched)
+    {
+        // its queue entries no longer match a job and are skipped
+        jobs.erase(job);
+    }
+}
+
+bool PathService::PopJob(std::shared_ptr<Job> &job)
+{
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), RunsLater);
+        job = std::move(queue.back().job);
+        queue.pop_back();
+        auto current = jobs.find(job->key);
+        if (!job->dispatched && current != jobs.end() && current->second == job)
+        {
+            job->dispatched = true;
+            return true;
+        }
+    }
+    job.reset();
+    return false;
+}
+
+void PathService::Solve(Job &job, GridPathfinder::SearchContext &search) const
+{
+    auto tiles = std::make_shared<std::vector<glm::ivec2>>();
+    bool found = pathfinder->FindPath(job.start, job.goal, *tiles, search);
+    job.result.status = found ? PATH_FOUND : PATH_FAILED;
+    job.result.cost = search.GetLastCost();
+    job.result.tiles = std::move(tiles);
+}
+
+bool PathService::Step()
+{
+    Job &job = *resumable;
+    if (!resumableStarted)
+    {
+        resumableStarted = true;
+        if (!pathfinder->BeginPath(job.start, job.goal, mainSearch))
+        {
+            job.result = PathResult();
+            job.result.status = PATH_FAILED;
+            job.result.tiles = std::make_shared<std::vector<glm::ivec2>>();
+            return true;
+        }
+    }
+    auto tiles = std::make_shared<std::vector<glm::ivec2>>();
+    GridPathfinder::SearchStatus status = pathfinder->ContinuePath(mainSearch, EXPANSIONS_PER_SLICE, *tiles);
+    if (status == GridPathfinder::SEARCH_RUNNING)
+    {
+        return false;
+    }
+    job.result.status = status == GridPathfinder::SEARCH_FOUND ? PATH_FOUND : PATH_FAILED;
+    job.result.cost = mainSearch.GetLastCost();
+    job.result.tiles = std::move(tiles);
+    return true;
+}
+
+void PathService::Dispatch(const std::shared_ptr<Job> &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        inFlight++;
+    }
+    JobSystem::Submit([this, job]()
+                      {
+                          thread_local GridPathfinder::SearchContext search;
+                          Solve(*job, search);
+                          std::lock_guard<std::mutex> lock(doneMutex);
+                          done.push_back(job);
+                          inFlight--;
+                          doneCondition.notify_all();
+                      });
+}
+
+void PathService::Finish(Job &job)
+{
+    searchCount++;
+    auto current = jobs.find(job.key);
+    if (current != jobs.end() && current->second.get() == &job)
+    {
+        jobs.erase(current);
+    }
+    if (job.cacheGeneration == cacheGeneration)
+    {
+        Remember(job.key, job.result);
+    }
+    for (PathRequestId id : job.waiters)
+    {
+        requests.erase(id);
+        finished.push_back({id, job.result});
+    }
+}
+
+void PathService::Remember(uint64_t key, const PathResult &result)
+{
+    if (cacheCapacity == 0)
+    {
+        return;
+    }
+    if (cache.size() >= cacheCapacity && cache.find(key) == cache.end())
+    {
+        auto oldest = cache.begin();
+        for (auto entry = cache.begin(); entry != cache.end(); ++entry)
+        {
+            if (entry->second.lastUsed < oldest->second.lastUsed)
+            {
+                oldest = entry;
+            }
+        }
+        cache.erase(oldest);
+    }
+    cache[key] = {result, ++useCounter};
+}
+
+void PathService::CollectDone()
+{
+    std::vector<std::shared_ptr<Job>> ready;
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        ready.swap(done);
+    }
+    for (auto &job : ready)
+    {
+        Finish(*job);
+    }
+}
+
+void PathService::Update()
+{
+    auto start = std::chrono::steady_clock::now();
+    CollectDone();
+
+    std::shared_ptr<Job> job;
+    unsigned workers = JobSystem::GetWorkerCount();
+    if (useWorkers && workers > 0)
+    {
+        // a couple of searches per worker in flight, the rest wait in the
+        // queue so a later urgent request still goes first
+        const int maxInFlight = 2 * static_cast<int>(workers);
+        if (resumable)
+        {
+            // workers were turned on halfway through a main thread search;
+            // a worker runs it again from the start
+            Dispatch(resumable);
+            resumable.reset();
+        }
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (inFlight >= maxInFlight)
+                {
+                    break;
+                }
+            }
+            if (!PopJob(job))
+            {
+                break;
+            }
+            Dispatch(job);
+        }
+    }
+    else
+    {
+        while (MillisecondsSince(start) < frameBudgetMs)
+        {
+            if (!resumable)
+            {
+                if (!PopJob(resumable))
+                {
+                    break;
+                }
+                resumableStarted = false;
+            }
+            if (Step())
+            {
+                Finish(*resumable);
+                resumable.reset();
+            }
+        }
+    }
+
+    completions.swap(finished);
+    finished.clear();
+    lastUpdateMs = MillisecondsSince(start);
+}
+
+void PathService::WaitForWorkers()
+{
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCondition.wait(lock, [this]()
+                       { return inFlight == 0; });
+}
+
+void PathService::InvalidateCache()
+{
+    cache.clear();
+    cacheGeneration++;
+    // queued searches have not run yet and will see the new terrain
+    for (auto &job : jobs)
+    {
+        if (!job.second->dispatched)
+        {
+            job.second->cacheGeneration = cacheGeneration;
+        }
+    }
+    // nor has the rest of a search cut short, so it starts over on it
+    if (resumable)
+    {
+        resumable->cacheGeneration = cacheGeneration;
+        resumableStarted = false;
+    }
+}
@@ -0,0 +1,170 @@
+#ifndef PATHSERVICE_H
+#define PATHSERVICE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "GridPathfinder.h"
+
+// handle of one path request, 0 is never handed out
+typedef uint32_t PathRequestId;
+
+enum PathStatus
+{
+    PATH_NONE,
+    PATH_PENDING,
+    PATH_FOUND,
+    PATH_FAILED
+};
+
+struct PathResult
+{
+    PathStatus status = PATH_NONE;
+    // JPS+ waypoints from start to goal, shared by every request for the same pair
+    std::shared_ptr<const std::vector<glm::ivec2>> tiles;
+    float cost = 0.0f;
+};
+
+struct PathCompletion
+{
+    PathRequestId id;
+    PathResult result;
+};
+
+// Path requests answered over the next frames instead of on the spot, so
+// ordering many units never stalls a frame.
+//
+// Requests go into a priority queue. Identical start/goal requests still
+// waiting share one search, and recent answers are kept in a small LRU cache
+// that answers repeats without searching at all. Update() hands the queue
+// to the JobSystem workers when there are any, keeping only a few searches
+// in flight so priorities still count; without workers it searches on the
+// calling thread until the frame budget is used up. A search there runs in
+// slices of a few hundred expansions with a look at the clock in between,
+// and one the budget cuts short goes on where it stopped in the next
+// Update, so a long search spreads over frames instead of overrunning one.
+// Either way the answers come out of GetCompletions() after the Update that
+// finished them.
+//
+// Workers read the GridPathfinder, so call WaitForWorkers() before
+// rebuilding it, and InvalidateCache() after.
+class PathService
+{
+private:
+    struct Job
+    {
+        glm::ivec2 start;
+        glm::ivec2 goal;
+        uint64_t key;
+        int priority;
+        bool dispatched;
+        // cache generation when it was queued, stale answers are not cached
+        uint32_t cacheGeneration;
+        std::vector<PathRequestId> waiters;
+        PathResult result;
+    };
+
+    struct QueueEntry
+    {
+        int priority;
+        // first come first served within a priority
+        uint64_t sequence;
+        std::shared_ptr<Job> job;
+    };
+
+    struct CacheEntry
+    {
+        PathResult result;
+        uint64_t lastUsed;
+    };
+
+    const GridPathfinder *pathfinder;
+    double frameBudgetMs;
+    bool useWorkers;
+    size_t cacheCapacity;
+
+    PathRequestId nextId;
+    uint64_t sequence;
+    // heap by (priority, -sequence); entries whose job left the queue are skipped
+    std::vector<QueueEntry> queue;
+    // jobs not finished yet, by start/goal key
+    std::unordered_map<uint64_t, std::shared_ptr<Job>> jobs;
+    std::unordered_map<PathRequestId, uint64_t> requests;
+    std::unordered_map<uint64_t, CacheEntry> cache;
+    uint32_t cacheGeneration;
+    uint64_t useCounter;
+
+    std::vector<PathCompletion> finished;
+    std::vector<PathCompletion> completions;
+
+    // filled by the workers, drained by Update
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::vector<std::shared_ptr<Job>> done;
+    int inFlight;
+
+    // the main thread search cut short by the frame budget, resumed first
+    // by the next Update; its state lives in mainSearch
+    std::shared_ptr<Job> resumable;
+    bool resumableStarted;
+    GridPathfinder::SearchContext mainSearch;
+
+    size_t searchCount;
+    size_t cacheHits;
+    size_t sharedCount;
+    double lastUpdateMs;
+
+    // heap order: the entry that should run first ends up on top
+    static bool RunsLater(const QueueEntry &a, const QueueEntry &b);
+    uint64_t KeyOf(glm::ivec2 start, glm::ivec2 goal) const;
+    bool PopJob(std::shared_ptr<Job> &job);
+    void Solve(Job &job, GridPathfinder::SearchContext &search) const;
+    // one slice of the resumable search, true once it has an answer
+    bool Step();
+    void Dispatch(const std::shared_ptr<Job> &job);
+    void Finish(Job &job);
+    void Remember(uint64_t key, const PathResult &result);
+    void CollectDone();
+
+public:
+    PathService(size_t cacheCapacity = 512);
+    ~PathService();
+    PathService(const PathService &) = delete;
+    PathService &operator=(const PathService &) = delete;
+
+    // the pathfinder must be built; dropping the old one also drops the cache
+    void SetPathfinder(const GridPathfinder *newPathfinder);
+    // main thread search time per Update when there are no workers
+    void SetFrameBudget(double milliseconds) { frameBudgetMs = milliseconds; }
+    // false keeps every search on the thread calling Update
+    void SetUseWorkers(bool enabled) { useWorkers = enabled; }
+
+    // higher priority is answered first. a cached pair is answered by the next Update
+    PathRequestId Request(glm::ivec2 start, glm::ivec2 goal, int priority = 0);
+    // the request is never reported; its search is dropped if nobody else waits for it
+    void Cancel(PathRequestId id);
+
+    // delivers finished searches and starts new ones
+    void Update();
+    // requests answered by the last Update
+    const std::vector<PathCompletion> &GetCompletions() const { return completions; }
+
+    // blocks until no search runs on a worker
+    void WaitForWorkers();
+    // after the terrain changed: forget cached answers, searches already
+    // running are still delivered but not cached
+    void InvalidateCache();
+
+    size_t GetPendingCount() const { return requests.size(); }
+    size_t GetSearchCount() const { return searchCount; }
+    size_t GetCacheHitCount() const { return cacheHits; }
+    // requests that joined a search already queued for the same pair
+    size_t GetSharedCount() const { return sharedCount; }
+    double GetLastUpdateMs() const { return lastUpdateMs; }
+};
+
+#endif
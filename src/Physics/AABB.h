@@ -0,0 +1,74 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// axis-aligned bounding box in world (pixel) coordinates
+struct AABB
+{
+    glm::vec2 min;
+    glm::vec2 max;
+
+    bool Overlaps(const AABB &other) const
+    {
+        return min.x < other.max.x && max.x > other.min.x &&
+               min.y < other.max.y && max.y > other.min.y;
+    }
+
+    bool Contains(const AABB &other) const
+    {
+        return min.x <= other.min.x && min.y <= other.min.y &&
+               max.x >= other.max.x && max.y >= other.max.y;
+    }
+
+    float Perimeter() const
+    {
+        return 2.0f * ((max.x - min.x) + (max.y - min.y));
+    }
+
+    static AABB Combine(const AABB &a, const AABB &b)
+    {
+        return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+    }
+
+    // slab test of the segment from + t * delta, t in [0, maxFraction].
+    // on a hit, fraction is where the segment enters the box (0 if it starts inside)
+    bool RayCast(glm::vec2 from, glm::vec2 delta, float maxFraction, float &fraction) const
+    {
+        float tMin = 0.0f;
+        float tMax = maxFraction;
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (std::abs(delta[axis]) < 1e-12f)
+            {
+                if (from[axis] < min[axis] || from[axis] > max[axis])
+                {
+                    return false;
+                }
+                continue;
+            }
+            float inverse = 1.0f / delta[axis];
+            float t1 = (min[axis] - from[axis]) * inverse;
+            float t2 = (max[axis] - from[axis]) * inverse;
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+            if (tMin > tMax)
+            {
+                return false;
+            }
+        }
+        fraction = tMin;
+        return true;
+    }
+};
+
+// a pair of overlapping proxies, always with first < second
+struct CollisionPair
+{
+    int first;
+    int second;
+};
+
+#endif
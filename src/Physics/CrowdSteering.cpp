@@ -0,0 +1,308 @@
+#include "CrowdSteering.h"
+#include <algorithm>
+#include <cmath>
+#include "../Jobs/JobSystem.h"
+
+namespace
+{
+    // separation starts this many combined radii apart
+    const float SEPARATION_RANGE = 1.5f;
+    // keeps the divisions finite for agents on top of each other or at rest
+    const float EPSILON = 1e-4f;
+
+    void Limit(float &x, float &y, float length)
+    {
+        float squared = x * x + y * y;
+        if (squared > length * length)
+        {
+            float scale = length / std::sqrt(squared);
+            x *= scale;
+            y *= scale;
+        }
+    }
+
+    // separation and avoidance push of every neighbour slot in [begin, end).
+    // each slot on its own and without branches, so the loop vectorizes; the
+    // restrict parameters tell the compiler the arrays don't overlap
+    void PushSlots(const float *__restrict inX, const float *__restrict inY,
+                   const float *__restrict inVelocityX, const float *__restrict inVelocityY,
+                   const float *__restrict inRadii, const float *__restrict inWeights,
+                   float *__restrict outX, float *__restrict outY, size_t begin, size_t end,
+                   float separationScale, float avoidanceScale, float horizon)
+    {
+        const float inverseHorizon = 1.0f / horizon;
+        for (size_t i = begin; i < end; i++)
+        {
+            float x = inX[i];
+            float y = inY[i];
+            float vx = inVelocityX[i];
+            float vy = inVelocityY[i];
+            float combined = inRadii[i];
+
+            // separation: straight away from the neighbour while too close
+            float squared = x * x + y * y + EPSILON;
+            float inverseDistance = 1.0f / std::sqrt(squared);
+            float distance = squared * inverseDistance;
+            float separation = std::max(0.0f, 1.0f - distance / (combined * SEPARATION_RANGE)) * separationScale * inWeights[i];
+
+            // avoidance: away from where the neighbour will be closest, if that is
+            // a collision within the horizon, harder the sooner it comes
+            float speedSquared = vx * vx + vy * vy + EPSILON;
+            float approach = std::min(std::max(-(x * vx + y * vy) / speedSquared, 0.0f), horizon);
+            float closestX = x + vx * approach;
+            float closestY = y + vy * approach;
+            float closestSquared = closestX * closestX + closestY * closestY + EPSILON;
+            float inverseClosest = 1.0f / std::sqrt(closestSquared);
+            float closest = closestSquared * inverseClosest;
+            float avoidance = std::max(0.0f, 1.0f - closest / combined) * (1.0f - approach * inverseHorizon) * avoidanceScale * inWeights[i];
+
+            outX[i] = -x * inverseDistance * separation - closestX * inverseClosest * avoidance;
+            outY[i] = -y * inverseDistance * separation - closestY * inverseClosest * avoidance;
+        }
+    }
+}
+
+CrowdSteering::CrowdSteering()
+    : neighbourRadius(64.0f), maxNeighbours(8), timeHorizon(1.0f),
+      separationStrength(60.0f), avoidanceStrength(80.0f), maxAcceleration(400.0f)
+{
+    hash.SetCellSize(neighbourRadius);
+}
+
+void CrowdSteering::SetNeighbourRadius(float radius)
+{
+    neighbourRadius = radius;
+    hash.SetCellSize(radius);
+}
+
+void CrowdSteering::SetMaxNeighbours(int count)
+{
+    maxNeighbours = std::max(1, std::min(count, static_cast<int>(MAX_NEIGHBOURS)));
+}
+
+void CrowdSteering::SetStrengths(float separation, float avoidance)
+{
+    separationStrength = separation;
+    avoidanceStrength = avoidance;
+}
+
+void CrowdSteering::Clear()
+{
+    positionX.clear();
+    positionY.clear();
+    velocityX.clear();
+    velocityY.clear();
+    preferredX.clear();
+    preferredY.clear();
+    radii.clear();
+    maxSpeeds.clear();
+}
+
+void CrowdSteering::Reserve(size_t agents)
+{
+    positionX.reserve(agents);
+    positionY.reserve(agents);
+    velocityX.reserve(agents);
+    velocityY.reserve(agents);
+    preferredX.reserve(agents);
+    preferredY.reserve(agents);
+    radii.reserve(agents);
+    maxSpeeds.reserve(agents);
+    hash.Reserve(agents);
+}
+
+int CrowdSteering::AddAgent(glm::vec2 position, glm::vec2 velocity, glm::vec2 preferredVelocity, float radius, float maxSpeed)
+{
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    velocityX.push_back(velocity.x);
+    velocityY.push_back(velocity.y);
+    preferredX.push_back(preferredVelocity.x);
+    preferredY.push_back(preferredVelocity.y);
+    radii.push_back(radius);
+    maxSpeeds.push_back(maxSpeed);
+    return static_cast<int>(positionX.size()) - 1;
+}
+
+void CrowdSteering::GatherNeighbours(uint32_t bucket)
+{
+    // everyone in the 3x3 cells around the cell being worked on, copied
+    // together once per cell and then scanned by each of its agents
+    thread_local std::vector<float> candidateX;
+    thread_local std::vector<float> candidateY;
+    thread_local std::vector<int> candidates;
+    thread_local std::vector<float> candidateDistances;
+    bool loaded = false;
+    int32_t loadedX = 0;
+    int32_t loadedY = 0;
+    const float reach = neighbourRadius * neighbourRadius;
+
+    hash.ForEachInBucket(bucket, [&](int agent, int32_t cellX, int32_t cellY)
+                         {
+                             // a bucket usually holds one cell, but may mix several
+                             if (!loaded || cellX != loadedX || cellY != loadedY)
+                             {
+                                 candidateX.clear();
+                                 candidateY.clear();
+                                 candidates.clear();
+                                 for (int32_t dy = -1; dy <= 1; dy++)
+                                 {
+                                     for (int32_t dx = -1; dx <= 1; dx++)
+                                     {
+                                         hash.ForEachInCell(cellX + dx, cellY + dy, [&](int other)
+                                                            {
+                                                                candidateX.push_back(positionX[other]);
+                                                                candidateY.push_back(positionY[other]);
+                                                                candidates.push_back(other);
+                                                            });
+                                     }
+                                 }
+                                 candidateDistances.resize(candidates.size());
+                                 loaded = true;
+                                 loadedX = cellX;
+                                 loadedY = cellY;
+                             }
+
+                             const float x = positionX[agent];
+                             const float y = positionY[agent];
+                             const size_t count = candidates.size();
+                             for (size_t i = 0; i < count; i++)
+                             {
+                                 float offsetX = candidateX[i] - x;
+                                 float offsetY = candidateY[i] - y;
+                                 candidateDistances[i] = offsetX * offsetX + offsetY * offsetY;
+                             }
+
+                             // the k nearest, sorted by distance
+                             float distances[MAX_NEIGHBOURS];
+                             int nearest[MAX_NEIGHBOURS];
+                             int found = 0;
+                             for (size_t i = 0; i < count; i++)
+                             {
+                                 float distance = candidateDistances[i];
+                                 if (distance >= reach || candidates[i] == agent ||
+                                     (found == maxNeighbours && distance >= distances[found - 1]))
+                                 {
+                                     continue;
+                                 }
+                                 int slot = found < maxNeighbours ? found++ : found - 1;
+                                 for (; slot > 0 && distances[slot - 1] > distance; slot--)
+                                 {
+                                     distances[slot] = distances[slot - 1];
+                                     nearest[slot] = nearest[slot - 1];
+                                 }
+                                 distances[slot] = distance;
+                                 nearest[slot] = candidates[i];
+                             }
+                             WriteNeighbours(agent, nearest, found);
+                         });
+}
+
+void CrowdSteering::WriteNeighbours(int agent, const int *nearest, int count)
+{
+    const float x = positionX[agent];
+    const float y = positionY[agent];
+    neighbourCounts[agent] = count;
+    size_t base = static_cast<size_t>(agent) * maxNeighbours;
+    for (int slot = 0; slot < maxNeighbours; slot++)
+    {
+        size_t i = base + slot;
+        if (slot < count)
+        {
+            int other = nearest[slot];
+            relativeX[i] = positionX[other] - x;
+            relativeY[i] = positionY[other] - y;
+            relativeVelocityX[i] = velocityX[other] - velocityX[agent];
+            relativeVelocityY[i] = velocityY[other] - velocityY[agent];
+            combinedRadii[i] = radii[other] + radii[agent];
+            weights[i] = 1.0f;
+        }
+        else
+        {
+            relativeX[i] = 0.0f;
+            relativeY[i] = 0.0f;
+            relativeVelocityX[i] = 0.0f;
+            relativeVelocityY[i] = 0.0f;
+            combinedRadii[i] = 1.0f;
+            weights[i] = 0.0f;
+        }
+    }
+}
+
+void CrowdSteering::Steer(int firstAgent, int lastAgent, float deltaTime)
+{
+    const size_t begin = static_cast<size_t>(firstAgent) * maxNeighbours;
+    const size_t end = static_cast<size_t>(lastAgent + 1) * maxNeighbours;
+
+    PushSlots(relativeX.data(), relativeY.data(), relativeVelocityX.data(), relativeVelocityY.data(),
+              combinedRadii.data(), weights.data(), pushX.data(), pushY.data(), begin, end,
+              separationStrength, avoidanceStrength, timeHorizon);
+
+    const float maxChange = maxAcceleration * deltaTime;
+    for (int agent = firstAgent; agent <= lastAgent; agent++)
+    {
+        float desiredX = preferredX[agent];
+        float desiredY = preferredY[agent];
+        size_t base = static_cast<size_t>(agent) * maxNeighbours;
+        for (int slot = 0; slot < maxNeighbours; slot++)
+        {
+            desiredX += pushX[base + slot];
+            desiredY += pushY[base + slot];
+        }
+        Limit(desiredX, desiredY, maxSpeeds[agent]);
+
+        float changeX = desiredX - velocityX[agent];
+        float changeY = desiredY - velocityY[agent];
+        Limit(changeX, changeY, maxChange);
+        float newX = velocityX[agent] + changeX;
+        float newY = velocityY[agent] + changeY;
+        Limit(newX, newY, maxSpeeds[agent]);
+        newVelocityX[agent] = newX;
+        newVelocityY[agent] = newY;
+    }
+}
+
+void CrowdSteering::Solve(float deltaTime)
+{
+    const size_t agents = positionX.size();
+    const size_t slots = agents * maxNeighbours;
+    // fresh from this frame's arena, on the calling thread; the workers
+    // only write into them
+    newVelocityX = FrameVector<float>(agents);
+    newVelocityY = FrameVector<float>(agents);
+    neighbourCounts = FrameVector<int>(agents);
+    relativeX = FrameVector<float>(slots);
+    relativeY = FrameVector<float>(slots);
+    relativeVelocityX = FrameVector<float>(slots);
+    relativeVelocityY = FrameVector<float>(slots);
+    combinedRadii = FrameVector<float>(slots);
+    weights = FrameVector<float>(slots);
+    pushX = FrameVector<float>(slots);
+    pushY = FrameVector<float>(slots);
+    if (agents == 0)
+    {
+        return;
+    }
+
+    // agents are points here, the neighbour radius does the reaching
+    hash.Clear();
+    for (size_t agent = 0; agent < agents; agent++)
+    {
+        glm::vec2 position(positionX[agent], positionY[agent]);
+        hash.Insert({position, position});
+    }
+    hash.Build();
+
+    // bucket by bucket, so agents of one cell run together and share the
+    // cells they look at; each agent has exactly one entry
+    JobSystem::ParallelFor(hash.GetBucketCount(), 256, [&](size_t begin, size_t end)
+                           {
+                               for (size_t bucket = begin; bucket < end; bucket++)
+                               {
+                                   GatherNeighbours(static_cast<uint32_t>(bucket));
+                               }
+                           });
+
+    JobSystem::ParallelFor(agents, 512, [&](size_t begin, size_t end)
+                           { Steer(static_cast<int>(begin), static_cast<int>(end) - 1, deltaTime); });
+}
@@ -0,0 +1,92 @@
+#ifndef CROWDSTEERING_H
+#define CROWDSTEERING_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "SpatialHash.h"
+#include "../Memory/FrameArena.h"
+
+// Local steering for crowds: every agent keeps its preferred velocity (the
+// way its path goes) but pushes away from agents that are too close and
+// sidesteps the ones it would run into within the next moment.
+//
+// Solve() puts the agents into a SpatialHash with cells as large as the
+// neighbour radius and walks it bucket by bucket on the JobSystem. The
+// agents of the 3x3 cells around a cell are copied together once, and each
+// agent in the cell scans that short list and keeps the k nearest. The
+// chosen neighbours are written out flattened as structure of arrays
+// (relative position, relative velocity, combined radius per slot), and one
+// branch-free pass over all slots, which the compiler vectorizes, turns
+// them into separation and avoidance pushes. A last pass per agent adds
+// them up, limits speed and acceleration and stores the new velocity.
+//
+// What Solve works out, the neighbour slots and the new velocities, is
+// frame arena memory: read the velocities in the frame Solve ran in.
+class CrowdSteering
+{
+private:
+    // per agent
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> preferredX;
+    std::vector<float> preferredY;
+    std::vector<float> radii;
+    std::vector<float> maxSpeeds;
+    // per agent, out of Solve
+    FrameVector<float> newVelocityX;
+    FrameVector<float> newVelocityY;
+    FrameVector<int> neighbourCounts;
+
+    // per neighbour slot, maxNeighbours slots per agent, unused ones have weight 0
+    FrameVector<float> relativeX;
+    FrameVector<float> relativeY;
+    FrameVector<float> relativeVelocityX;
+    FrameVector<float> relativeVelocityY;
+    FrameVector<float> combinedRadii;
+    FrameVector<float> weights;
+    FrameVector<float> pushX;
+    FrameVector<float> pushY;
+
+    SpatialHash hash;
+    float neighbourRadius;
+    int maxNeighbours;
+    float timeHorizon;
+    float separationStrength;
+    float avoidanceStrength;
+    float maxAcceleration;
+
+    // picks the k nearest for every agent hashed into the bucket
+    void GatherNeighbours(uint32_t bucket);
+    void WriteNeighbours(int agent, const int *nearest, int count);
+    void Steer(int firstAgent, int lastAgent, float deltaTime);
+
+public:
+    static const int MAX_NEIGHBOURS = 16;
+
+    CrowdSteering();
+
+    void Clear();
+    void Reserve(size_t agents);
+    // returns the agent index, which is simply the insertion index
+    int AddAgent(glm::vec2 position, glm::vec2 velocity, glm::vec2 preferredVelocity, float radius, float maxSpeed);
+    size_t GetAgentCount() const { return positionX.size(); }
+
+    // how far an agent looks for others, in pixels; also the hash cell size
+    void SetNeighbourRadius(float radius);
+    // at most MAX_NEIGHBOURS
+    void SetMaxNeighbours(int count);
+    // how far ahead collisions are avoided, in seconds
+    void SetTimeHorizon(float seconds) { timeHorizon = seconds; }
+    // pixels per second of push at full overlap
+    void SetStrengths(float separation, float avoidance);
+    // pixels per second squared
+    void SetMaxAcceleration(float acceleration) { maxAcceleration = acceleration; }
+
+    void Solve(float deltaTime);
+    glm::vec2 GetVelocity(int agent) const { return glm::vec2(newVelocityX[agent], newVelocityY[agent]); }
+    int GetNeighbourCount(int agent) const { return neighbourCounts[agent]; }
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "DynamicTree.h"
+#include <algorithm>
+
+// how far ahead of a moving collider its fat box is stretched, in frames
+const float DynamicTree::DISPLACEMENT_MULTIPLIER = 2.0f;
+
+DynamicTree::DynamicTree(float margin) : root(NULL_NODE), freeList(NULL_NODE), margin(margin)
+{
+}
+
+int DynamicTree::AllocateNode()
+{
+    if (freeList == NULL_NODE)
+    {
+        TreeNode node;
+        node.parent = NULL_NODE;
+        node.height = -1;
+        freeList = static_cast<int>(nodes.size());
+        nodes.push_back(node);
+    }
+    int index = freeList;
+    TreeNode &node = nodes[index];
+    freeList = node.parent;
+    node.parent = NULL_NODE;
+    node.child1 = NULL_NODE;
+    node.child2 = NULL_NODE;
+    node.height = 0;
+    node.userData = -1;
+    node.moved = false;
+    return index;
+}
+
+void DynamicTree::FreeNode(int node)
+{
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+int DynamicTree::CreateProxy(const AABB &box, int userData)
+{
+    int proxy = AllocateNode();
+    nodes[proxy].box.min = box.min - glm::vec2(margin);
+    nodes[proxy].box.max = box.max + glm::vec2(margin);
+    nodes[proxy].userData = userData;
+    nodes[proxy].moved = true;
+    InsertLeaf(proxy);
+    return proxy;
+}
+
+void DynamicTree::DestroyProxy(int proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+}
+
+bool DynamicTree::MoveProxy(int proxy, const AABB &box, glm::vec2 displacement)
+{
+    AABB fatBox;
+    fatBox.min = box.min - glm::vec2(margin);
+    fatBox.max = box.max + glm::vec2(margin);
+
+    // stretch the fat box along the motion so a steadily moving collider
+    // doesn't need reinserting every frame
+    glm::vec2 ahead = DISPLACEMENT_MULTIPLIER * displacement;
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (ahead[axis] < 0.0f)
+        {
+            fatBox.min[axis] += ahead[axis];
+        }
+        else
+        {
+            fatBox.max[axis] += ahead[axis];
+        }
+    }
+
+    const AABB &treeBox = nodes[proxy].box;
+    if (treeBox.Contains(box))
+    {
+        // still inside, but a box stretched by a fast move that has since
+        // stopped would stay huge forever; only keep it if it's not too big
+        AABB hugeBox;
+        hugeBox.min = fatBox.min - glm::vec2(4.0f * margin);
+        hugeBox.max = fatBox.max + glm::vec2(4.0f * margin);
+        if (hugeBox.Contains(treeBox))
+        {
+            return false;
+        }
+    }
+
+    RemoveLeaf(proxy);
+    nodes[proxy].box = fatBox;
+    InsertLeaf(proxy);
+    nodes[proxy].moved = true;
+    return true;
+}
+
+void DynamicTree::InsertLeaf(int leaf)
+{
+    if (root == NULL_NODE)
+    {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // walk down towards the cheapest sibling for the new leaf
+    const AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].IsLeaf())
+    {
+        const TreeNode &node = nodes[index];
+        float perimeter = node.box.Perimeter();
+        float combinedPerimeter = AABB::Combine(node.box, leafBox).Perimeter();
+
+        // cost of pairing the leaf with this whole subtree under a new parent
+        float cost = 2.0f * combinedPerimeter;
+        // every ancestor below here grows by at least this much
+        float inheritanceCost = 2.0f * (combinedPerimeter - perimeter);
+
+        float childCosts[2];
+        int children[2] = {node.child1, node.child2};
+        for (int i = 0; i < 2; i++)
+        {
+            const TreeNode &child = nodes[children[i]];
+            float grown = AABB::Combine(leafBox, child.box).Perimeter();
+            childCosts[i] = (child.IsLeaf() ? grown : grown - child.box.Perimeter()) + inheritanceCost;
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+        {
+            break;
+        }
+        index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+    int sibling = index;
+
+    // new parent for the sibling and the leaf
+    int oldParent = nodes[sibling].parent;
+    int newParent = AllocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = AABB::Combine(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent == NULL_NODE)
+    {
+        root = newParent;
+    }
+    else if (nodes[oldParent].child1 == sibling)
+    {
+        nodes[oldParent].child1 = newParent;
+    }
+    else
+    {
+        nodes[oldParent].child2 = newParent;
+    }
+
+    Refit(nodes[leaf].parent);
+}
+
+void DynamicTree::RemoveLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = NULL_NODE;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == NULL_NODE)
+    {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+        return;
+    }
+
+    // the sibling takes the parent's place
+    if (nodes[grandParent].child1 == parent)
+    {
+        nodes[grandParent].child1 = sibling;
+    }
+    else
+    {
+        nodes[grandParent].child2 = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    FreeNode(parent);
+
+    Refit(grandParent);
+}
+
+// rebalances and recomputes boxes and heights from node up to the root
+void DynamicTree::Refit(int node)
+{
+    int index = node;
+    while (index != NULL_NODE)
+    {
+        index = Balance(index);
+        TreeNode &current = nodes[index];
+        const TreeNode &child1 = nodes[current.child1];
+        const TreeNode &child2 = nodes[current.child2];
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.box = AABB::Combine(child1.box, child2.box);
+        index = current.parent;
+    }
+}
+
+// if one child of A is more than one level taller than the other, rotate it
+// up into A's place. returns the index of the new subtree root
+int DynamicTree::Balance(int iA)
+{
+    TreeNode &A = nodes[iA];
+    if (A.IsLeaf() || A.height < 2)
+    {
+        return iA;
+    }
+
+    int iB = A.child1;
+    int iC = A.child2;
+    TreeNode &B = nodes[iB];
+    TreeNode &C = nodes[iC];
+    int balance = C.height - B.height;
+
+    // rotate C up
+    if (balance > 1)
+    {
+        int iF = C.child1;
+        int iG = C.child2;
+        TreeNode &F = nodes[iF];
+        TreeNode &G = nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        if (C.parent == NULL_NODE)
+        {
+            root = iC;
+        }
+        else if (nodes[C.parent].child1 == iA)
+        {
+            nodes[C.parent].child1 = iC;
+        }
+        else
+        {
+            nodes[C.parent].child2 = iC;
+        }
+
+        // the taller grandchild stays with C, the other one moves under A
+        if (F.height > G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = AABB::Combine(B.box, G.box);
+            C.box = AABB::Combine(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = AABB::Combine(B.box, F.box);
+            C.box = AABB::Combine(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // rotate B up
+    if (balance < -1)
+    {
+        int iD = B.child1;
+        int iE = B.child2;
+        TreeNode &D = nodes[iD];
+        TreeNode &E = nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        if (B.parent == NULL_NODE)
+        {
+            root = iB;
+        }
+        else if (nodes[B.parent].child1 == iA)
+        {
+            nodes[B.parent].child1 = iB;
+        }
+        else
+        {
+            nodes[B.parent].child2 = iB;
+        }
+
+        if (D.height > E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = AABB::Combine(C.box, E.box);
+            B.box = AABB::Combine(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = AABB::Combine(C.box, D.box);
+            B.box = AABB::Combine(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
@@ -0,0 +1,189 @@
+#ifndef DYNAMICTREE_H
+#define DYNAMICTREE_H
+
+#include <vector>
+#include "AABB.h"
+
+const int NULL_NODE = -1;
+
+// Incremental bounding volume hierarchy for colliders that mostly stay put.
+// Leaves store a "fat" box: the collider grown by a margin and stretched in
+// the direction it is moving. MoveProxy only touches the tree when the
+// collider leaves its fat box, so trees, bases and other static obstacles
+// cost nothing after insertion and the per-frame work follows the number of
+// colliders that actually moved.
+//
+// Insertion picks the sibling with the smallest perimeter increase (the 2D
+// form of the surface area heuristic) and the path back to the root is
+// kept balanced with AVL-style rotations.
+class DynamicTree
+{
+private:
+    struct TreeNode
+    {
+        AABB box;
+        int userData;
+        // parent for nodes in the tree, next free node for nodes in the free list
+        int parent;
+        int child1;
+        int child2;
+        // leaf = 0, free node = -1
+        int height;
+        // set when the leaf was reinserted, see MoveProxy
+        bool moved;
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    std::vector<TreeNode> nodes;
+    int root;
+    int freeList;
+    float margin;
+
+    // nodes the query stacks hold without allocating; an AVL-balanced tree
+    // with a million leaves is around 30 levels deep
+    static const int STACK_SIZE = 64;
+    static const float DISPLACEMENT_MULTIPLIER;
+
+    // the nodes a query still has to visit, spilling to the heap past
+    // STACK_SIZE rather than leaving subtrees out
+    class NodeStack
+    {
+    private:
+        int fixed[STACK_SIZE];
+        std::vector<int> spilled;
+        int count = 0;
+
+    public:
+        bool IsEmpty() const { return count == 0; }
+        void Push(int node)
+        {
+            if (count < STACK_SIZE)
+            {
+                fixed[count] = node;
+            }
+            else
+            {
+                spilled.push_back(node);
+            }
+            count++;
+        }
+        int Pop()
+        {
+            count--;
+            if (count < STACK_SIZE)
+            {
+                return fixed[count];
+            }
+            int node = spilled.back();
+            spilled.pop_back();
+            return node;
+        }
+    };
+
+    int AllocateNode();
+    void FreeNode(int node);
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+    int Balance(int node);
+    void Refit(int node);
+
+public:
+    DynamicTree(float margin = 8.0f);
+
+    // returns the proxy id of a new leaf for the box
+    int CreateProxy(const AABB &box, int userData);
+    void DestroyProxy(int proxy);
+    // true if the proxy had to be reinserted because the box left its fat box
+    bool MoveProxy(int proxy, const AABB &box, glm::vec2 displacement);
+
+    const AABB &GetFatAABB(int proxy) const { return nodes[proxy].box; }
+    int GetUserData(int proxy) const { return nodes[proxy].userData; }
+    bool WasMoved(int proxy) const { return nodes[proxy].moved; }
+    void ClearMoved(int proxy) { nodes[proxy].moved = false; }
+    int GetHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+    // calls callback(proxy) for every leaf whose fat box overlaps the area;
+    // returning false from the callback stops the query
+    template <typename TCallback>
+    void Query(const AABB &area, TCallback callback) const;
+
+    // calls callback(proxy, maxFraction) for every leaf whose fat box the
+    // segment from -> to crosses, in no particular order. the callback returns
+    // the new max fraction: 0 stops the cast, a smaller value clips the
+    // segment (closest hit so far), maxFraction carries on unchanged
+    template <typename TCallback>
+    void RayCast(glm::vec2 from, glm::vec2 to, TCallback callback) const;
+};
+
+template <typename TCallback>
+void DynamicTree::Query(const AABB &area, TCallback callback) const
+{
+    NodeStack stack;
+    if (root != NULL_NODE)
+    {
+        stack.Push(root);
+    }
+    while (!stack.IsEmpty())
+    {
+        int index = stack.Pop();
+        const TreeNode &node = nodes[index];
+        if (!node.box.Overlaps(area))
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            if (!callback(index))
+            {
+                return;
+            }
+        }
+        else
+        {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template <typename TCallback>
+void DynamicTree::RayCast(glm::vec2 from, glm::vec2 to, TCallback callback) const
+{
+    glm::vec2 delta = to - from;
+    float maxFraction = 1.0f;
+    NodeStack stack;
+    if (root != NULL_NODE)
+    {
+        stack.Push(root);
+    }
+    while (!stack.IsEmpty())
+    {
+        int index = stack.Pop();
+        const TreeNode &node = nodes[index];
+        float fraction;
+        if (!node.box.RayCast(from, delta, maxFraction, fraction))
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            float value = callback(index, maxFraction);
+            if (value == 0.0f)
+            {
+                return;
+            }
+            if (value > 0.0f && value < maxFraction)
+            {
+                maxFraction = value;
+            }
+        }
+        else
+        {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+#endif
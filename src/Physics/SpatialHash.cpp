@@ -0,0 +1,183 @@
+#include "SpatialHash.h"
+#include <cmath>
+
+SpatialHash::SpatialHash(float cellSize)
+{
+    SetCellSize(cellSize);
+    bucketMask = 0;
+    built = false;
+}
+
+void SpatialHash::SetCellSize(float size)
+{
+    cellSize = size;
+    inverseCellSize = 1.0f / size;
+    built = false;
+}
+
+int32_t SpatialHash::CellCoordinate(float value) const
+{
+    return static_cast<int32_t>(std::floor(value * inverseCellSize));
+}
+
+uint32_t SpatialHash::HashCell(int32_t cellX, int32_t cellY)
+{
+    return static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellY) * 19349663u;
+}
+
+void SpatialHash::Clear()
+{
+    boxes.clear();
+    entries.clear();
+    built = false;
+}
+
+void SpatialHash::Reserve(size_t proxies)
+{
+    boxes.reserve(proxies);
+    entries.reserve(proxies * 2);
+}
+
+int SpatialHash::Insert(const AABB &box)
+{
+    int proxy = static_cast<int>(boxes.size());
+    boxes.push_back(box);
+
+    int32_t minX = CellCoordinate(box.min.x);
+    int32_t minY = CellCoordinate(box.min.y);
+    int32_t maxX = CellCoordinate(box.max.x);
+    int32_t maxY = CellCoordinate(box.max.y);
+    for (int32_t y = minY; y <= maxY; y++)
+    {
+        for (int32_t x = minX; x <= maxX; x++)
+        {
+            entries.push_back({x, y, proxy});
+        }
+    }
+    built = false;
+    return proxy;
+}
+
+void SpatialHash::Build()
+{
+    // twice as many buckets as entries keeps unrelated cells from sharing
+    uint32_t bucketCount = 1;
+    while (bucketCount < entries.size() * 2)
+    {
+        bucketCount <<= 1;
+    }
+    bucketMask = bucketCount - 1;
+
+    // counting sort of the entries by bucket
+    bucketStarts.assign(bucketCount + 1, 0);
+    for (const CellEntry &entry : entries)
+    {
+        bucketStarts[(HashCell(entry.cellX, entry.cellY) & bucketMask) + 1]++;
+    }
+    for (uint32_t i = 1; i <= bucketCount; i++)
+    {
+        bucketStarts[i] += bucketStarts[i - 1];
+    }
+    sortedEntries.resize(entries.size());
+    // bucketStarts[b] walks up to the end of bucket b while scattering and is
+    // shifted back afterwards
+    for (const CellEntry &entry : entries)
+    {
+        sortedEntries[bucketStarts[HashCell(entry.cellX, entry.cellY) & bucketMask]++] = entry;
+    }
+    for (uint32_t i = bucketCount; i > 0; i--)
+    {
+        bucketStarts[i] = bucketStarts[i - 1];
+    }
+    bucketStarts[0] = 0;
+    built = true;
+}
+
+void SpatialHash::FindPairs(FrameVector<CollisionPair> &pairs)
+{
+    if (!built)
+    {
+        Build();
+    }
+    uint32_t bucketCount = bucketMask + 1;
+    for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+        uint32_t begin = bucketStarts[bucket];
+        uint32_t end = bucketStarts[bucket + 1];
+        for (uint32_t i = begin; i + 1 < end; i++)
+        {
+            const CellEntry &a = sortedEntries[i];
+            const AABB &boxA = boxes[a.proxy];
+            for (uint32_t j = i + 1; j < end; j++)
+            {
+                const CellEntry &b = sortedEntries[j];
+                // different cells that happen to hash into the same bucket
+                if (a.cellX != b.cellX || a.cellY != b.cellY)
+                {
+                    continue;
+                }
+                const AABB &boxB = boxes[b.proxy];
+                if (!boxA.Overlaps(boxB))
+                {
+                    continue;
+                }
+                // only the cell holding the overlap's top-left corner reports it
+                if (CellCoordinate(std::max(boxA.min.x, boxB.min.x)) != a.cellX ||
+                    CellCoordinate(std::max(boxA.min.y, boxB.min.y)) != a.cellY)
+                {
+                    continue;
+                }
+                if (a.proxy < b.proxy)
+                {
+                    pairs.push_back({a.proxy, b.proxy});
+                }
+                else
+                {
+                    pairs.push_back({b.proxy, a.proxy});
+                }
+            }
+        }
+    }
+}
+
+void SpatialHash::Query(const AABB &area, std::vector<int> &proxies)
+{
+    if (!built)
+    {
+        Build();
+    }
+    if (entries.empty())
+    {
+        return;
+    }
+    int32_t minX = CellCoordinate(area.min.x);
+    int32_t minY = CellCoordinate(area.min.y);
+    int32_t maxX = CellCoordinate(area.max.x);
+    int32_t maxY = CellCoordinate(area.max.y);
+    for (int32_t y = minY; y <= maxY; y++)
+    {
+        for (int32_t x = minX; x <= maxX; x++)
+        {
+            uint32_t bucket = HashCell(x, y) & bucketMask;
+            for (uint32_t i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; i++)
+            {
+                const CellEntry &entry = sortedEntries[i];
+                if (entry.cellX != x || entry.cellY != y)
+                {
+                    continue;
+                }
+                const AABB &box = boxes[entry.proxy];
+                if (!box.Overlaps(area))
+                {
+                    continue;
+                }
+                // a box spanning several of the queried cells is reported once
+                if (CellCoordinate(std::max(box.min.x, area.min.x)) == x &&
+                    CellCoordinate(std::max(box.min.y, area.min.y)) == y)
+                {
+                    proxies.push_back(entry.proxy);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <cstdint>
+#include <vector>
+#include "AABB.h"
+#include "../Memory/FrameArena.h"
+
+// Uniform-grid broadphase. Every frame the boxes are inserted into all the
+// cells they touch, the cell entries are bucketed by a hash of the cell
+// coordinates with a counting sort (no per-cell containers, no tree), and
+// each bucket is checked pairwise. A pair sharing several cells is only
+// reported by the cell that holds the top-left corner of their overlap, so
+// the output has no duplicates and needs no set to filter it.
+//
+// All buffers are kept between frames; after warm-up a frame doesn't allocate.
+class SpatialHash
+{
+private:
+    struct CellEntry
+    {
+        int32_t cellX;
+        int32_t cellY;
+        int32_t proxy;
+    };
+
+    float cellSize;
+    float inverseCellSize;
+    std::vector<AABB> boxes;
+    std::vector<CellEntry> entries;
+    std::vector<CellEntry> sortedEntries;
+    std::vector<uint32_t> bucketStarts;
+    uint32_t bucketMask;
+    bool built;
+
+    static uint32_t HashCell(int32_t cellX, int32_t cellY);
+
+public:
+    SpatialHash(float cellSize = 64.0f);
+
+    void SetCellSize(float size);
+    float GetCellSize() const { return cellSize; }
+
+    void Clear();
+    void Reserve(size_t proxies);
+    // returns the proxy id, which is simply the insertion index
+    int Insert(const AABB &box);
+    const AABB &GetBox(int proxy) const { return boxes[proxy]; }
+    size_t GetProxyCount() const { return boxes.size(); }
+
+    // buckets the inserted boxes; FindPairs and Query do this on demand
+    void Build();
+    // appends every overlapping pair exactly once
+    void FindPairs(FrameVector<CollisionPair> &pairs);
+    // appends every proxy whose box overlaps the area, each once
+    void Query(const AABB &area, std::vector<int> &proxies);
+
+    // read-only access for callers walking the grid themselves, several
+    // threads at once if they like; Build() must have run since the last Insert
+    int32_t CellCoordinate(float value) const;
+    uint32_t GetBucketCount() const { return bucketStarts.empty() ? 0 : bucketMask + 1; }
+    // calls visit(proxy, cellX, cellY) for every entry hashed into the bucket;
+    // cells sharing a bucket come out mixed
+    template <typename TVisit>
+    void ForEachInBucket(uint32_t bucket, TVisit visit) const
+    {
+        for (uint32_t i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; i++)
+        {
+            const CellEntry &entry = sortedEntries[i];
+            visit(entry.proxy, entry.cellX, entry.cellY);
+        }
+    }
+    // calls visit(proxy) for every proxy with an entry in the cell
+    template <typename TVisit>
+    void ForEachInCell(int32_t cellX, int32_t cellY, TVisit visit) const
+    {
+        if (bucketStarts.empty())
+        {
+            return;
+        }
+        uint32_t bucket = HashCell(cellX, cellY) & bucketMask;
+        for (uint32_t i = bucketStarts[bucket]; i < bucketStarts[bucket + 1]; i++)
+        {
+            const CellEntry &entry = sortedEntries[i];
+            if (entry.cellX == cellX && entry.cellY == cellY)
+            {
+                visit(entry.proxy);
+            }
+        }
+    }
+};
+
+#endif
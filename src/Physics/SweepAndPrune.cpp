@@ -0,0 +1,219 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+#include <cstring>
+#include "../Jobs/JobSystem.h"
+
+namespace
+{
+    // maps a float onto an unsigned int with the same ordering
+    inline uint32_t SortableBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    const int RADIX_BITS = 8;
+    const int RADIX_BUCKETS = 1 << RADIX_BITS;
+    const int RADIX_PASSES = 32 / RADIX_BITS;
+    // below this many boxes a single thread sorts faster than the hand-off
+    const size_t PARALLEL_SORT_MIN = 32768;
+}
+
+SweepAndPrune::SweepAndPrune() : frame(1), insertedCount(0), insertionShifts(0), radixSorts(0)
+{
+}
+
+void SweepAndPrune::Clear()
+{
+    frame++;
+    insertedCount = 0;
+}
+
+void SweepAndPrune::Insert(int id, const AABB &box)
+{
+    if (id >= static_cast<int>(boxes.size()))
+    {
+        boxes.resize(id + 1);
+        insertedFrame.resize(id + 1, 0);
+    }
+    boxes[id] = box;
+    insertedFrame[id] = frame;
+    insertedCount++;
+}
+
+// sorts order by minX in place; gives up after budget element moves
+bool SweepAndPrune::InsertionSort(size_t budget)
+{
+    insertionShifts = 0;
+    for (size_t i = 1; i < order.size(); i++)
+    {
+        SortKey key = order[i];
+        size_t j = i;
+        while (j > 0 && order[j - 1].minX > key.minX)
+        {
+            order[j] = order[j - 1];
+            j--;
+            if (++insertionShifts > budget)
+            {
+                order[j] = key;
+                return false;
+            }
+        }
+        order[j] = key;
+    }
+    return true;
+}
+
+// LSD radix sort on the float bits, 8 bits per pass. each pass histograms
+// the chunks in parallel, turns the histograms into per-chunk offsets and
+// scatters the chunks in parallel, which keeps the sort stable
+void SweepAndPrune::RadixSort()
+{
+    radixSorts++;
+    const size_t count = order.size();
+    scratch.resize(count);
+    size_t chunks = count >= PARALLEL_SORT_MIN ? JobSystem::GetWorkerCount() + 1 : 1;
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    std::vector<uint32_t> histograms(chunks * RADIX_BUCKETS);
+
+    SortKey *source = order.data();
+    SortKey *destination = scratch.data();
+    for (int pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        const int shift = pass * RADIX_BITS;
+        std::fill(histograms.begin(), histograms.end(), 0);
+        JobSystem::ParallelFor(chunks, 1, [&](size_t firstChunk, size_t lastChunk)
+                               {
+                                   for (size_t chunk = firstChunk; chunk < lastChunk; chunk++)
+                                   {
+                                       uint32_t *histogram = &histograms[chunk * RADIX_BUCKETS];
+                                       size_t end = std::min(count, (chunk + 1) * chunkSize);
+                                       for (size_t i = chunk * chunkSize; i < end; i++)
+                                       {
+                                           histogram[(SortableBits(source[i].minX) >> shift) & (RADIX_BUCKETS - 1)]++;
+                                       }
+                                   } });
+
+        // bucket-major, chunk-minor prefix sum gives each chunk its write position per bucket
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+        {
+            for (size_t chunk = 0; chunk < chunks; chunk++)
+            {
+                uint32_t bucketCount = histograms[chunk * RADIX_BUCKETS + bucket];
+                histograms[chunk * RADIX_BUCKETS + bucket] = offset;
+                offset += bucketCount;
+            }
+        }
+
+        JobSystem::ParallelFor(chunks, 1, [&](size_t firstChunk, size_t lastChunk)
+                               {
+                                   for (size_t chunk = firstChunk; chunk < lastChunk; chunk++)
+                                   {
+                                       uint32_t *positions = &histograms[chunk * RADIX_BUCKETS];
+                                       size_t end = std::min(count, (chunk + 1) * chunkSize);
+                                       for (size_t i = chunk * chunkSize; i < end; i++)
+                                       {
+                                           destination[positions[(SortableBits(source[i].minX) >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+                                       }
+                                   } });
+        std::swap(source, destination);
+    }
+    // an even number of passes ends up back in order
+}
+
+void SweepAndPrune::FindPairs(FrameVector<CollisionPair> &pairs)
+{
+    // keep last frame's order for the boxes that are still here, refresh
+    // their keys, and append the new ones at the end
+    size_t kept = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        int id = order[i].id;
+        if (insertedFrame[id] == frame)
+        {
+            order[kept].id = id;
+            order[kept].minX = boxes[id].min.x;
+            // flag it so the append loop below skips it
+            insertedFrame[id] = frame + 1;
+            kept++;
+        }
+    }
+    order.resize(kept);
+    for (size_t id = 0; id < insertedFrame.size(); id++)
+    {
+        if (insertedFrame[id] == frame)
+        {
+            order.push_back({boxes[id].min.x, static_cast<int>(id)});
+        }
+        insertedFrame[id] = insertedFrame[id] == frame + 1 ? frame : insertedFrame[id];
+    }
+
+    const size_t count = order.size();
+    if (!InsertionSort(count * 8 + 1024))
+    {
+        RadixSort();
+    }
+
+    // structure-of-arrays copy in sorted order for the sweep
+    minX.resize(count);
+    maxX.resize(count);
+    minY.resize(count);
+    maxY.resize(count);
+    ids.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const AABB &box = boxes[order[i].id];
+        minX[i] = box.min.x;
+        maxX[i] = box.max.x;
+        minY[i] = box.min.y;
+        maxY[i] = box.max.y;
+        ids[i] = order[i].id;
+    }
+
+    const float *minXs = minX.data();
+    const float *minYs = minY.data();
+    const float *maxYs = maxY.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        const float boxMaxX = maxX[i];
+        const float boxMinY = minY[i];
+        const float boxMaxY = maxY[i];
+
+        // candidates: everything after i that starts before i ends on X
+        size_t end = i + 1;
+        while (end < count && minXs[end] < boxMaxX)
+        {
+            end++;
+        }
+        size_t run = end - i - 1;
+        if (run == 0)
+        {
+            continue;
+        }
+
+        // branch-free Y test over the run, vectorized by the compiler
+        if (hits.size() < run)
+        {
+            hits.resize(run);
+        }
+        uint8_t *hit = hits.data();
+        const float *runMinY = minYs + i + 1;
+        const float *runMaxY = maxYs + i + 1;
+        for (size_t k = 0; k < run; k++)
+        {
+            hit[k] = static_cast<uint8_t>((runMinY[k] < boxMaxY) & (runMaxY[k] > boxMinY));
+        }
+
+        for (size_t k = 0; k < run; k++)
+        {
+            if (hit[k])
+            {
+                int a = ids[i];
+                int b = ids[i + 1 + k];
+                pairs.push_back(a < b ? CollisionPair{a, b} : CollisionPair{b, a});
+            }
+        }
+    }
+}
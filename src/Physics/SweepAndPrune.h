@@ -0,0 +1,65 @@
+#ifndef SWEEPANDPRUNE_H
+#define SWEEPANDPRUNE_H
+
+#include <cstdint>
+#include <vector>
+#include "AABB.h"
+#include "../Memory/FrameArena.h"
+
+// Sort-and-sweep broadphase on the X axis. The boxes are kept sorted by
+// min x from one frame to the next, so with the small per-frame motion of a
+// scrolling scene an insertion sort only does a handful of swaps. When too
+// much changed (lots of spawns, a teleport, the first frame) the insertion
+// sort gives up and a parallel radix sort redoes the order.
+//
+// The sweep reads structure-of-arrays min/max copies in sorted order: for
+// each box it finds the run of boxes starting before it ends on X, then tests
+// Y overlap over that whole run in one branch-free loop the compiler turns
+// into SIMD, and only then compacts the hits.
+class SweepAndPrune
+{
+private:
+    struct SortKey
+    {
+        float minX;
+        int id;
+    };
+
+    // indexed by id
+    std::vector<AABB> boxes;
+    std::vector<uint32_t> insertedFrame;
+    uint32_t frame;
+    int insertedCount;
+
+    // sorted order, kept between frames
+    std::vector<SortKey> order;
+    std::vector<SortKey> scratch;
+    std::vector<float> minX;
+    std::vector<float> maxX;
+    std::vector<float> minY;
+    std::vector<float> maxY;
+    std::vector<int> ids;
+    std::vector<uint8_t> hits;
+
+    size_t insertionShifts;
+    size_t radixSorts;
+
+    bool InsertionSort(size_t budget);
+    void RadixSort();
+
+public:
+    SweepAndPrune();
+
+    // starts a new frame; every box that is still around must be inserted again
+    void Clear();
+    void Insert(int id, const AABB &box);
+    // appends every overlapping pair exactly once, as (smaller id, larger id)
+    void FindPairs(FrameVector<CollisionPair> &pairs);
+
+    // how the last FindPairs sorted: shifts done by the insertion sort, and
+    // how many times so far it had to fall back to the radix sort
+    size_t GetInsertionShifts() const { return insertionShifts; }
+    size_t GetRadixSortCount() const { return radixSorts; }
+};
+
+#endif
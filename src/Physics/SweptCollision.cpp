@@ -0,0 +1,98 @@
+#include "SweptCollision.h"
+#include <algorithm>
+#include <cmath>
+
+void SweepBatch::Clear()
+{
+    startBoxes.clear();
+    deltas.clear();
+    hitFractions.clear();
+    hitTargets.clear();
+    pairProjectiles.clear();
+    pairTargets.clear();
+    originX.clear();
+    originY.clear();
+    inverseDeltaX.clear();
+    inverseDeltaY.clear();
+    targetMinX.clear();
+    targetMinY.clear();
+    targetMaxX.clear();
+    targetMaxY.clear();
+}
+
+int SweepBatch::AddProjectile(const AABB &box, glm::vec2 delta)
+{
+    startBoxes.push_back(box);
+    deltas.push_back(delta);
+    hitFractions.push_back(1.0f);
+    hitTargets.push_back(-1);
+    return static_cast<int>(startBoxes.size()) - 1;
+}
+
+AABB SweepBatch::GetSweptBox(int projectile) const
+{
+    const AABB &start = startBoxes[projectile];
+    AABB end = {start.min + deltas[projectile], start.max + deltas[projectile]};
+    return AABB::Combine(start, end);
+}
+
+void SweepBatch::AddCandidate(int projectile, const AABB &target, int targetId)
+{
+    const AABB &box = startBoxes[projectile];
+    glm::vec2 halfSize = (box.max - box.min) * 0.5f;
+    glm::vec2 center = (box.min + box.max) * 0.5f;
+    glm::vec2 delta = deltas[projectile];
+
+    // a huge slope instead of infinity keeps 0 * inf NaNs out of the slab test
+    // when the segment runs exactly along a target edge
+    const float TINY = 1e-20f;
+    pairProjectiles.push_back(projectile);
+    pairTargets.push_back(targetId);
+    originX.push_back(center.x);
+    originY.push_back(center.y);
+    inverseDeltaX.push_back(1.0f / (std::abs(delta.x) > TINY ? delta.x : TINY));
+    inverseDeltaY.push_back(1.0f / (std::abs(delta.y) > TINY ? delta.y : TINY));
+    targetMinX.push_back(target.min.x - halfSize.x);
+    targetMinY.push_back(target.min.y - halfSize.y);
+    targetMaxX.push_back(target.max.x + halfSize.x);
+    targetMaxY.push_back(target.max.y + halfSize.y);
+}
+
+void SweepBatch::Solve()
+{
+    const size_t count = pairProjectiles.size();
+    entryTimes.resize(count);
+
+    const float *ox = originX.data();
+    const float *oy = originY.data();
+    const float *idx = inverseDeltaX.data();
+    const float *idy = inverseDeltaY.data();
+    const float *minX = targetMinX.data();
+    const float *minY = targetMinY.data();
+    const float *maxX = targetMaxX.data();
+    const float *maxY = targetMaxY.data();
+    float *entry = entryTimes.data();
+
+    // slab test for every pair, no branches so it vectorizes; a miss gets an
+    // entry time above 1
+    for (size_t i = 0; i < count; i++)
+    {
+        float t1x = (minX[i] - ox[i]) * idx[i];
+        float t2x = (maxX[i] - ox[i]) * idx[i];
+        float t1y = (minY[i] - oy[i]) * idy[i];
+        float t2y = (maxY[i] - oy[i]) * idy[i];
+        float enter = std::max(std::max(std::min(t1x, t2x), std::min(t1y, t2y)), 0.0f);
+        float exit = std::min(std::min(std::max(t1x, t2x), std::max(t1y, t2y)), 1.0f);
+        entry[i] = enter <= exit ? enter : 2.0f;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int projectile = pairProjectiles[i];
+        if (entry[i] < hitFractions[projectile] || (entry[i] <= 1.0f && hitTargets[projectile] < 0))
+        {
+            hitFractions[projectile] = entry[i];
+            hitTargets[projectile] = pairTargets[i];
+        }
+    }
+}
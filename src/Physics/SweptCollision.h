@@ -0,0 +1,53 @@
+#ifndef SWEPTCOLLISION_H
+#define SWEPTCOLLISION_H
+
+#include <vector>
+#include "AABB.h"
+
+// Time of impact for a batch of moving boxes against static targets.
+//
+// Each (projectile, candidate target) pair is reduced to a segment against
+// an AABB by growing the target by the projectile's half size (Minkowski
+// sum), and all pairs of the frame are stored flattened as structure of
+// arrays. Solve() then runs one branch-free slab test over every pair, which
+// the compiler vectorizes, and a scalar pass keeps the earliest hit per
+// projectile.
+class SweepBatch
+{
+private:
+    // per projectile
+    std::vector<AABB> startBoxes;
+    std::vector<glm::vec2> deltas;
+    std::vector<float> hitFractions;
+    std::vector<int> hitTargets;
+
+    // per pair
+    std::vector<int> pairProjectiles;
+    std::vector<int> pairTargets;
+    std::vector<float> originX;
+    std::vector<float> originY;
+    std::vector<float> inverseDeltaX;
+    std::vector<float> inverseDeltaY;
+    std::vector<float> targetMinX;
+    std::vector<float> targetMinY;
+    std::vector<float> targetMaxX;
+    std::vector<float> targetMaxY;
+    std::vector<float> entryTimes;
+
+public:
+    void Clear();
+    // returns the projectile index used by the other calls
+    int AddProjectile(const AABB &box, glm::vec2 delta);
+    // box covering the whole move, for the broadphase query
+    AABB GetSweptBox(int projectile) const;
+    void AddCandidate(int projectile, const AABB &target, int targetId);
+    void Solve();
+
+    // fraction of the move at the first contact, 1 if nothing was hit
+    float GetHitFraction(int projectile) const { return hitFractions[projectile]; }
+    // target id passed to AddCandidate, -1 if nothing was hit
+    int GetHitTarget(int projectile) const { return hitTargets[projectile]; }
+    size_t GetProjectileCount() const { return startBoxes.size(); }
+};
+
+#endif
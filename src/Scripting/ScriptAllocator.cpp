@@ -0,0 +1,116 @@
+#include "ScriptAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+ScriptAllocator::~ScriptAllocator()
+{
+    for (void *slab : slabs)
+    {
+        std::free(slab);
+    }
+}
+
+bool ScriptAllocator::Refill(size_t sizeClass)
+{
+    char *slab = static_cast<char *>(std::malloc(SLAB_SIZE));
+    if (!slab)
+    {
+        return false;
+    }
+    slabs.push_back(slab);
+    // chain back to front so the free list hands out ascending addresses
+    size_t blockSize = (sizeClass + 1) * GRANULE;
+    for (size_t offset = (SLAB_SIZE / blockSize) * blockSize; offset > 0;)
+    {
+        offset -= blockSize;
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(slab + offset);
+        block->next = freeLists[sizeClass];
+        freeLists[sizeClass] = block;
+    }
+    return true;
+}
+
+void *ScriptAllocator::New(size_t size)
+{
+    if (size > MAX_POOLED_SIZE)
+    {
+        return std::malloc(size);
+    }
+    size_t sizeClass = SizeClass(size);
+    if (!freeLists[sizeClass] && !Refill(sizeClass))
+    {
+        return nullptr;
+    }
+    FreeBlock *block = freeLists[sizeClass];
+    freeLists[sizeClass] = block->next;
+    return block;
+}
+
+void ScriptAllocator::Delete(void *block, size_t size)
+{
+    if (size > MAX_POOLED_SIZE)
+    {
+        std::free(block);
+        return;
+    }
+    FreeBlock *freed = static_cast<FreeBlock *>(block);
+    size_t sizeClass = SizeClass(size);
+    freed->next = freeLists[sizeClass];
+    freeLists[sizeClass] = freed;
+}
+
+void *ScriptAllocator::Allocate(void *userData, void *block, size_t oldSize, size_t newSize)
+{
+    ScriptAllocator &allocator = *static_cast<ScriptAllocator *>(userData);
+    // without a block, oldSize is the type of object being made
+    if (!block)
+    {
+        oldSize = 0;
+    }
+
+    if (newSize == 0)
+    {
+        if (block)
+        {
+            allocator.Delete(block, oldSize);
+            allocator.bytesInUse -= oldSize;
+        }
+        return nullptr;
+    }
+    if (allocator.limit && newSize > oldSize && allocator.bytesInUse + (newSize - oldSize) > allocator.limit)
+    {
+        allocator.failedCount++;
+        return nullptr;
+    }
+
+    void *moved;
+    if (block && oldSize > MAX_POOLED_SIZE && newSize > MAX_POOLED_SIZE)
+    {
+        moved = std::realloc(block, newSize);
+    }
+    else if (block && oldSize <= MAX_POOLED_SIZE && newSize <= MAX_POOLED_SIZE && SizeClass(oldSize) == SizeClass(newSize))
+    {
+        moved = block;
+    }
+    else
+    {
+        moved = allocator.New(newSize);
+        if (moved && block)
+        {
+            std::memcpy(moved, block, std::min(oldSize, newSize));
+            allocator.Delete(block, oldSize);
+        }
+    }
+    // on failure Lua still owns the old block as it was
+    if (!moved)
+    {
+        allocator.failedCount++;
+        return nullptr;
+    }
+
+    allocator.bytesInUse += newSize - oldSize;
+    allocator.peakBytes = std::max(allocator.peakBytes, allocator.bytesInUse);
+    allocator.allocationCount++;
+    return moved;
+}
@@ -0,0 +1,74 @@
+#ifndef SCRIPTALLOCATOR_H
+#define SCRIPTALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// lua_Alloc for the engine's Lua states, one allocator per state.
+//
+// Nearly everything Lua allocates is small: strings, tables, closures,
+// upvalues. Blocks up to MAX_POOLED_SIZE bytes are rounded up to a multiple
+// of GRANULE and taken from a free list per size class, refilled a slab at a
+// time, so allocating and freeing them never reaches malloc. Lua always
+// tells the allocator the size of the block it frees, so pooled blocks need
+// no header. Larger blocks (array parts, long strings, stacks) go to
+// malloc/realloc as before.
+//
+// Every byte Lua asks for is counted. With a limit set, an allocation that
+// would go over it fails, which Lua answers with an emergency collection and
+// then a "not enough memory" error in the script. Slabs are kept until the
+// allocator goes away, so pooled memory freed by a script is reused by the
+// same state but not handed back to the system.
+class ScriptAllocator
+{
+public:
+    static const size_t GRANULE = 16;
+    static const size_t MAX_POOLED_SIZE = 256;
+    static const size_t SLAB_SIZE = 32 * 1024;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    FreeBlock *freeLists[MAX_POOLED_SIZE / GRANULE] = {};
+    std::vector<void *> slabs;
+    size_t bytesInUse = 0;
+    size_t peakBytes = 0;
+    size_t limit = 0;
+    uint64_t allocationCount = 0;
+    uint64_t failedCount = 0;
+
+    static size_t SizeClass(size_t size) { return (size - 1) / GRANULE; }
+
+    bool Refill(size_t sizeClass);
+    void *New(size_t size);
+    void Delete(void *block, size_t size);
+
+public:
+    ScriptAllocator() = default;
+    ~ScriptAllocator();
+    ScriptAllocator(const ScriptAllocator &) = delete;
+    ScriptAllocator &operator=(const ScriptAllocator &) = delete;
+
+    // the lua_Alloc, with the allocator as its user data:
+    //   sol::state lua(sol::default_at_panic, ScriptAllocator::Allocate, &allocator);
+    static void *Allocate(void *allocator, void *block, size_t oldSize, size_t newSize);
+
+    // 0, the default, is no limit; a limit below what is in use only stops growth
+    void SetLimit(size_t bytes) { limit = bytes; }
+    size_t GetLimit() const { return limit; }
+
+    // bytes Lua holds right now and at most so far
+    size_t GetBytesInUse() const { return bytesInUse; }
+    size_t GetPeakBytes() const { return peakBytes; }
+    // memory taken from the system for the pools
+    size_t GetSlabBytes() const { return slabs.size() * SLAB_SIZE; }
+    uint64_t GetAllocationCount() const { return allocationCount; }
+    // allocations that failed, nearly always because of the limit
+    uint64_t GetFailedCount() const { return failedCount; }
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "ScriptBatch.h"
+
+namespace
+{
+    const char *FIELD_NAMES[] = {"id", "x", "y", "vx", "vy"};
+
+    // #batch, the entity count kept in the userdata itself
+    int BatchLength(lua_State *state)
+    {
+        lua_pushinteger(state, static_cast<lua_Integer>(*static_cast<size_t *>(lua_touserdata(state, 1))));
+        return 1;
+    }
+
+    // what the script left at the stack slot, or the old value if that is no number
+    float ReadNumber(lua_State *state, int slot, float old)
+    {
+        int isNumber = 0;
+        lua_Number value = lua_tonumberx(state, slot, &isNumber);
+        return isNumber ? static_cast<float>(value) : old;
+    }
+}
+
+void ScriptBatch::Create(sol::state &lua)
+{
+    state = lua.lua_state();
+    *static_cast<size_t *>(lua_newuserdatauv(state, sizeof(size_t), 0)) = 0;
+    // a metatable of its own, since the arrays behind __index belong to this batch
+    lua_createtable(state, 0, 2);
+    lua_createtable(state, 0, FIELD_COUNT);
+    for (int field = 0; field < FIELD_COUNT; field++)
+    {
+        lua_createtable(state, 0, 0);
+        arrays[field] = sol::reference(state, -1);
+        lua_setfield(state, -2, FIELD_NAMES[field]);
+    }
+    lua_setfield(state, -2, "__index");
+    lua_pushcfunction(state, BatchLength);
+    lua_setfield(state, -2, "__len");
+    lua_setmetatable(state, -2);
+    handle = sol::reference(state, -1);
+    lua_pop(state, 1);
+}
+
+void ScriptBatch::Gather(const Entity *first, size_t count, const ScriptSnapshot &snapshot)
+{
+    entities.assign(first, first + count);
+    gathered.resize(count);
+    handle.push(state);
+    *static_cast<size_t *>(lua_touserdata(state, -1)) = count;
+    lua_pop(state, 1);
+
+    // all arrays on the stack at once, filled in one pass over the entities
+    const int base = lua_gettop(state) + 1;
+    for (const auto &array : arrays)
+    {
+        array.push(state);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const Entity &entity = entities[i];
+        const lua_Integer index = static_cast<lua_Integer>(i + 1);
+        const ScriptSnapshot::Entry *entry = snapshot.Find(entity.GetId());
+        gathered[i] = entry ? *entry : ScriptSnapshot::Entry();
+        const ScriptSnapshot::Entry &values = gathered[i];
+        lua_pushinteger(state, entity.GetId());
+        lua_rawseti(state, base + FIELD_ID, index);
+        lua_pushnumber(state, values.x);
+        lua_rawseti(state, base + FIELD_X, index);
+        lua_pushnumber(state, values.y);
+        lua_rawseti(state, base + FIELD_Y, index);
+        lua_pushnumber(state, values.vx);
+        lua_rawseti(state, base + FIELD_VX, index);
+        lua_pushnumber(state, values.vy);
+        lua_rawseti(state, base + FIELD_VY, index);
+    }
+    lua_settop(state, base - 1);
+}
+
+void ScriptBatch::Scatter(ScriptCommandBuffer &commands) const
+{
+    const int base = lua_gettop(state) + 1;
+    for (const auto &array : arrays)
+    {
+        array.push(state);
+    }
+    // the four values of an entity go on the stack together and come off in one go
+    const int values = base + FIELD_COUNT;
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        const Entity &entity = entities[i];
+        if (entity.GetId() < 0)
+        {
+            continue;
+        }
+        const lua_Integer index = static_cast<lua_Integer>(i + 1);
+        lua_rawgeti(state, base + FIELD_X, index);
+        lua_rawgeti(state, base + FIELD_Y, index);
+        lua_rawgeti(state, base + FIELD_VX, index);
+        lua_rawgeti(state, base + FIELD_VY, index);
+        // only what the script changed: a call that ran on into the next
+        // frame would otherwise write the old frame's values back over the
+        // MovementSystem step in between
+        const ScriptSnapshot::Entry &old = gathered[i];
+        const float x = ReadNumber(state, values, old.x);
+        const float y = ReadNumber(state, values + 1, old.y);
+        if (x != old.x || y != old.y)
+        {
+            commands.SetPosition(entity, x, y);
+        }
+        const float vx = ReadNumber(state, values + 2, old.vx);
+        const float vy = ReadNumber(state, values + 3, old.vy);
+        if (old.hasBody && (vx != old.vx || vy != old.vy))
+        {
+            commands.SetVelocity(entity, vx, vy);
+        }
+        lua_settop(state, values - 1);
+    }
+    lua_settop(state, base - 1);
+}
+
+void ScriptBatch::Forget(Entity entity)
+{
+    for (auto &member : entities)
+    {
+        if (member == entity)
+        {
+            member = Entity(-1);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef SCRIPTBATCH_H
+#define SCRIPTBATCH_H
+
+#include <cstddef>
+#include <vector>
+#include "ScriptBindings.h"
+#include "ScriptCommandBuffer.h"
+#include "ScriptSnapshot.h"
+#include "../ECS/ECS.h"
+
+// A chunk of scripted entities handed to Lua in one call, as one userdata.
+//
+// Calling into Lua costs far more than what a script does with one entity,
+// and so does every call from Lua back into C, userdata methods included:
+// at four accessor calls per entity a batch barely beat calling the script
+// once per entity. So the fields scripts work on are laid out as plain Lua
+// arrays that hang off the batch, and the script loops over them without
+// leaving Lua:
+//
+//   function behavior.update_batch(batch, dt)
+//       local x, y, vx, vy = batch.x, batch.y, batch.vx, batch.vy
+//       for i = 1, #batch do
+//           x[i] = x[i] + vx[i] * dt
+//       end
+//   end
+//
+// batch.id holds the entity ids, batch.x/y the TransformerComponent
+// positions and batch.vx/vy the RigidBodyComponent velocities (0 and
+// ignored for entities without one). Gather() fills the arrays from the
+// frame's ScriptSnapshot and Scatter() hands the positions and velocities
+// the script changed to the state's ScriptCommandBuffer. The arrays are
+// reused for every chunk, so they may hold stale entries past #batch and
+// must not be kept by the script.
+class ScriptBatch
+{
+private:
+    enum Field
+    {
+        FIELD_ID,
+        FIELD_X,
+        FIELD_Y,
+        FIELD_VX,
+        FIELD_VY,
+        FIELD_COUNT
+    };
+
+    lua_State *state = nullptr;
+    sol::reference handle;
+    sol::reference arrays[FIELD_COUNT];
+    std::vector<Entity> entities;
+    // what was gathered, kept for values the script leaves unusable
+    std::vector<ScriptSnapshot::Entry> gathered;
+
+public:
+    // builds the userdata and its arrays in the state; must be called
+    // before anything else and the batch must not outlive the state
+    void Create(sol::state &lua);
+
+    void Gather(const Entity *first, size_t count, const ScriptSnapshot &snapshot);
+    void Scatter(ScriptCommandBuffer &commands) const;
+    // an entity killed while a script still works on the batch is not written back
+    void Forget(Entity entity);
+
+    size_t Size() const { return entities.size(); }
+    // the userdata to pass to update_batch
+    const sol::reference &GetHandle() const { return handle; }
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "ScriptBindings.h"
+#include <tuple>
+#include "ScriptCommandBuffer.h"
+#include "ScriptSnapshot.h"
+#include "../ECS/ECS.h"
+
+namespace
+{
+    const ScriptSnapshot::Entry *FindEntry(lua_State *state)
+    {
+        const auto *snapshot = static_cast<const ScriptSnapshot *>(lua_touserdata(state, lua_upvalueindex(1)));
+        return snapshot->Find(static_cast<int>(luaL_checkinteger(state, 1)));
+    }
+
+    // world.position(id) -> x, y, or nil
+    int WorldPosition(lua_State *state)
+    {
+        const ScriptSnapshot::Entry *entry = FindEntry(state);
+        if (!entry)
+        {
+            lua_pushnil(state);
+            return 1;
+        }
+        lua_pushnumber(state, entry->x);
+        lua_pushnumber(state, entry->y);
+        return 2;
+    }
+
+    // world.velocity(id) -> vx, vy, or nil
+    int WorldVelocity(lua_State *state)
+    {
+        const ScriptSnapshot::Entry *entry = FindEntry(state);
+        if (!entry)
+        {
+            lua_pushnil(state);
+            return 1;
+        }
+        lua_pushnumber(state, entry->vx);
+        lua_pushnumber(state, entry->vy);
+        return 2;
+    }
+}
+
+void RegisterScriptBindings(sol::state &lua, const ScriptSnapshot &snapshot, ScriptCommandBuffer &commands)
+{
+    const ScriptSnapshot *frame = &snapshot;
+    ScriptCommandBuffer *changes = &commands;
+    lua.new_usertype<Entity>(
+        "Entity", sol::no_constructor,
+        "id", &Entity::GetId,
+        "position", [frame](const Entity &entity)
+        {
+            const ScriptSnapshot::Entry *entry = frame->Find(entity.GetId());
+            return entry ? std::make_tuple(entry->x, entry->y) : std::make_tuple(0.0f, 0.0f);
+        },
+        "set_position", [changes](const Entity &entity, float x, float y)
+        { changes->SetPosition(entity, x, y); },
+        "velocity", [frame](const Entity &entity)
+        {
+            const ScriptSnapshot::Entry *entry = frame->Find(entity.GetId());
+            return entry ? std::make_tuple(entry->vx, entry->vy) : std::make_tuple(0.0f, 0.0f);
+        },
+        "set_velocity", [changes](const Entity &entity, float x, float y)
+        { changes->SetVelocity(entity, x, y); });
+
+    // world.* are plain C functions with the snapshot as their upvalue
+    lua_State *state = lua.lua_state();
+    lua_createtable(state, 0, 2);
+    lua_pushlightuserdata(state, const_cast<ScriptSnapshot *>(frame));
+    lua_pushcclosure(state, WorldPosition, 1);
+    lua_setfield(state, -2, "position");
+    lua_pushlightuserdata(state, const_cast<ScriptSnapshot *>(frame));
+    lua_pushcclosure(state, WorldVelocity, 1);
+    lua_setfield(state, -2, "velocity");
+    lua_setglobal(state, "world");
+}
@@ -0,0 +1,28 @@
+#ifndef SCRIPTBINDINGS_H
+#define SCRIPTBINDINGS_H
+
+// the bundled sol 3.2.1 uses std::numeric_limits without including <limits>,
+// so code includes sol through this header. at -O2 GCC also sees a false
+// -Warray-bounds in its string literal compares, silenced for sol only
+#include <limits>
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#include <sol/sol.hpp>
+#pragma GCC diagnostic pop
+
+class ScriptSnapshot;
+class ScriptCommandBuffer;
+
+// makes the engine types scripts see known to a Lua state: Entity, for
+// behaviours called once per entity, with entity:id(), entity:position()
+// -> x, y, entity:set_position(x, y), entity:velocity() -> x, y and
+// entity:set_velocity(x, y), and the table world, with world.position(id)
+// and world.velocity(id) of any scripted entity, nil for others. Batches
+// are plain userdata, see ScriptBatch.
+//
+// Reads come from the frame's snapshot and writes go into the state's
+// command buffer, so a script reads what the frame started with even after
+// setting it; both must outlive the state.
+void RegisterScriptBindings(sol::state &lua, const ScriptSnapshot &snapshot, ScriptCommandBuffer &commands);
+
+#endif
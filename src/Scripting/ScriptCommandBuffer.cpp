@@ -0,0 +1,23 @@
+#include "ScriptCommandBuffer.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/RigidBodyComponent.h"
+
+void ScriptCommandBuffer::Apply()
+{
+    for (const auto &command : commands)
+    {
+        switch (command.kind)
+        {
+        case SET_POSITION:
+            command.entity.GetComponent<TransformerComponent>().position = glm::vec2(command.x, command.y);
+            break;
+        case SET_VELOCITY:
+            if (command.entity.HasComponent<RigidBodyComponent>())
+            {
+                command.entity.GetComponent<RigidBodyComponent>().velocity = glm::vec2(command.x, command.y);
+            }
+            break;
+        }
+    }
+    commands.clear();
+}
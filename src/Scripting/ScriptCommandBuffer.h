@@ -0,0 +1,42 @@
+#ifndef SCRIPTCOMMANDBUFFER_H
+#define SCRIPTCOMMANDBUFFER_H
+
+#include <cstddef>
+#include <vector>
+#include "../ECS/ECS.h"
+
+// What the scripts of one Lua state changed during a frame, in the order
+// they did it. Scripts on worker threads never write components; the
+// ScriptSystem applies every state's buffer on the main thread once all of
+// them are done, so what runs in parallel only ever touches its own state.
+class ScriptCommandBuffer
+{
+private:
+    enum Kind
+    {
+        SET_POSITION,
+        SET_VELOCITY
+    };
+
+    struct Command
+    {
+        Entity entity;
+        Kind kind;
+        float x;
+        float y;
+    };
+
+    std::vector<Command> commands;
+
+public:
+    void SetPosition(Entity entity, float x, float y) { commands.push_back({entity, SET_POSITION, x, y}); }
+    // ignored for an entity without a RigidBodyComponent
+    void SetVelocity(Entity entity, float x, float y) { commands.push_back({entity, SET_VELOCITY, x, y}); }
+
+    // writes the components and empties the buffer
+    void Apply();
+
+    size_t Size() const { return commands.size(); }
+};
+
+#endif
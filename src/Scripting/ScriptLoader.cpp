@@ -0,0 +1,269 @@
+#include "ScriptLoader.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+#include "../Logger/Logger.h"
+
+namespace
+{
+    const char PACK_MAGIC[4] = {'2', 'D', 'S', 'P'};
+
+    bool ReadFile(const std::string &path, std::string &contents)
+    {
+        // one read of the known size, not a stream of characters
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            return false;
+        }
+        std::streamsize size = file.tellg();
+        contents.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(&contents[0], size));
+    }
+
+    // written next to the target and renamed over it, so a crash or a second
+    // game writing the same file never leaves half a file behind
+    bool WriteFile(const std::string &path, const char *data, size_t size)
+    {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file || !file.write(data, static_cast<std::streamsize>(size)))
+            {
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        return !error;
+    }
+
+    int AppendBytecode(lua_State *, const void *data, size_t size, void *out)
+    {
+        static_cast<std::string *>(out)->append(static_cast<const char *>(data), size);
+        return 0;
+    }
+
+    // bytecode of the function on top of the stack, with its debug info so
+    // errors still carry line numbers
+    bool Dump(lua_State *state, std::string &bytecode)
+    {
+        bytecode.clear();
+        return lua_dump(state, AppendBytecode, &bytecode, 0) == 0;
+    }
+
+    template <typename T>
+    void Put(std::string &out, T value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool Get(const std::vector<char> &in, size_t &offset, T &value)
+    {
+        if (in.size() - offset < sizeof(T))
+        {
+            return false;
+        }
+        std::memcpy(&value, in.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    std::string HashName(uint64_t hash)
+    {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+        return name;
+    }
+}
+
+uint64_t ScriptLoader::HashSource(const std::string &source)
+{
+    // FNV-1a over 8-byte words rather than bytes, seeded with the Lua version
+    // so an upgrade misses every old entry
+    const uint64_t prime = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull ^ static_cast<uint64_t>(LUA_VERSION_NUM);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= source.size(); i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, source.data() + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < source.size(); i++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(source[i])) * prime;
+    }
+    // the length too, so sources differing only in trailing zero bytes differ
+    return (hash ^ source.size()) * prime;
+}
+
+void ScriptLoader::SetCacheDirectory(const std::string &directory)
+{
+    cacheDirectory = directory;
+    if (!directory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error)
+        {
+            Logger::Err("Could not create the script cache " + directory + ", scripts are compiled every run");
+            cacheDirectory.clear();
+        }
+    }
+}
+
+bool ScriptLoader::OpenPack(const std::string &path)
+{
+    pack.clear();
+    packEntries.clear();
+    std::string contents;
+    if (!ReadFile(path, contents))
+    {
+        return false;
+    }
+    pack.assign(contents.begin(), contents.end());
+
+    size_t offset = 0;
+    char magic[4];
+    uint16_t version = 0;
+    uint32_t count = 0;
+    bool valid = Get(pack, offset, magic) && std::memcmp(magic, PACK_MAGIC, sizeof(magic)) == 0 &&
+                 Get(pack, offset, version) && version == PACK_VERSION && Get(pack, offset, count);
+    for (uint32_t i = 0; valid && i < count; i++)
+    {
+        uint64_t hash = 0;
+        uint32_t size = 0;
+        valid = Get(pack, offset, hash) && Get(pack, offset, size) && pack.size() - offset >= size;
+        if (valid)
+        {
+            packEntries[hash] = std::make_pair(offset, static_cast<size_t>(size));
+            offset += size;
+        }
+    }
+    if (!valid)
+    {
+        Logger::Err("Script pack " + path + " is damaged or from another version, ignoring it");
+        pack.clear();
+        packEntries.clear();
+        return false;
+    }
+    LOGGER_INFO(LOG_SCRIPT, "Opened script pack " + path + " with " + std::to_string(count) + " scripts");
+    return true;
+}
+
+sol::load_result ScriptLoader::Load(sol::state &lua, const std::string &path)
+{
+    std::string source;
+    if (!ReadFile(path, source))
+    {
+        lua_State *state = lua.lua_state();
+        lua_pushstring(state, ("cannot open " + path).c_str());
+        return sol::load_result(state, lua_absindex(state, -1), 1, 1, sol::load_status::file);
+    }
+    // '@' marks a file name, as luaL_loadfile does
+    return LoadChunk(lua, source, "@" + path);
+}
+
+sol::load_result ScriptLoader::LoadSource(sol::state &lua, const std::string &source, const std::string &chunkName)
+{
+    return LoadChunk(lua, source, chunkName);
+}
+
+sol::load_result ScriptLoader::LoadChunk(sol::state &lua, const std::string &source, const std::string &chunkName)
+{
+    lua_State *state = lua.lua_state();
+    const uint64_t hash = HashSource(source);
+
+    auto packed = packEntries.find(hash);
+    if (packed != packEntries.end())
+    {
+        const char *bytecode = pack.data() + packed->second.first;
+        if (luaL_loadbufferx(state, bytecode, packed->second.second, chunkName.c_str(), "b") == LUA_OK)
+        {
+            packHitCount++;
+            return sol::load_result(state, lua_absindex(state, -1), 1, 1, sol::load_status::ok);
+        }
+        lua_pop(state, 1);
+    }
+
+    std::string cachePath;
+    std::string bytecode;
+    if (!cacheDirectory.empty())
+    {
+        cachePath = cacheDirectory + "/" + HashName(hash) + ".luac";
+        if (ReadFile(cachePath, bytecode))
+        {
+            if (luaL_loadbufferx(state, bytecode.data(), bytecode.size(), chunkName.c_str(), "b") == LUA_OK)
+            {
+                cacheHitCount++;
+                return sol::load_result(state, lua_absindex(state, -1), 1, 1, sol::load_status::ok);
+            }
+            lua_pop(state, 1);
+            LOGGER_DEBUG(LOG_SCRIPT, "Dropping unloadable bytecode " + cachePath);
+        }
+    }
+
+    // sources are only ever text; bytecode only comes from the pack or the cache
+    compiledCount++;
+    int status = luaL_loadbufferx(state, source.data(), source.size(), chunkName.c_str(), "t");
+    if (status == LUA_OK && !cachePath.empty())
+    {
+        if (!Dump(state, bytecode) || !WriteFile(cachePath, bytecode.data(), bytecode.size()))
+        {
+            LOGGER_WARN(LOG_SCRIPT, "Could not cache the bytecode of " + chunkName);
+        }
+    }
+    return sol::load_result(state, lua_absindex(state, -1), 1, 1, static_cast<sol::load_status>(status));
+}
+
+int ScriptLoader::WritePack(const std::vector<std::string> &paths, const std::string &packPath)
+{
+    std::unique_ptr<lua_State, decltype(&lua_close)> state(luaL_newstate(), &lua_close);
+    std::string entries;
+    std::unordered_set<uint64_t> packed;
+    std::string source;
+    std::string bytecode;
+    for (const auto &path : paths)
+    {
+        if (!ReadFile(path, source))
+        {
+            Logger::Err("Could not read script " + path);
+            return -1;
+        }
+        std::string chunkName = "@" + path;
+        if (luaL_loadbufferx(state.get(), source.data(), source.size(), chunkName.c_str(), "t") != LUA_OK)
+        {
+            Logger::Err(std::string("Script does not compile: ") + lua_tostring(state.get(), -1));
+            return -1;
+        }
+        bool dumped = Dump(state.get(), bytecode);
+        lua_pop(state.get(), 1);
+        uint64_t hash = HashSource(source);
+        // the same source twice needs one entry
+        if (!dumped || !packed.insert(hash).second)
+        {
+            continue;
+        }
+        Put(entries, hash);
+        Put(entries, static_cast<uint32_t>(bytecode.size()));
+        entries += bytecode;
+    }
+
+    std::string file(PACK_MAGIC, sizeof(PACK_MAGIC));
+    Put(file, PACK_VERSION);
+    Put(file, static_cast<uint32_t>(packed.size()));
+    file += entries;
+    if (!WriteFile(packPath, file.data(), file.size()))
+    {
+        Logger::Err("Could not write script pack " + packPath);
+        return -1;
+    }
+    return static_cast<int>(packed.size());
+}
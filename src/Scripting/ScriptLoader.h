@@ -0,0 +1,63 @@
+#ifndef SCRIPTLOADER_H
+#define SCRIPTLOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ScriptBindings.h"
+
+// Loads Lua scripts without running the Lua parser when it can be avoided.
+//
+// The bytecode of a script is looked up by a hash of its source text, first
+// in a pack (one file with the bytecode of every shipped script, made by
+// tools/ScriptPacker.cpp at build time), then in the cache directory, where
+// every compiled script leaves a <hash>.luac file for the next start. Only
+// scripts found in neither are compiled. Editing a script changes its hash,
+// so stale bytecode is never picked up; bytecode that does not load (say,
+// from another Lua version) is dropped and the source compiled instead.
+//
+// Bytecode is trusted as it is: the cache directory and the pack must not
+// come from anyone who should not run code in the game. Bytecode keeps the
+// chunk name it was compiled with, so errors from a script that moved name
+// its old path until the source changes.
+class ScriptLoader
+{
+private:
+    std::string cacheDirectory;
+    // the whole pack, and where each script's bytecode sits in it
+    std::vector<char> pack;
+    std::unordered_map<uint64_t, std::pair<size_t, size_t>> packEntries;
+    int compiledCount = 0;
+    int cacheHitCount = 0;
+    int packHitCount = 0;
+
+    sol::load_result LoadChunk(sol::state &lua, const std::string &source, const std::string &chunkName);
+
+public:
+    // pack file layout: "2DSP" | u16 version | u32 count | count x (u64 source hash | u32 size | bytecode)
+    static const uint16_t PACK_VERSION = 1;
+
+    static uint64_t HashSource(const std::string &source);
+    // compiles every script and writes their bytecode into one pack file;
+    // returns the number packed, or -1 when a script does not compile or the
+    // pack cannot be written
+    static int WritePack(const std::vector<std::string> &paths, const std::string &packPath);
+
+    // an empty directory turns the cache off, which is the default
+    void SetCacheDirectory(const std::string &directory);
+    // a missing pack is not an error, it just leaves the loader without one
+    bool OpenPack(const std::string &path);
+
+    // like sol's load_file and load: the chunk is compiled but not run
+    sol::load_result Load(sol::state &lua, const std::string &path);
+    sol::load_result LoadSource(sol::state &lua, const std::string &source, const std::string &chunkName);
+
+    // scripts that went through the parser, and bytecode hits, since start
+    int GetCompiledCount() const { return compiledCount; }
+    int GetCacheHitCount() const { return cacheHitCount; }
+    int GetPackHitCount() const { return packHitCount; }
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "ScriptScheduler.h"
+
+namespace
+{
+    // the scheduler whose resume is running on this thread, for the hook
+    thread_local ScriptScheduler *running = nullptr;
+    thread_local lua_State *runningThread = nullptr;
+}
+
+void ScriptScheduler::Hook(lua_State *thread, lua_Debug *)
+{
+    ScriptScheduler *scheduler = running;
+    if (!scheduler)
+    {
+        return;
+    }
+    scheduler->sliceUsed += HOOK_INTERVAL;
+    *scheduler->sinceYield += HOOK_INTERVAL;
+    scheduler->profile->instructions += HOOK_INTERVAL;
+    // coroutines the script runs itself are counted but left alone, stopping
+    // them would look like a yield to the script; the task is stopped as soon
+    // as it is back in its own code
+    if (thread != runningThread)
+    {
+        return;
+    }
+    if (*scheduler->sinceYield > scheduler->runawayInstructions)
+    {
+        luaL_error(thread, "runaway script stopped after %I instructions without yielding",
+                   static_cast<lua_Integer>(*scheduler->sinceYield));
+        return;
+    }
+    if ((scheduler->sliceUsed >= scheduler->sliceInstructions || !scheduler->HasTimeLeft()) && lua_isyieldable(thread))
+    {
+        scheduler->preempted = true;
+        // from a hook, lua_yield must be the last thing it does
+        lua_yield(thread, 0);
+        return;
+    }
+}
+
+void ScriptScheduler::Attach(lua_State *state)
+{
+    lua_sethook(state, Hook, LUA_MASKCOUNT, HOOK_INTERVAL);
+}
+
+void ScriptScheduler::BeginFrame()
+{
+    auto budget = std::chrono::duration<double, std::milli>(budgetMilliseconds);
+    deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget);
+}
+
+void ScriptScheduler::BeginTurn()
+{
+    sliceUsed = 0;
+    turnStart = std::chrono::steady_clock::now();
+}
+
+void ScriptScheduler::EndTurn(ScriptProfile &taskProfile)
+{
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - turnStart).count();
+    taskProfile.milliseconds += milliseconds;
+    taskProfile.totalMilliseconds += milliseconds;
+}
+
+ResumeResult ScriptScheduler::Resume(lua_State *thread, lua_State *from, int arguments, uint64_t &instructionsSinceYield, ScriptProfile &taskProfile)
+{
+    ScriptScheduler *outerScheduler = running;
+    lua_State *outerThread = runningThread;
+    running = this;
+    runningThread = thread;
+    sinceYield = &instructionsSinceYield;
+    profile = &taskProfile;
+    preempted = false;
+
+    int results = 0;
+    int status = lua_resume(thread, from, arguments, &results);
+
+    running = outerScheduler;
+    runningThread = outerThread;
+    taskProfile.resumes++;
+
+    switch (status)
+    {
+    case LUA_OK:
+        lua_pop(thread, results);
+        instructionsSinceYield = 0;
+        return RESUME_FINISHED;
+    case LUA_YIELD:
+        lua_pop(thread, results);
+        if (preempted)
+        {
+            taskProfile.preemptions++;
+            return RESUME_PREEMPTED;
+        }
+        instructionsSinceYield = 0;
+        return RESUME_YIELDED;
+    default:
+        return RESUME_FAILED;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SCRIPTSCHEDULER_H
+#define SCRIPTSCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "ScriptBindings.h"
+
+// CPU use of one behaviour, for the profiler output of the ScriptSystem
+struct ScriptProfile
+{
+    std::string name;
+    // during the last frame
+    double milliseconds = 0.0;
+    // counted in steps of the hook interval, so approximate
+    uint64_t instructions = 0;
+    int resumes = 0;
+    int preemptions = 0;
+    double totalMilliseconds = 0.0;
+
+    void NewFrame()
+    {
+        milliseconds = 0.0;
+        instructions = 0;
+        resumes = 0;
+        preemptions = 0;
+    }
+};
+
+enum ResumeResult
+{
+    // the coroutine returned
+    RESUME_FINISHED,
+    // it called coroutine.yield()
+    RESUME_YIELDED,
+    // the hook stopped it: its slice or the frame budget ran out
+    RESUME_PREEMPTED,
+    // it raised an error, or ran away; the message is on top of its stack
+    RESUME_FAILED
+};
+
+// Resumes script coroutines against a per-frame time budget.
+//
+// Every HOOK_INTERVAL instructions a count hook looks at the clock and
+// yields the running coroutine once the frame's deadline has passed or the
+// coroutine has used up its slice, so one resume never runs long past its
+// turn whatever the script does; it just carries on from there when resumed
+// again. A coroutine that goes on for the runaway limit without returning
+// or yielding by itself is stopped with an error. Calls into C can't be
+// interrupted, and a script inside a C call that calls back into Lua is only
+// preempted once it is back out.
+class ScriptScheduler
+{
+private:
+    std::chrono::steady_clock::time_point deadline;
+    double budgetMilliseconds = 4.0;
+    uint64_t sliceInstructions = 200000;
+    uint64_t runawayInstructions = 50000000;
+
+    // of the turn and the resume in progress, for the hook
+    std::chrono::steady_clock::time_point turnStart;
+    uint64_t sliceUsed = 0;
+    uint64_t *sinceYield = nullptr;
+    ScriptProfile *profile = nullptr;
+    bool preempted = false;
+
+    static void Hook(lua_State *thread, lua_Debug *debug);
+
+public:
+    // instructions between two looks at the clock
+    static const int HOOK_INTERVAL = 1000;
+
+    // installs the hook on the state; coroutines created afterwards inherit it
+    void Attach(lua_State *state);
+
+    void BeginFrame();
+    bool HasTimeLeft() const { return std::chrono::steady_clock::now() < deadline; }
+
+    // a turn is one or more resumes sharing a slice, timed as a whole so
+    // short calls don't pay for two clock reads each
+    void BeginTurn();
+    void EndTurn(ScriptProfile &profile);
+    bool HasSliceLeft() const { return sliceUsed < sliceInstructions; }
+
+    // arguments are on the coroutine's stack; instructionsSinceYield is the
+    // coroutine's own count towards the runaway limit, reset when it returns
+    // or yields by itself; only between BeginTurn and EndTurn
+    ResumeResult Resume(lua_State *thread, lua_State *from, int arguments, uint64_t &instructionsSinceYield, ScriptProfile &profile);
+
+    void SetFrameBudget(double milliseconds) { budgetMilliseconds = milliseconds; }
+    double GetFrameBudget() const { return budgetMilliseconds; }
+    // instructions one turn may run before the next one's
+    void SetSliceInstructions(uint64_t instructions) { sliceInstructions = instructions; }
+    void SetRunawayInstructions(uint64_t instructions) { runawayInstructions = instructions; }
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include "ScriptShard.h"
+#include <algorithm>
+#include <chrono>
+#include "../Logger/Logger.h"
+
+ScriptShard::ScriptShard(const ScriptSnapshot &snapshot) : snapshot(snapshot)
+{
+    lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::table, sol::lib::string, sol::lib::coroutine);
+    RegisterScriptBindings(lua, snapshot, commands);
+    scheduler.Attach(lua.lua_state());
+    SetCollectorProfile(collectorProfile);
+}
+
+// entities may name a behaviour before it is loaded, so slots come first
+size_t ScriptShard::BehaviorSlot(const std::string &name)
+{
+    auto found = behaviorIndex.find(name);
+    if (found != behaviorIndex.end())
+    {
+        return found->second;
+    }
+    behaviors.emplace_back();
+    behaviors.back().name = name;
+    behaviors.back().profile.name = name;
+    behaviors.back().batch.Create(lua);
+    behaviorIndex[name] = behaviors.size() - 1;
+    return behaviors.size() - 1;
+}
+
+bool ScriptShard::Install(const std::string &name, sol::load_result &chunk)
+{
+    if (!chunk.valid())
+    {
+        sol::error error = chunk;
+        Logger::Err("Script " + name + " does not compile: " + error.what());
+        return false;
+    }
+    sol::protected_function_result result = chunk();
+    if (!result.valid() || result.get_type() != sol::type::table)
+    {
+        std::string reason = result.valid() ? "it does not return a table" : result.get<sol::error>().what();
+        Logger::Err("Script " + name + " did not load: " + reason);
+        return false;
+    }
+    sol::table module = result;
+    size_t slot = BehaviorSlot(name);
+    Behavior &behavior = behaviors[slot];
+    behavior.update = module["update"];
+    behavior.updateBatch = module["update_batch"];
+    behavior.run = module["run"];
+    behavior.failed = false;
+    // a reload starts over
+    behavior.coroutine = Coroutine();
+    behavior.inCall = false;
+    behavior.frameDone = true;
+    behavior.runOrder.clear();
+    behavior.runCursor = 0;
+    behavior.runDone = true;
+    for (auto entity : behavior.members)
+    {
+        runTasks.erase(entity.GetId());
+        if (behavior.run.valid())
+        {
+            runTasks.emplace(entity.GetId(), RunTask(entity, slot));
+            behavior.runOrder.push_back(entity.GetId());
+        }
+    }
+    return true;
+}
+
+void ScriptShard::FinishLoading()
+{
+    // in generational mode the first young collection walks the whole heap,
+    // even right after a full one, and leaves it old
+    lua_gc(lua.lua_state(), collectorProfile.generational ? LUA_GCSTEP : LUA_GCCOLLECT, 0);
+    bytesAfterCollect = allocator.GetBytesInUse();
+}
+
+void ScriptShard::SetCollectorProfile(const ScriptCollectorProfile &profile)
+{
+    collectorProfile = profile;
+    if (profile.generational)
+    {
+        lua_gc(lua.lua_state(), LUA_GCGEN, profile.minorMultiplier, profile.majorMultiplier);
+    }
+    else
+    {
+        lua_gc(lua.lua_state(), LUA_GCINC, profile.pause, profile.stepMultiplier, 0);
+    }
+}
+
+void ScriptShard::Prepare(Coroutine &coroutine)
+{
+    if (!coroutine.thread)
+    {
+        coroutine.thread = lua_newthread(lua.lua_state());
+        coroutine.anchor = sol::reference(lua.lua_state(), -1);
+        lua_pop(lua.lua_state(), 1);
+    }
+    lua_settop(coroutine.thread, 0);
+}
+
+void ScriptShard::Fail(Behavior &behavior, Coroutine &coroutine)
+{
+    const char *message = lua_tostring(coroutine.thread, -1);
+    errors.push_back("Script behaviour " + behavior.name + " failed and is switched off: " + (message ? message : "unknown error"));
+    behavior.failed = true;
+    behavior.frameDone = true;
+    behavior.runDone = true;
+    // a thread that raised an error can't be resumed again
+    coroutine = Coroutine();
+}
+
+// starts or resumes calls of the behaviour's update work until the slice is
+// used up; true while there is more of it to do this frame
+bool ScriptShard::StepBehavior(Behavior &behavior)
+{
+    Coroutine &coroutine = behavior.coroutine;
+    while (true)
+    {
+        int arguments = 0;
+        if (!behavior.inCall)
+        {
+            if (behavior.cursor >= behavior.members.size())
+            {
+                behavior.frameDone = true;
+                return false;
+            }
+            Prepare(coroutine);
+            if (behavior.updateBatch.valid())
+            {
+                size_t count = std::min(static_cast<size_t>(BATCH_SIZE), behavior.members.size() - behavior.cursor);
+                behavior.batch.Gather(behavior.members.data() + behavior.cursor, count, snapshot);
+                behavior.cursor += count;
+                behavior.updateBatch.push(coroutine.thread);
+                behavior.batch.GetHandle().push(coroutine.thread);
+            }
+            else
+            {
+                behavior.callEntity = behavior.members[behavior.cursor++];
+                behavior.update.push(coroutine.thread);
+                // by pointer, like sol passes entities to a plain call: a copy
+                // would be a userdata with a finalizer per call, which the
+                // collector falls far behind on
+                sol::stack::push(coroutine.thread, &behavior.callEntity);
+            }
+            lua_pushnumber(coroutine.thread, behavior.callTime);
+            arguments = 2;
+            behavior.inCall = true;
+            lastCallCount++;
+        }
+
+        switch (scheduler.Resume(coroutine.thread, lua.lua_state(), arguments, coroutine.sinceYield, behavior.profile))
+        {
+        case RESUME_FINISHED:
+            behavior.inCall = false;
+            if (behavior.updateBatch.valid())
+            {
+                behavior.batch.Scatter(commands);
+            }
+            break;
+        case RESUME_FAILED:
+            Fail(behavior, coroutine);
+            return false;
+        default:
+            return true;
+        }
+        if (behavior.cursor >= behavior.members.size())
+        {
+            behavior.frameDone = true;
+            return false;
+        }
+        if (!scheduler.HasSliceLeft())
+        {
+            return true;
+        }
+    }
+}
+
+// resumes a run() coroutine; true if it was preempted and wants more time
+bool ScriptShard::StepRun(RunTask &task)
+{
+    Behavior &behavior = behaviors[task.behavior];
+    Coroutine &coroutine = task.coroutine;
+    int arguments = 0;
+    if (!task.started)
+    {
+        Prepare(coroutine);
+        behavior.run.push(coroutine.thread);
+        // runTasks is node based, so the task's entity stays put
+        sol::stack::push(coroutine.thread, &task.entity);
+        lua_pushnumber(coroutine.thread, task.pendingTime);
+        arguments = 2;
+        task.started = true;
+        task.pendingTime = 0.0;
+        lastCallCount++;
+    }
+    else if (!task.preempted)
+    {
+        // what coroutine.yield() returns
+        lua_pushnumber(coroutine.thread, task.pendingTime);
+        arguments = 1;
+        task.pendingTime = 0.0;
+    }
+
+    switch (scheduler.Resume(coroutine.thread, lua.lua_state(), arguments, coroutine.sinceYield, behavior.profile))
+    {
+    case RESUME_FINISHED:
+        task.finished = true;
+        return false;
+    case RESUME_YIELDED:
+        task.preempted = false;
+        return false;
+    case RESUME_PREEMPTED:
+        task.preempted = true;
+        return true;
+    default:
+        Fail(behavior, coroutine);
+        return false;
+    }
+}
+
+// resumes the behaviour's run tasks one after the other until the slice is
+// used up; true while some still want time this frame
+bool ScriptShard::StepRuns(Behavior &behavior)
+{
+    while (behavior.runCursor < behavior.runOrder.size())
+    {
+        auto task = runTasks.find(behavior.runOrder[behavior.runCursor]);
+        if (task != runTasks.end() && !task->second.finished)
+        {
+            if (StepRun(task->second))
+            {
+                return true;
+            }
+            if (behavior.failed)
+            {
+                return false;
+            }
+        }
+        behavior.runCursor++;
+        if (!scheduler.HasSliceLeft())
+        {
+            break;
+        }
+    }
+    behavior.runDone = behavior.runCursor >= behavior.runOrder.size();
+    return !behavior.runDone;
+}
+
+// in generational mode, runs a young collection in what is left of the frame
+// budget once the scripts allocated enough since the last one, so the
+// frame's garbage goes while it is young and Lua rarely has to stop a script
+// for a collection of its own
+void ScriptShard::CollectInSlack()
+{
+    lastCollectMilliseconds = 0.0;
+    // Lua may have collected on its own since
+    bytesAfterCollect = std::min(bytesAfterCollect, allocator.GetBytesInUse());
+    if (!collectorProfile.generational || !collectorProfile.collectInSlack || !scheduler.HasTimeLeft() ||
+        allocator.GetBytesInUse() < bytesAfterCollect + MIN_SLACK_GARBAGE)
+    {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    lua_gc(lua.lua_state(), LUA_GCSTEP, 0);
+    bytesAfterCollect = allocator.GetBytesInUse();
+    lastCollectMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ScriptShard::AddEntity(Entity entity, const std::string &behavior)
+{
+    size_t slot = BehaviorSlot(behavior);
+    behaviors[slot].members.push_back(entity);
+    behaviorOf[entity.GetId()] = slot;
+    if (behaviors[slot].run.valid())
+    {
+        runTasks.emplace(entity.GetId(), RunTask(entity, slot));
+        behaviors[slot].runOrder.push_back(entity.GetId());
+    }
+}
+
+void ScriptShard::RemoveEntity(Entity entity)
+{
+    auto slot = behaviorOf.find(entity.GetId());
+    if (slot == behaviorOf.end())
+    {
+        return;
+    }
+    Behavior &behavior = behaviors[slot->second];
+    auto &members = behavior.members;
+    auto member = std::find(members.begin(), members.end(), entity);
+    if (member != members.end())
+    {
+        // keep the cursor on the same next entity
+        if (static_cast<size_t>(member - members.begin()) < behavior.cursor)
+        {
+            behavior.cursor--;
+        }
+        members.erase(member);
+    }
+    if (behavior.inCall)
+    {
+        behavior.batch.Forget(entity);
+        if (!behavior.updateBatch.valid() && behavior.callEntity == entity)
+        {
+            // its suspended update would touch the dead entity, drop it
+            behavior.coroutine = Coroutine();
+            behavior.inCall = false;
+        }
+    }
+    auto &runOrder = behavior.runOrder;
+    auto task = std::find(runOrder.begin(), runOrder.end(), entity.GetId());
+    if (task != runOrder.end())
+    {
+        if (static_cast<size_t>(task - runOrder.begin()) < behavior.runCursor)
+        {
+            behavior.runCursor--;
+        }
+        runOrder.erase(task);
+    }
+    runTasks.erase(entity.GetId());
+    behaviorOf.erase(slot);
+}
+
+size_t ScriptShard::GetMemberCount(const std::string &behavior) const
+{
+    auto found = behaviorIndex.find(behavior);
+    return found == behaviorIndex.end() ? 0 : behaviors[found->second].members.size();
+}
+
+void ScriptShard::Update(double deltaTime)
+{
+    lastCallCount = 0;
+    errors.clear();
+    turns.clear();
+    for (size_t i = 0; i < behaviors.size(); i++)
+    {
+        Behavior &behavior = behaviors[i];
+        behavior.profile.NewFrame();
+        if (behavior.failed)
+        {
+            continue;
+        }
+        if (behavior.update.valid() || behavior.updateBatch.valid())
+        {
+            behavior.pendingTime += deltaTime;
+            if (behavior.frameDone && !behavior.members.empty())
+            {
+                behavior.frameDone = false;
+                behavior.cursor = 0;
+                behavior.callTime = behavior.pendingTime;
+                behavior.pendingTime = 0.0;
+            }
+            if (!behavior.frameDone)
+            {
+                turns.push_back({false, i});
+            }
+        }
+        if (behavior.runDone && !behavior.runOrder.empty())
+        {
+            behavior.runDone = false;
+            behavior.runCursor = 0;
+        }
+        if (!behavior.runDone)
+        {
+            turns.push_back({true, i});
+        }
+    }
+    for (auto &task : runTasks)
+    {
+        if (!task.second.finished)
+        {
+            task.second.pendingTime += deltaTime;
+        }
+    }
+    if (!turns.empty())
+    {
+        std::rotate(turns.begin(), turns.begin() + frameCount % turns.size(), turns.end());
+    }
+    frameCount++;
+
+    // at least one turn per frame, so even a zero budget makes progress;
+    // a turn that wants more goes to the back of the line
+    for (size_t next = 0; next < turns.size() && (next == 0 || scheduler.HasTimeLeft()); next++)
+    {
+        Turn turn = turns[next];
+        bool more = false;
+        scheduler.BeginTurn();
+        if (!behaviors[turn.behavior].failed)
+        {
+            more = turn.isRun ? StepRuns(behaviors[turn.behavior]) : StepBehavior(behaviors[turn.behavior]);
+        }
+        scheduler.EndTurn(behaviors[turn.behavior].profile);
+        if (more)
+        {
+            turns.push_back(turn);
+        }
+    }
+    CollectInSlack();
+}
+
+std::vector<ScriptProfile> ScriptShard::GetProfiles() const
+{
+    std::vector<ScriptProfile> profiles;
+    for (const auto &behavior : behaviors)
+    {
+        profiles.push_back(behavior.profile);
+    }
+    return profiles;
+}
+
+// a behaviour whose update work or run tasks did not all get through within
+// the last frame
+bool ScriptShard::IsBehind(const std::string &name) const
+{
+    auto found = behaviorIndex.find(name);
+    return found != behaviorIndex.end() && (!behaviors[found->second].frameDone || !behaviors[found->second].runDone);
+}
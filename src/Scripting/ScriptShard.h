@@ -0,0 +1,175 @@
+#ifndef SCRIPTSHARD_H
+#define SCRIPTSHARD_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ScriptAllocator.h"
+#include "ScriptBatch.h"
+#include "ScriptBindings.h"
+#include "ScriptCommandBuffer.h"
+#include "ScriptScheduler.h"
+#include "ScriptSnapshot.h"
+#include "../ECS/ECS.h"
+
+// How a Lua state's collector runs; the multipliers are Lua's percentages
+// (see lua_gc)
+struct ScriptCollectorProfile
+{
+    // Frame scripts mostly make garbage that dies young and keep a large
+    // heap that changes little, which generational mode suits: young
+    // collections only look at what is new or was changed. Incremental mode
+    // spreads whole cycles over small steps instead.
+    bool generational = true;
+    int minorMultiplier = 20;
+    int majorMultiplier = 100;
+    int pause = 200;
+    int stepMultiplier = 100;
+    // generational only: a young collection at the end of Update when the
+    // frame budget has time left, rather than one in the middle of a script
+    bool collectInSlack = true;
+};
+
+// One Lua state of the ScriptSystem, with the behaviours loaded into it and
+// the share of the scripted entities that runs in it.
+//
+// Behaviours take turns under the state's ScriptScheduler, the update work
+// and the run tasks of each being one turn of up to a slice of instructions,
+// round-robin until the frame budget is spent (see ScriptSystem). Scripts
+// read the frame's ScriptSnapshot and write into the shard's
+// ScriptCommandBuffer, and Update touches nothing else outside the shard, so
+// shards can update on different threads at once. Logging isn't safe off
+// the main thread, so errors from Update are kept for the ScriptSystem.
+class ScriptShard
+{
+private:
+    // a Lua thread, kept across calls and frames
+    struct Coroutine
+    {
+        lua_State *thread = nullptr;
+        // holds the thread in the registry so it is not collected
+        sol::reference anchor;
+        uint64_t sinceYield = 0;
+    };
+
+    struct Behavior
+    {
+        std::string name;
+        sol::reference update;
+        sol::reference updateBatch;
+        sol::reference run;
+        std::vector<Entity> members;
+        bool failed = false;
+
+        // update work of the frame being run: members before the cursor had
+        // their call started, the last one may still be suspended
+        ScriptBatch batch;
+        Coroutine coroutine;
+        size_t cursor = 0;
+        bool inCall = false;
+        bool frameDone = true;
+        Entity callEntity = Entity(-1);
+        double callTime = 0.0;
+        // time of the frames since the update work last started
+        double pendingTime = 0.0;
+        // ids of the members' run tasks, resumed in this order the same way
+        std::vector<int> runOrder;
+        size_t runCursor = 0;
+        bool runDone = true;
+
+        ScriptProfile profile;
+    };
+
+    // the run() coroutine of one entity
+    struct RunTask
+    {
+        Entity entity;
+        size_t behavior;
+        Coroutine coroutine;
+        bool started = false;
+        bool preempted = false;
+        bool finished = false;
+        double pendingTime = 0.0;
+
+        RunTask(Entity entity, size_t behavior) : entity(entity), behavior(behavior) {}
+    };
+
+    // a turn in the round-robin: a behaviour's update work or its run tasks
+    struct Turn
+    {
+        bool isRun;
+        size_t behavior;
+    };
+
+    const ScriptSnapshot &snapshot;
+    ScriptCommandBuffer commands;
+    // declared before the state, which allocates through it until destroyed
+    ScriptAllocator allocator;
+    sol::state lua{sol::default_at_panic, ScriptAllocator::Allocate, &allocator};
+    ScriptScheduler scheduler;
+    // a deque, so a suspended call's callEntity stays put when behaviours are added
+    std::deque<Behavior> behaviors;
+    std::unordered_map<std::string, size_t> behaviorIndex;
+    // entity id -> its behaviour, to find it again on removal
+    std::unordered_map<int, size_t> behaviorOf;
+    std::unordered_map<int, RunTask> runTasks;
+    std::vector<Turn> turns;
+    size_t frameCount = 0;
+    size_t lastCallCount = 0;
+    std::vector<std::string> errors;
+
+    ScriptCollectorProfile collectorProfile;
+    size_t bytesAfterCollect = 0;
+    double lastCollectMilliseconds = 0.0;
+
+    size_t BehaviorSlot(const std::string &name);
+    void Prepare(Coroutine &coroutine);
+    void Fail(Behavior &behavior, Coroutine &coroutine);
+    bool StepBehavior(Behavior &behavior);
+    bool StepRun(RunTask &task);
+    bool StepRuns(Behavior &behavior);
+    void CollectInSlack();
+
+public:
+    static const size_t BATCH_SIZE = 512;
+    // garbage worth a young collection in the slack
+    static const size_t MIN_SLACK_GARBAGE = 64 * 1024;
+
+    // the snapshot must outlive the shard
+    explicit ScriptShard(const ScriptSnapshot &snapshot);
+    ScriptShard(const ScriptShard &) = delete;
+    ScriptShard &operator=(const ScriptShard &) = delete;
+
+    sol::state &GetState() { return lua; }
+    ScriptScheduler &GetScheduler() { return scheduler; }
+    ScriptAllocator &GetAllocator() { return allocator; }
+    ScriptCommandBuffer &GetCommands() { return commands; }
+
+    void SetCollectorProfile(const ScriptCollectorProfile &profile);
+    const ScriptCollectorProfile &GetCollectorProfile() const { return collectorProfile; }
+
+    // runs a chunk loaded into this state and takes the table it returns as
+    // the behaviour; logs why not and returns false if it can't
+    bool Install(const std::string &name, sol::load_result &chunk);
+    // collects what loading left behind, see ScriptSystem::FinishLoading
+    void FinishLoading();
+
+    void AddEntity(Entity entity, const std::string &behavior);
+    void RemoveEntity(Entity entity);
+    size_t GetMemberCount(const std::string &behavior) const;
+
+    // runs the frame's turns until the scheduler's deadline, set with
+    // GetScheduler().BeginFrame() beforehand, and collects in the slack
+    void Update(double deltaTime);
+
+    // behaviours that failed during the last Update, as log messages
+    const std::vector<std::string> &GetErrors() const { return errors; }
+    size_t GetLastCallCount() const { return lastCallCount; }
+    double GetLastCollectTime() const { return lastCollectMilliseconds; }
+    std::vector<ScriptProfile> GetProfiles() const;
+    bool IsBehind(const std::string &name) const;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "ScriptSnapshot.h"
+#include <algorithm>
+#include "../Components/TransformerComponent.h"
+#include "../Components/RigidBodyComponent.h"
+
+void ScriptSnapshot::Capture(const std::vector<Entity> &entities)
+{
+    int highest = -1;
+    for (const auto &entity : entities)
+    {
+        highest = std::max(highest, entity.GetId());
+    }
+    // entries of entities gone since the last capture must not linger
+    entries.assign(static_cast<size_t>(highest + 1), Entry());
+    for (const auto &entity : entities)
+    {
+        Entry &entry = entries[entity.GetId()];
+        const auto &position = entity.GetComponent<TransformerComponent>().position;
+        entry.x = position.x;
+        entry.y = position.y;
+        entry.hasBody = entity.HasComponent<RigidBodyComponent>();
+        if (entry.hasBody)
+        {
+            const auto &velocity = entity.GetComponent<RigidBodyComponent>().velocity;
+            entry.vx = velocity.x;
+            entry.vy = velocity.y;
+        }
+        entry.present = true;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SCRIPTSNAPSHOT_H
+#define SCRIPTSNAPSHOT_H
+
+#include <vector>
+#include "../ECS/ECS.h"
+
+// What scripts read of the world: positions and velocities of the scripted
+// entities as they were when the frame's scripts started.
+//
+// The ScriptSystem captures it on the main thread before any script runs
+// and nothing writes to it until every Lua state is done, so all states
+// read it at once without locks, and a script sees the same values however
+// far the other states got. What scripts change goes through a
+// ScriptCommandBuffer and shows up in the next snapshot.
+class ScriptSnapshot
+{
+public:
+    struct Entry
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float vx = 0.0f;
+        float vy = 0.0f;
+        bool hasBody = false;
+        bool present = false;
+    };
+
+private:
+    // by entity id, which the registry keeps dense
+    std::vector<Entry> entries;
+
+public:
+    void Capture(const std::vector<Entity> &entities);
+
+    // nullptr for an entity that was not scripted when captured
+    const Entry *Find(int id) const
+    {
+        return id >= 0 && static_cast<size_t>(id) < entries.size() && entries[id].present ? &entries[id] : nullptr;
+    }
+};
+
+#endif
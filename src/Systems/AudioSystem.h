@@ -0,0 +1,210 @@
+#ifndef AUDIOSYSTEM_H
+#define AUDIOSYSTEM_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <glm/glm.hpp>
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/SoundEmitterComponent.h"
+#include "../Audio/VoiceAllocator.h"
+#include "../Audio/AudioMixer.h"
+#include "../Audio/MusicPlayer.h"
+#include "../Audio/SoundCache.h"
+#include "../Logger/Logger.h"
+#include "../Memory/FrameArena.h"
+
+// Plays the sounds of the entities with a SoundEmitterComponent as heard
+// from the camera: quieter the further they are from its centre, panned to
+// the side they are on.
+//
+// Sounds come from a SoundCache, already in the mixer's format, so
+// starting one is handing the mixer a pointer. They are mixed by an
+// AudioMixer, hooked into SDL_mixer in place of its music, with a fixed
+// number of voices, so mixing costs the same with 300 choppers around as
+// with 16. Every frame the VoiceAllocator gives the voices to the most
+// important audible emitters; the rest are virtual and cost nothing but
+// their bookkeeping. The system keeps the time of every emitter, so a sound
+// that doesn't loop ends on time either way, and one that takes a voice is
+// heard from where it has got to. What changes goes to the mixer as
+// commands, never calling into SDL_mixer from the game thread after setup;
+// a voice's levels are only sent when they change audibly.
+//
+// Music doesn't go through the cache: a MusicPlayer streams it from disk on
+// a thread of its own and the mixer adds it in, see GetMusic.
+class AudioSystem : public System
+{
+private:
+    SoundCache sounds;
+    VoiceAllocator allocator;
+    AudioMixer mixer;
+    MusicPlayer music;
+    bool hooked = false;
+    // per emitter of this frame's Update, in the frame arena
+    FrameVector<Entity> emitters;
+    FrameVector<const SoundData *> emitterSounds;
+    // per voice, levels last sent to the mixer
+    std::vector<float> sentLeft;
+    std::vector<float> sentRight;
+
+    static void MixCallback(void *mixer, Uint8 *stream, int length)
+    {
+        static_cast<AudioMixer *>(mixer)->Mix(reinterpret_cast<int16_t *>(stream), static_cast<size_t>(length) / 4);
+    }
+
+public:
+    // a level change smaller than this is not sent
+    static constexpr float LEVEL_STEP = 0.01f;
+
+    // after the audio device is opened; without one nothing is played
+    AudioSystem()
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<SoundEmitterComponent>();
+        SetVoiceCount(VoiceAllocator::DEFAULT_VOICES);
+        int frequency = 0;
+        Uint16 format = 0;
+        int channels = 0;
+        if (!Mix_QuerySpec(&frequency, &format, &channels))
+        {
+            Logger::Warn("No audio device, sounds are not played");
+            return;
+        }
+        if (format != AUDIO_S16SYS || channels != 2)
+        {
+            Logger::Err("The audio device is not 16-bit stereo, sounds are not played");
+            return;
+        }
+        mixer.SetFrequency(frequency);
+        sounds.SetFrequency(frequency);
+        mixer.SetMusic(&music);
+        music.Start(frequency);
+        // SDL_mixer's own channels stay unused
+        Mix_AllocateChannels(0);
+        Mix_HookMusic(MixCallback, &mixer);
+        hooked = true;
+    }
+
+    ~AudioSystem()
+    {
+        // the sounds and the music go after this, when the mixer can't play
+        // them any more
+        if (hooked)
+        {
+            Mix_HookMusic(nullptr, nullptr);
+        }
+        music.Shutdown();
+    }
+
+    // stops everything playing; at most AudioMixer::MAX_VOICES
+    void SetVoiceCount(int count)
+    {
+        count = std::min(std::max(count, 0), static_cast<int>(AudioMixer::MAX_VOICES));
+        for (int v = 0; hooked && v < allocator.GetVoiceCount(); v++)
+        {
+            mixer.Stop(v);
+        }
+        allocator.SetVoiceCount(count);
+        sentLeft.assign(count, 0.0f);
+        sentRight.assign(count, 0.0f);
+        for (auto entity : GetEntities())
+        {
+            entity.GetComponent<SoundEmitterComponent>().voice = -1;
+        }
+    }
+    int GetVoiceCount() const { return allocator.GetVoiceCount(); }
+    const VoiceAllocator &GetAllocator() const { return allocator; }
+    const AudioMixer &GetMixer() const { return mixer; }
+    // the sounds emitters can play, in the mixer's format
+    SoundCache &GetSounds() { return sounds; }
+    // tracks streamed from disk; without a device they are never opened
+    MusicPlayer &GetMusic() { return music; }
+
+    void Update(double deltaTime, const SDL_Rect &camera)
+    {
+        // the decoder thread doesn't log
+        for (const auto &error : music.TakeErrors())
+        {
+            Logger::Err(error);
+        }
+
+        const auto &entities = GetEntities();
+        allocator.Clear();
+        allocator.Reserve(entities.size());
+        emitters = FrameVector<Entity>();
+        emitters.reserve(entities.size());
+        emitterSounds = FrameVector<const SoundData *>();
+        emitterSounds.reserve(entities.size());
+        for (auto entity : entities)
+        {
+            auto &emitter = entity.GetComponent<SoundEmitterComponent>();
+            if (emitter.soundId == NO_SOUND)
+            {
+                // again every frame until it is loaded
+                emitter.soundId = sounds.Find(emitter.sound);
+            }
+            const SoundData *sound = emitter.soundId != NO_SOUND ? &sounds.Get(emitter.soundId) : nullptr;
+            if (emitter.playing && sound)
+            {
+                emitter.playing = emitter.loop || emitter.elapsed < sound->seconds;
+            }
+            if (!emitter.playing || !sound)
+            {
+                // a voice it had is stopped by the allocator
+                emitter.voice = -1;
+                continue;
+            }
+            const auto &position = entity.GetComponent<TransformerComponent>().position;
+            allocator.AddEmitter(position, emitter.volume, emitter.priority, emitter.minDistance, emitter.maxDistance, emitter.voice);
+            emitters.push_back(entity);
+            emitterSounds.push_back(sound);
+        }
+
+        const glm::vec2 centre(camera.x + 0.5f * camera.w, camera.y + 0.5f * camera.h);
+        allocator.Allocate(centre, 0.5f * camera.w);
+
+        // without a device the time is still kept, but nothing is sent
+        for (int v = 0; hooked && v < allocator.GetVoiceCount(); v++)
+        {
+            const Voice &voice = allocator.GetVoice(v);
+            if (voice.start)
+            {
+                // takes the place of whatever played on the voice
+                const auto &emitter = emitters[voice.emitter].GetComponent<SoundEmitterComponent>();
+                const SoundData &sound = *emitterSounds[voice.emitter];
+                const uint32_t offset = static_cast<uint32_t>(emitter.elapsed * mixer.GetFrequency());
+                mixer.Play(v, sound.samples.data(), sound.frames, offset, emitter.loop, voice.left, voice.right);
+            }
+            else if (voice.stop)
+            {
+                mixer.Stop(v);
+            }
+            else if (voice.emitter >= 0 &&
+                     (std::abs(voice.left - sentLeft[v]) > LEVEL_STEP || std::abs(voice.right - sentRight[v]) > LEVEL_STEP))
+            {
+                mixer.SetLevels(v, voice.left, voice.right);
+            }
+            else
+            {
+                continue;
+            }
+            sentLeft[v] = voice.left;
+            sentRight[v] = voice.right;
+        }
+        mixer.Submit();
+        for (size_t i = 0; i < emitters.size(); i++)
+        {
+            auto &emitter = emitters[i].GetComponent<SoundEmitterComponent>();
+            emitter.voice = allocator.GetAssignedVoice(static_cast<int>(i));
+            emitter.elapsed += static_cast<float>(deltaTime);
+        }
+        LOGGER_RECORD(LOG_TRACE, LOG_AUDIO, "Audio: {} emitters, {} audible, {} on voices, {} started",
+                      emitters.size(), allocator.GetAudibleCount(), allocator.GetRealCount(), allocator.GetStartCount());
+    }
+};
+
+#endif
@@ -0,0 +1,453 @@
+#ifndef COLLISIONSYSTEM_H
+#define COLLISIONSYSTEM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Components/ProjectileComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/ScriptComponent.h"
+#include "../Physics/AABB.h"
+#include "../Physics/SpatialHash.h"
+#include "../Physics/DynamicTree.h"
+#include "../Physics/SweepAndPrune.h"
+#include "../Terrain/TerrainMap.h"
+#include "../Memory/FrameArena.h"
+#include "../Logger/Logger.h"
+
+struct EntityCollision
+{
+    Entity a;
+    Entity b;
+};
+
+enum BroadphaseMode
+{
+    // rebuild a uniform grid from every collider each frame
+    BROADPHASE_SPATIAL_HASH,
+    // incremental tree, only colliders that left their fat box do any work
+    BROADPHASE_DYNAMIC_TREE,
+    // sort-and-sweep on X, best for wide, mostly horizontally scrolling scenes
+    BROADPHASE_SWEEP_AND_PRUNE
+};
+
+class CollisionSystem : public System
+{
+private:
+    BroadphaseMode mode;
+    SpatialHash spatialHash;
+    SweepAndPrune sweepAndPrune;
+    // this frame's results live in the frame arena, see GetCollisions
+    FrameVector<CollisionPair> pairs;
+    FrameVector<EntityCollision> collisions;
+    // colliders touching blocked tiles, only filled when a terrain is set
+    const TerrainMap *terrain = nullptr;
+    FrameVector<Entity> terrainCollisions;
+
+    // colliders with a body or a script can move and get a fresh box each
+    // frame; the rest (trees, bases...) get theirs once, when they join
+    std::vector<Entity> movers;
+    // by entity id: index in movers, -1 for a static collider
+    std::vector<int> moverSlots;
+    // by entity id: the exact box, and how far a mover went this frame
+    std::vector<AABB> worldBoxes;
+    std::vector<glm::vec2> displacements;
+
+    // the tree is the broadphase in BROADPHASE_DYNAMIC_TREE and serves the
+    // gameplay queries in every mode; in the other modes it is only brought
+    // up to date when a query asks, see SyncTree. indexed by entity id
+    DynamicTree tree;
+    std::vector<int> treeProxies;
+    // static colliders not in the tree yet
+    std::vector<Entity> newStatics;
+    bool treeSynced = false;
+    FrameVector<int> movedProxies;
+    // fat-box overlaps found when a proxy moved; they stay candidates until
+    // the fat boxes separate, so still objects don't need to look for them
+    // again. kept across frames, so on the heap
+    std::vector<CollisionPair> candidatePairs;
+    std::unordered_set<uint64_t> candidateKeys;
+    // pairs and queries come out as entity ids, this turns them back into entities
+    Registry *registry = nullptr;
+
+    Entity MakeEntity(int entityId) const
+    {
+        Entity entity(entityId);
+        entity.registry = registry;
+        return entity;
+    }
+
+    static uint64_t PairKey(int a, int b)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+    }
+
+    void EnsureEntitySlot(int entityId)
+    {
+        if (entityId >= static_cast<int>(treeProxies.size()))
+        {
+            treeProxies.resize(entityId + 1, NULL_NODE);
+            moverSlots.resize(entityId + 1, -1);
+            worldBoxes.resize(entityId + 1);
+            displacements.resize(entityId + 1);
+        }
+    }
+
+    void UpdateMovers()
+    {
+        for (auto entity : movers)
+        {
+            const int entityId = entity.GetId();
+            AABB box = GetWorldBox(entity.GetComponent<TransformerComponent>(), entity.GetComponent<BoxColliderComponent>());
+            displacements[entityId] = box.min - worldBoxes[entityId].min;
+            worldBoxes[entityId] = box;
+        }
+    }
+
+    // brings the tree up to the boxes of the last Update, once a frame
+    void SyncTree()
+    {
+        if (treeSynced)
+        {
+            return;
+        }
+        treeSynced = true;
+        movedProxies = FrameVector<int>();
+        for (auto entity : newStatics)
+        {
+            const int entityId = entity.GetId();
+            treeProxies[entityId] = tree.CreateProxy(worldBoxes[entityId], entityId);
+            movedProxies.push_back(treeProxies[entityId]);
+        }
+        newStatics.clear();
+        for (auto entity : movers)
+        {
+            const int entityId = entity.GetId();
+            int &proxy = treeProxies[entityId];
+            if (proxy == NULL_NODE)
+            {
+                proxy = tree.CreateProxy(worldBoxes[entityId], entityId);
+                movedProxies.push_back(proxy);
+            }
+            else if (tree.MoveProxy(proxy, worldBoxes[entityId], displacements[entityId]))
+            {
+                movedProxies.push_back(proxy);
+            }
+        }
+    }
+
+    // starts the tree over, for a switch to BROADPHASE_DYNAMIC_TREE: the
+    // candidate pairs were not kept up while another mode ran
+    void ResetTree()
+    {
+        tree = DynamicTree();
+        std::fill(treeProxies.begin(), treeProxies.end(), NULL_NODE);
+        candidatePairs.clear();
+        candidateKeys.clear();
+        newStatics.clear();
+        for (auto entity : GetEntities())
+        {
+            if (moverSlots[entity.GetId()] < 0)
+            {
+                newStatics.push_back(entity);
+            }
+        }
+        treeSynced = false;
+    }
+
+    void FindPairsWithTree()
+    {
+        // new candidates can only involve a proxy that was (re)inserted
+        for (int proxy : movedProxies)
+        {
+            const int entityId = tree.GetUserData(proxy);
+            tree.Query(tree.GetFatAABB(proxy), [&](int other)
+                       {
+                           // two moved proxies find each other twice, keep one
+                           if (other == proxy || (tree.WasMoved(other) && other < proxy))
+                           {
+                               return true;
+                           }
+                           int otherId = tree.GetUserData(other);
+                           int first = std::min(entityId, otherId);
+                           int second = std::max(entityId, otherId);
+                           if (candidateKeys.insert(PairKey(first, second)).second)
+                           {
+                               candidatePairs.push_back({first, second});
+                           }
+                           return true; });
+        }
+        for (int proxy : movedProxies)
+        {
+            tree.ClearMoved(proxy);
+        }
+
+        // drop candidates whose fat boxes separated (or whose entity is gone)
+        // and narrow-phase the rest against the exact boxes
+        for (size_t i = 0; i < candidatePairs.size();)
+        {
+            const CollisionPair candidate = candidatePairs[i];
+            int proxyA = treeProxies[candidate.first];
+            int proxyB = treeProxies[candidate.second];
+            if (proxyA == NULL_NODE || proxyB == NULL_NODE || !tree.GetFatAABB(proxyA).Overlaps(tree.GetFatAABB(proxyB)))
+            {
+                candidateKeys.erase(PairKey(candidate.first, candidate.second));
+                candidatePairs[i] = candidatePairs.back();
+                candidatePairs.pop_back();
+                continue;
+            }
+            if (worldBoxes[candidate.first].Overlaps(worldBoxes[candidate.second]))
+            {
+                pairs.push_back(candidate);
+            }
+            i++;
+        }
+    }
+
+    void FindPairsWithSpatialHash()
+    {
+        // the hash works on entity list indices; turn them into entity ids
+        const auto &entities = GetEntities();
+        spatialHash.Clear();
+        spatialHash.Reserve(entities.size());
+        for (auto entity : entities)
+        {
+            spatialHash.Insert(worldBoxes[entity.GetId()]);
+        }
+        spatialHash.FindPairs(pairs);
+        for (auto &pair : pairs)
+        {
+            pair.first = entities[pair.first].GetId();
+            pair.second = entities[pair.second].GetId();
+        }
+    }
+
+    void FindPairsWithSweepAndPrune()
+    {
+        sweepAndPrune.Clear();
+        for (auto entity : GetEntities())
+        {
+            sweepAndPrune.Insert(entity.GetId(), worldBoxes[entity.GetId()]);
+        }
+        sweepAndPrune.FindPairs(pairs);
+    }
+
+public:
+    CollisionSystem(BroadphaseMode mode = BROADPHASE_DYNAMIC_TREE, float cellSize = 64.0f)
+        : mode(mode), spatialHash(cellSize)
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<BoxColliderComponent>();
+    }
+
+    static AABB GetWorldBox(const TransformerComponent &transform, const BoxColliderComponent &collider)
+    {
+        AABB box;
+        box.min = transform.position + collider.offset * transform.scale;
+        box.max = box.min + glm::vec2(collider.width, collider.height) * transform.scale;
+        return box;
+    }
+
+    void SetBroadphase(BroadphaseMode newMode)
+    {
+        if (newMode == BROADPHASE_DYNAMIC_TREE && mode != BROADPHASE_DYNAMIC_TREE)
+        {
+            ResetTree();
+        }
+        mode = newMode;
+    }
+    // the map the colliders are checked against, nullptr for none
+    void SetTerrain(const TerrainMap *newTerrain) { terrain = newTerrain; }
+    BroadphaseMode GetBroadphase() const { return mode; }
+
+    void AddEntityToSystem(Entity entity) override
+    {
+        // projectiles are swept against the colliders by the ProjectileSystem
+        // instead of being tested where they end up each frame
+        if (entity.HasComponent<ProjectileComponent>())
+        {
+            return;
+        }
+        System::AddEntityToSystem(entity);
+        registry = entity.registry;
+
+        const int entityId = entity.GetId();
+        EnsureEntitySlot(entityId);
+        worldBoxes[entityId] = GetWorldBox(entity.GetComponent<TransformerComponent>(), entity.GetComponent<BoxColliderComponent>());
+        displacements[entityId] = glm::vec2(0.0f);
+        if (entity.HasComponent<RigidBodyComponent>() || entity.HasComponent<ScriptComponent>())
+        {
+            moverSlots[entityId] = static_cast<int>(movers.size());
+            movers.push_back(entity);
+        }
+        else
+        {
+            moverSlots[entityId] = -1;
+            newStatics.push_back(entity);
+        }
+    }
+
+    void RemoveEntityFromSystem(Entity entity) override
+    {
+        System::RemoveEntityFromSystem(entity);
+        const int entityId = entity.GetId();
+        if (entityId >= static_cast<int>(treeProxies.size()))
+        {
+            return;
+        }
+        if (treeProxies[entityId] != NULL_NODE)
+        {
+            tree.DestroyProxy(treeProxies[entityId]);
+            treeProxies[entityId] = NULL_NODE;
+        }
+        const int slot = moverSlots[entityId];
+        if (slot >= 0)
+        {
+            movers[slot] = movers.back();
+            moverSlots[movers[slot].GetId()] = slot;
+            movers.pop_back();
+            moverSlots[entityId] = -1;
+        }
+        else
+        {
+            // a static collider killed before the tree got it
+            newStatics.erase(std::remove(newStatics.begin(), newStatics.end(), entity), newStatics.end());
+        }
+    }
+
+    void Update()
+    {
+        // last frame's arena memory is gone; start from empty lists about
+        // as long as last frame's so they rarely grow
+        const size_t lastPairCount = pairs.size();
+        pairs = FrameVector<CollisionPair>();
+        pairs.reserve(lastPairCount);
+        UpdateMovers();
+        treeSynced = false;
+
+        switch (mode)
+        {
+        case BROADPHASE_SPATIAL_HASH:
+            FindPairsWithSpatialHash();
+            break;
+        case BROADPHASE_DYNAMIC_TREE:
+            SyncTree();
+            FindPairsWithTree();
+            break;
+        case BROADPHASE_SWEEP_AND_PRUNE:
+            FindPairsWithSweepAndPrune();
+            break;
+        }
+
+        collisions = FrameVector<EntityCollision>();
+        collisions.reserve(pairs.size());
+        for (const auto &pair : pairs)
+        {
+            collisions.push_back({MakeEntity(pair.first), MakeEntity(pair.second)});
+            LOGGER_RECORD(LOG_TRACE, LOG_PHYSICS, "Entity {} collides with entity {}", pair.first, pair.second);
+        }
+
+        // unit versus terrain is a few bit tests per collider, no broadphase
+        // needed; static colliders are placed with the map and left out
+        terrainCollisions = FrameVector<Entity>();
+        if (terrain)
+        {
+            for (auto entity : movers)
+            {
+                if (terrain->OverlapsBlocked(worldBoxes[entity.GetId()]))
+                {
+                    terrainCollisions.push_back(entity);
+                }
+            }
+        }
+    }
+
+    // writes the collider boxes of the last Update as text ("count" then one
+    // "minX minY maxX maxY" line per box) so the broadphases can be compared
+    // offline on the exact same scene, see benchmarks/CollisionBenchmark.cpp
+    bool DumpScene(const std::string &path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+        file << GetEntities().size() << "\n";
+        for (auto entity : GetEntities())
+        {
+            const AABB &box = worldBoxes[entity.GetId()];
+            file << box.min.x << " " << box.min.y << " " << box.max.x << " " << box.max.y << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+    // the colliding entity pairs found by this frame's Update; in the frame
+    // arena, so only valid until FrameArena::NewFrame
+    const FrameVector<EntityCollision> &GetCollisions() const { return collisions; }
+    // the entities whose collider touched a blocked tile in this frame's Update
+    const FrameVector<Entity> &GetTerrainCollisions() const { return terrainCollisions; }
+
+    // entities whose collider overlaps the area (radar range, explosions...)
+    void QueryArea(const AABB &area, std::vector<Entity> &result)
+    {
+        SyncTree();
+        tree.Query(area, [&](int proxy)
+                   {
+                       int entityId = tree.GetUserData(proxy);
+                       if (worldBoxes[entityId].Overlaps(area))
+                       {
+                           result.push_back(MakeEntity(entityId));
+                       }
+                       return true; });
+    }
+
+    // callback(entityId, box) for every collider overlapping the area, with
+    // the exact box as of the last Update
+    template <typename TCallback>
+    void ForEachColliderIn(const AABB &area, TCallback callback)
+    {
+        SyncTree();
+        tree.Query(area, [&](int proxy)
+                   {
+                       int entityId = tree.GetUserData(proxy);
+                       if (worldBoxes[entityId].Overlaps(area))
+                       {
+                           callback(entityId, worldBoxes[entityId]);
+                       }
+                       return true; });
+    }
+
+    // closest collider hit by the segment from -> to; fraction is the hit
+    // position along the segment (0 = from, 1 = to)
+    bool RayCast(glm::vec2 from, glm::vec2 to, Entity &hit, float &fraction)
+    {
+        SyncTree();
+        int hitId = -1;
+        glm::vec2 delta = to - from;
+        tree.RayCast(from, to, [&](int proxy, float maxFraction)
+                     {
+                         int entityId = tree.GetUserData(proxy);
+                         float entry;
+                         if (worldBoxes[entityId].RayCast(from, delta, maxFraction, entry))
+                         {
+                             hitId = entityId;
+                             fraction = entry;
+                             return entry;
+                         }
+                         return maxFraction; });
+        if (hitId < 0)
+        {
+            return false;
+        }
+        hit = MakeEntity(hitId);
+        return true;
+    }
+};
+
+#endif
@@ -1,21 +1,39 @@
 #ifndef MOVEMENTSYSTEM_H
 #define MOVEMENTSYSTEM_H
 
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/ProjectileComponent.h"
+
+// Moves everything with a velocity. Runs after the SteeringSystem has set
+// this frame's velocities and before the CollisionSystem looks at the boxes.
 class MovementSystem : public System
 {
 public:
-    MovementSystem(){
-        // only want certain entities
-        // RequireComponent<TransformerComponent>();
-        // RequireComponent<...>();
-    };
-    void Update()
+    MovementSystem()
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<RigidBodyComponent>();
+    }
+
+    void AddEntityToSystem(Entity entity) override
+    {
+        // projectiles are moved by the ProjectileSystem, up to what they hit
+        if (entity.HasComponent<ProjectileComponent>())
+        {
+            return;
+        }
+        System::AddEntityToSystem(entity);
+    }
+
+    void Update(double deltaTime)
     {
-        // TODO:
         for (auto entity : GetEntities())
         {
-            // Update the positions of the entities based on the velocities
-            // per frame of game loop
+            auto &transform = entity.GetComponent<TransformerComponent>();
+            const auto &rigidBody = entity.GetComponent<RigidBodyComponent>();
+            transform.position += rigidBody.velocity * static_cast<float>(deltaTime);
         }
     }
 };
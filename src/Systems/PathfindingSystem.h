@@ -0,0 +1,103 @@
+#ifndef PATHFINDINGSYSTEM_H
+#define PATHFINDINGSYSTEM_H
+
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/PathComponent.h"
+#include "../Pathfinding/PathService.h"
+#include "../Terrain/TerrainMap.h"
+#include "../Logger/Logger.h"
+
+// Feeds the PathService from PathComponents and writes the answers back.
+// Units asking for a new path get it some frames later instead of in the
+// frame they asked, and killing a unit cancels what it still waits for.
+class PathfindingSystem : public System
+{
+private:
+    PathService &service;
+    // requests in flight and the entity each answer goes to
+    std::unordered_map<PathRequestId, int> owners;
+    std::unordered_map<int, PathRequestId> requestOf;
+    Registry *registry = nullptr;
+
+    void CancelRequest(int entityId)
+    {
+        auto request = requestOf.find(entityId);
+        if (request != requestOf.end())
+        {
+            service.Cancel(request->second);
+            owners.erase(request->second);
+            requestOf.erase(request);
+        }
+    }
+
+public:
+    PathfindingSystem(PathService &pathService) : service(pathService)
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<PathComponent>();
+    }
+
+    void AddEntityToSystem(Entity entity) override
+    {
+        System::AddEntityToSystem(entity);
+        registry = entity.registry;
+    }
+
+    void RemoveEntityFromSystem(Entity entity) override
+    {
+        System::RemoveEntityFromSystem(entity);
+        CancelRequest(entity.GetId());
+    }
+
+    void Update(const TerrainMap &terrain)
+    {
+        const float tileSize = terrain.GetTileSize();
+        for (auto entity : GetEntities())
+        {
+            auto &path = entity.GetComponent<PathComponent>();
+            if (!path.repath)
+            {
+                continue;
+            }
+            // a newer order replaces the one still waiting
+            CancelRequest(entity.GetId());
+            const auto &position = entity.GetComponent<TransformerComponent>().position;
+            glm::ivec2 start(static_cast<int>(std::floor(position.x / tileSize)), static_cast<int>(std::floor(position.y / tileSize)));
+            PathRequestId id = service.Request(start, path.goal, path.priority);
+            owners[id] = entity.GetId();
+            requestOf[entity.GetId()] = id;
+            path.repath = false;
+            path.status = PATH_PENDING;
+        }
+
+        service.Update();
+
+        for (const auto &completion : service.GetCompletions())
+        {
+            auto owner = owners.find(completion.id);
+            if (owner == owners.end())
+            {
+                continue;
+            }
+            Entity entity(owner->second);
+            entity.registry = registry;
+            requestOf.erase(owner->second);
+            owners.erase(owner);
+
+            auto &path = entity.GetComponent<PathComponent>();
+            path.status = completion.result.status;
+            path.tiles = completion.result.tiles;
+            path.nextTile = 0;
+            if (path.status == PATH_FAILED)
+            {
+                LOGGER_TRACE(LOG_GENERAL, "No path for entity " + std::to_string(entity.GetId()));
+            }
+        }
+    }
+};
+
+#endif
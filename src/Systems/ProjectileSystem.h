@@ -0,0 +1,100 @@
+#ifndef PROJECTILESYSTEM_H
+#define PROJECTILESYSTEM_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Components/ProjectileComponent.h"
+#include "../Physics/SweptCollision.h"
+#include "../Systems/CollisionSystem.h"
+#include "../Logger/Logger.h"
+
+struct ProjectileHit
+{
+    Entity projectile;
+    Entity target;
+    // where along this frame's move the hit happened, 0..1
+    float fraction;
+};
+
+// Moves projectiles and finds what they hit in one step per frame. Every
+// projectile is swept from where it is to where its velocity takes it, so a
+// bullet crossing a thin collider between two frames still hits it. Runs
+// after the CollisionSystem so the targets' boxes are current.
+class ProjectileSystem : public System
+{
+private:
+    SweepBatch batch;
+    std::vector<ProjectileHit> hits;
+
+public:
+    ProjectileSystem()
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<RigidBodyComponent>();
+        RequireComponent<BoxColliderComponent>();
+        RequireComponent<ProjectileComponent>();
+    }
+
+    void Update(double deltaTime, CollisionSystem &collisionSystem)
+    {
+        const auto &entities = GetEntities();
+
+        // projectile index in the batch == index in the entity list
+        batch.Clear();
+        for (auto entity : entities)
+        {
+            const auto &transform = entity.GetComponent<TransformerComponent>();
+            const auto &rigidBody = entity.GetComponent<RigidBodyComponent>();
+            const auto &projectile = entity.GetComponent<ProjectileComponent>();
+            AABB box = CollisionSystem::GetWorldBox(transform, entity.GetComponent<BoxColliderComponent>());
+            int index = batch.AddProjectile(box, rigidBody.velocity * static_cast<float>(deltaTime));
+            collisionSystem.ForEachColliderIn(batch.GetSweptBox(index), [&](int targetId, const AABB &target)
+                                              {
+                                                  if (targetId != projectile.shooterId)
+                                                  {
+                                                      batch.AddCandidate(index, target, targetId);
+                                                  }
+                                              });
+        }
+        batch.Solve();
+
+        hits.clear();
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            Entity entity = entities[i];
+            auto &transform = entity.GetComponent<TransformerComponent>();
+            const auto &rigidBody = entity.GetComponent<RigidBodyComponent>();
+            float fraction = batch.GetHitFraction(i);
+            transform.position += rigidBody.velocity * static_cast<float>(deltaTime) * fraction;
+
+            int targetId = batch.GetHitTarget(i);
+            if (targetId < 0)
+            {
+                continue;
+            }
+            Entity target(targetId);
+            target.registry = entity.registry;
+            hits.push_back({entity, target, fraction});
+            LOGGER_RECORD(LOG_TRACE, LOG_PHYSICS, "Projectile {} hit entity {}", entity.GetId(), targetId);
+        }
+
+        // killing only queues the removal, so the entity list above stays valid
+        for (const auto &hit : hits)
+        {
+            if (hit.projectile.GetComponent<ProjectileComponent>().destroyOnHit)
+            {
+                hit.projectile.registry->KillEntity(hit.projectile);
+            }
+        }
+    }
+
+    // projectile hits found by the last Update
+    const std::vector<ProjectileHit> &GetHits() const { return hits; }
+};
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef SCRIPTSYSTEM_H
+#define SCRIPTSYSTEM_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/ScriptComponent.h"
+#include "../Jobs/JobSystem.h"
+#include "../Scripting/ScriptLoader.h"
+#include "../Scripting/ScriptShard.h"
+#include "../Scripting/ScriptSnapshot.h"
+#include "../Logger/Logger.h"
+
+// Runs the Lua behaviours of scripted entities.
+//
+// A behaviour is a script returning a table with any of
+//
+//   update_batch(batch, dt)  called once per chunk of up to BATCH_SIZE
+//                            entities, loops over the ScriptBatch arrays
+//   update(entity, dt)       called once per entity
+//   run(entity, dt)          started once per entity as a coroutine for AI
+//                            and cutscenes; coroutine.yield() waits for the
+//                            next frame and returns the time since
+//
+// update_batch wins over update. The entities of a behaviour are kept
+// together, so a frame costs one call into Lua per chunk instead of one per
+// entity.
+//
+// Every call runs as a coroutine under the ScriptScheduler. Behaviours take
+// turns, the update work and the run tasks of each being one turn of up to a
+// slice of instructions, round-robin until the frame budget is spent;
+// whatever is left carries on next frame, getting the time of both frames as
+// its dt. So scripts can slow down, but never stall a frame, and a behaviour
+// on many entities gets no more time than one on a few. The behaviour that
+// goes first changes every frame, so none always gets the leftovers. A
+// behaviour that raises an error or runs away is logged and switched off.
+//
+// The entities are spread over one or more Lua states, ScriptShards: every
+// behaviour is loaded into each of them and its entities are split evenly
+// between them. The states share nothing, so Update runs them side by side
+// on the JobSystem, without a lock anywhere in Lua. Scripts read a
+// ScriptSnapshot taken as Update starts, and what they write is buffered
+// per state and applied on the main thread once every state is done, state
+// after state, so the outcome does not depend on which thread finished
+// first. The frame budget is wall-clock time that the states spend at once,
+// and as states don't see each other's globals, what a behaviour keeps in
+// Lua is per state.
+//
+// Each state allocates through a ScriptAllocator, which pools small blocks
+// and counts and can limit the state's memory. The collector runs as set by
+// a ScriptCollectorProfile, by default generational with a young collection
+// in what the scripts leave of the frame budget.
+class ScriptSystem : public System
+{
+private:
+    ScriptLoader loader;
+    // declared before the shards, whose bindings read it
+    ScriptSnapshot snapshot;
+    std::vector<std::unique_ptr<ScriptShard>> shards;
+    // entity id -> the state it runs in
+    std::unordered_map<int, size_t> shardOf;
+    size_t lastCallCount = 0;
+    double lastCollectMilliseconds = 0.0;
+
+    // loads the behaviour into every state, stopping at the first that fails
+    template <typename TLoad>
+    bool Install(const std::string &name, TLoad load)
+    {
+        for (auto &shard : shards)
+        {
+            sol::load_result chunk = load(shard->GetState());
+            if (!shard->Install(name, chunk))
+            {
+                return false;
+            }
+        }
+        LOGGER_INFO(LOG_SCRIPT, "Loaded script behaviour " + name);
+        return true;
+    }
+
+public:
+    static const size_t BATCH_SIZE = ScriptShard::BATCH_SIZE;
+
+    // states = 0 is one per JobSystem thread, workers and the calling thread
+    explicit ScriptSystem(unsigned states = 1)
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<ScriptComponent>();
+        if (states == 0)
+        {
+            states = JobSystem::GetWorkerCount() + 1;
+        }
+        for (unsigned i = 0; i < states; i++)
+        {
+            shards.push_back(std::make_unique<ScriptShard>(snapshot));
+        }
+    }
+
+    // bytecode cache and pack used by the Load* calls
+    ScriptLoader &GetLoader() { return loader; }
+    size_t GetStateCount() const { return shards.size(); }
+    // globals set up from C++ have to go into every state
+    sol::state &GetState(size_t index = 0) { return shards[index]->GetState(); }
+    // byte counters and memory limit of a state
+    ScriptAllocator &GetAllocator(size_t index = 0) { return shards[index]->GetAllocator(); }
+
+    // wall-clock time all states together get per frame
+    void SetFrameBudget(double milliseconds)
+    {
+        for (auto &shard : shards)
+        {
+            shard->GetScheduler().SetFrameBudget(milliseconds);
+        }
+    }
+    double GetFrameBudget() const { return shards[0]->GetScheduler().GetFrameBudget(); }
+    // instructions one turn may run before the next one's
+    void SetSliceInstructions(uint64_t instructions)
+    {
+        for (auto &shard : shards)
+        {
+            shard->GetScheduler().SetSliceInstructions(instructions);
+        }
+    }
+    void SetRunawayInstructions(uint64_t instructions)
+    {
+        for (auto &shard : shards)
+        {
+            shard->GetScheduler().SetRunawayInstructions(instructions);
+        }
+    }
+
+    void SetCollectorProfile(const ScriptCollectorProfile &profile)
+    {
+        for (auto &shard : shards)
+        {
+            shard->SetCollectorProfile(profile);
+        }
+    }
+    const ScriptCollectorProfile &GetCollectorProfile() const { return shards[0]->GetCollectorProfile(); }
+
+    bool LoadBehavior(const std::string &name, const std::string &path)
+    {
+        return Install(name, [&](sol::state &lua)
+                       { return loader.Load(lua, path); });
+    }
+
+    bool LoadBehaviorFromSource(const std::string &name, const std::string &source)
+    {
+        return Install(name, [&](sol::state &lua)
+                       { return loader.LoadSource(lua, source, name); });
+    }
+
+    // every *.lua in the directory, named after the file; returns how many loaded
+    int LoadBehaviors(const std::string &directory)
+    {
+        int loaded = 0;
+        std::error_code error;
+        for (const auto &file : std::filesystem::directory_iterator(directory, error))
+        {
+            if (file.path().extension() == ".lua" && LoadBehavior(file.path().stem().string(), file.path().string()))
+            {
+                loaded++;
+            }
+        }
+        FinishLoading();
+        return loaded;
+    }
+
+    // what the scripts set up is mostly there to stay; collects it now, while
+    // a pause doesn't show, rather than in the first frames. LoadBehaviors
+    // does this itself, after other loading it is up to the caller
+    void FinishLoading()
+    {
+        JobSystem::ParallelFor(shards.size(), 1, [this](size_t begin, size_t end)
+                               {
+                                   for (size_t i = begin; i < end; i++)
+                                   {
+                                       shards[i]->FinishLoading();
+                                   }
+                               });
+    }
+
+    void AddEntityToSystem(Entity entity) override
+    {
+        System::AddEntityToSystem(entity);
+        // the state with the fewest entities of the behaviour, the first on a tie
+        const std::string &behavior = entity.GetComponent<ScriptComponent>().behavior;
+        size_t target = 0;
+        for (size_t i = 1; i < shards.size(); i++)
+        {
+            if (shards[i]->GetMemberCount(behavior) < shards[target]->GetMemberCount(behavior))
+            {
+                target = i;
+            }
+        }
+        shards[target]->AddEntity(entity, behavior);
+        shardOf[entity.GetId()] = target;
+    }
+
+    void RemoveEntityFromSystem(Entity entity) override
+    {
+        System::RemoveEntityFromSystem(entity);
+        auto shard = shardOf.find(entity.GetId());
+        if (shard != shardOf.end())
+        {
+            shards[shard->second]->RemoveEntity(entity);
+            shardOf.erase(shard);
+        }
+    }
+
+    void Update(double deltaTime)
+    {
+        snapshot.Capture(GetEntities());
+        // one deadline for all of them
+        for (auto &shard : shards)
+        {
+            shard->GetScheduler().BeginFrame();
+        }
+        JobSystem::ParallelFor(shards.size(), 1, [this, deltaTime](size_t begin, size_t end)
+                               {
+                                   for (size_t i = begin; i < end; i++)
+                                   {
+                                       shards[i]->Update(deltaTime);
+                                   }
+                               });
+
+        // the sync point: every state is done, back on the main thread
+        lastCallCount = 0;
+        lastCollectMilliseconds = 0.0;
+        for (size_t i = 0; i < shards.size(); i++)
+        {
+            ScriptShard &shard = *shards[i];
+            shard.GetCommands().Apply();
+            for (const auto &error : shard.GetErrors())
+            {
+                Logger::Err(error);
+            }
+            lastCallCount += shard.GetLastCallCount();
+            lastCollectMilliseconds += shard.GetLastCollectTime();
+            if (shard.GetLastCollectTime() > 0.0)
+            {
+                LOGGER_RECORD(LOG_TRACE, LOG_SCRIPT, "Script collection in state {}: {} ms, {} KB in use",
+                              i, shard.GetLastCollectTime(), shard.GetAllocator().GetBytesInUse() / 1024);
+            }
+        }
+        // summing the profiles allocates, so only when they get recorded
+        if (LOG_TRACE >= LOG_COMPILE_LEVEL && Logger::HasBinarySink() && Logger::IsEnabled(LOG_TRACE, LOG_SCRIPT))
+        {
+            for (const auto &profile : GetProfiles())
+            {
+                if (profile.resumes > 0)
+                {
+                    LOGGER_RECORD(LOG_TRACE, LOG_SCRIPT, "Script {}: {} ms, ~{} instructions, {} resumes, {} preempted",
+                                  profile.name, profile.milliseconds, profile.instructions, profile.resumes, profile.preemptions);
+                }
+            }
+        }
+    }
+
+    // calls into Lua started during the last Update
+    size_t GetLastCallCount() const { return lastCallCount; }
+    // time the last Update spent collecting in the slack, summed over the states
+    double GetLastCollectTime() const { return lastCollectMilliseconds; }
+    // CPU use per behaviour, last frame and since start, summed over the states
+    std::vector<ScriptProfile> GetProfiles() const
+    {
+        std::vector<ScriptProfile> profiles;
+        std::unordered_map<std::string, size_t> index;
+        for (const auto &shard : shards)
+        {
+            for (const auto &profile : shard->GetProfiles())
+            {
+                auto found = index.find(profile.name);
+                if (found == index.end())
+                {
+                    index[profile.name] = profiles.size();
+                    profiles.push_back(profile);
+                    continue;
+                }
+                ScriptProfile &sum = profiles[found->second];
+                sum.milliseconds += profile.milliseconds;
+                sum.instructions += profile.instructions;
+                sum.resumes += profile.resumes;
+                sum.preemptions += profile.preemptions;
+                sum.totalMilliseconds += profile.totalMilliseconds;
+            }
+        }
+        return profiles;
+    }
+    // a behaviour whose update work or run tasks did not all get through
+    // within the last frame, in any of the states
+    bool IsBehind(const std::string &name) const
+    {
+        for (const auto &shard : shards)
+        {
+            if (shard->IsBehind(name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef STEERINGSYSTEM_H
+#define STEERINGSYSTEM_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "../ECS/ECS.h"
+#include "../Components/TransformerComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/SteeringComponent.h"
+#include "../Components/PathComponent.h"
+#include "../Physics/CrowdSteering.h"
+#include "../Terrain/TerrainMap.h"
+
+// Sets the velocity of every steering unit for the MovementSystem. A unit
+// with a found path wants to walk toward its next waypoint at full speed,
+// one without wants to stand still; CrowdSteering then bends that around
+// the units nearby so crowds don't walk through each other.
+class SteeringSystem : public System
+{
+private:
+    CrowdSteering crowd;
+
+    glm::vec2 PreferredVelocity(Entity entity, glm::vec2 position, float maxSpeed, float tileSize) const
+    {
+        if (!entity.HasComponent<PathComponent>())
+        {
+            return glm::vec2(0.0f);
+        }
+        auto &path = entity.GetComponent<PathComponent>();
+        if (path.status != PATH_FOUND || !path.tiles)
+        {
+            return glm::vec2(0.0f);
+        }
+        // waypoints count as reached within a quarter tile of their centre
+        const float arrival = 0.25f * tileSize;
+        const auto &tiles = *path.tiles;
+        while (path.nextTile < tiles.size())
+        {
+            glm::vec2 target = (glm::vec2(tiles[path.nextTile]) + 0.5f) * tileSize;
+            glm::vec2 offset = target - position;
+            float distance = glm::length(offset);
+            if (distance > arrival)
+            {
+                return offset * (maxSpeed / distance);
+            }
+            path.nextTile++;
+        }
+        return glm::vec2(0.0f);
+    }
+
+public:
+    SteeringSystem()
+    {
+        RequireComponent<TransformerComponent>();
+        RequireComponent<RigidBodyComponent>();
+        RequireComponent<SteeringComponent>();
+    }
+
+    CrowdSteering &GetCrowd() { return crowd; }
+
+    void Update(double deltaTime, const TerrainMap &terrain)
+    {
+        const auto &entities = GetEntities();
+        const float tileSize = terrain.GetTileSize();
+
+        // agent index == index in the entity list
+        crowd.Clear();
+        crowd.Reserve(entities.size());
+        for (auto entity : entities)
+        {
+            const auto &position = entity.GetComponent<TransformerComponent>().position;
+            const auto &steering = entity.GetComponent<SteeringComponent>();
+            glm::vec2 preferred = PreferredVelocity(entity, position, steering.maxSpeed, tileSize);
+            crowd.AddAgent(position, entity.GetComponent<RigidBodyComponent>().velocity, preferred, steering.radius, steering.maxSpeed);
+        }
+        crowd.Solve(static_cast<float>(deltaTime));
+
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            entities[i].GetComponent<RigidBodyComponent>().velocity = crowd.GetVelocity(static_cast<int>(i));
+        }
+    }
+};
+
+#endif
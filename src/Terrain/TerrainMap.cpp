@@ -0,0 +1,270 @@
+#include "TerrainMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "../Logger/Logger.h"
+
+TerrainMap::TerrainMap()
+    : width(0), height(0), tileSize(1.0f), blockingFlags(0), wordsPerRow(0), chunksX(0), chunksY(0)
+{
+}
+
+void TerrainMap::Load(int mapWidth, int mapHeight, const std::vector<int> &tiles, const TileProperties &properties,
+                      float mapTileSize, uint8_t mapBlockingFlags)
+{
+    width = mapWidth;
+    height = mapHeight;
+    tileSize = mapTileSize;
+    blockingFlags = mapBlockingFlags;
+
+    tileFlags.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < tileFlags.size(); i++)
+    {
+        tileFlags[i] = properties.Get(tiles[i]);
+    }
+    Bake();
+}
+
+bool TerrainMap::LoadFromFile(const std::string &path, const TileProperties &properties,
+                              float mapTileSize, uint8_t mapBlockingFlags)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        Logger::Err("Could not open tile map " + path);
+        return false;
+    }
+
+    std::vector<int> tiles;
+    int mapWidth = 0;
+    int mapHeight = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::stringstream row(line);
+        std::string value;
+        int columns = 0;
+        while (std::getline(row, value, ','))
+        {
+            if (value.find_first_not_of(" \t\r") == std::string::npos)
+            {
+                continue;
+            }
+            tiles.push_back(std::atoi(value.c_str()));
+            columns++;
+        }
+        if (columns == 0)
+        {
+            continue;
+        }
+        if (mapHeight > 0 && columns != mapWidth)
+        {
+            Logger::Err("Tile map " + path + " has rows of different lengths");
+            return false;
+        }
+        mapWidth = columns;
+        mapHeight++;
+    }
+
+    Load(mapWidth, mapHeight, tiles, properties, mapTileSize, mapBlockingFlags);
+    LOGGER_INFO(LOG_PHYSICS, "Loaded tile map " + path + " (" + std::to_string(width) + "x" + std::to_string(height) + ")");
+    return true;
+}
+
+void TerrainMap::Bake()
+{
+    wordsPerRow = (width + 63) >> 6;
+    blocked.assign(static_cast<size_t>(wordsPerRow) * height, 0);
+    for (int row = 0; row < height; row++)
+    {
+        for (int column = 0; column < width; column++)
+        {
+            if (tileFlags[row * width + column] & blockingFlags)
+            {
+                blocked[row * wordsPerRow + (column >> 6)] |= uint64_t(1) << (column & 63);
+            }
+        }
+    }
+
+    chunksX = (width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    chunksY = (height + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    size_t chunkWords = (static_cast<size_t>(chunksX) * chunksY + 63) >> 6;
+    chunkEmpty.assign(chunkWords, 0);
+    chunkSolid.assign(chunkWords, 0);
+    for (int chunkY = 0; chunkY < chunksY; chunkY++)
+    {
+        for (int chunkX = 0; chunkX < chunksX; chunkX++)
+        {
+            BakeChunk(chunkX, chunkY);
+        }
+    }
+}
+
+void TerrainMap::BakeChunk(int chunkX, int chunkY)
+{
+    // chunks on the right and bottom edges may be cut short by the map
+    int firstColumn = chunkX << CHUNK_SHIFT;
+    int firstRow = chunkY << CHUNK_SHIFT;
+    int lastColumn = std::min(firstColumn + CHUNK_SIZE, width) - 1;
+    int lastRow = std::min(firstRow + CHUNK_SIZE, height) - 1;
+
+    int blockedCount = 0;
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        // a chunk row never straddles two words since 64 is a multiple of CHUNK_SIZE
+        uint64_t bits = blocked[row * wordsPerRow + (firstColumn >> 6)] >> (firstColumn & 63);
+        bits &= ~uint64_t(0) >> (64 - (lastColumn - firstColumn + 1));
+        blockedCount += __builtin_popcountll(bits);
+    }
+
+    int chunk = chunkY * chunksX + chunkX;
+    uint64_t bit = uint64_t(1) << (chunk & 63);
+    int tileCount = (lastColumn - firstColumn + 1) * (lastRow - firstRow + 1);
+    chunkEmpty[chunk >> 6] = blockedCount == 0 ? chunkEmpty[chunk >> 6] | bit : chunkEmpty[chunk >> 6] & ~bit;
+    chunkSolid[chunk >> 6] = blockedCount == tileCount ? chunkSolid[chunk >> 6] | bit : chunkSolid[chunk >> 6] & ~bit;
+}
+
+void TerrainMap::SetTile(int column, int row, const TileProperties &properties, int tileIndex)
+{
+    if (!IsInside(column, row))
+    {
+        return;
+    }
+    uint8_t flags = properties.Get(tileIndex);
+    tileFlags[row * width + column] = flags;
+    uint64_t &word = blocked[row * wordsPerRow + (column >> 6)];
+    uint64_t bit = uint64_t(1) << (column & 63);
+    word = (flags & blockingFlags) ? word | bit : word & ~bit;
+    BakeChunk(column >> CHUNK_SHIFT, row >> CHUNK_SHIFT);
+}
+
+bool TerrainMap::IsRowSpanBlocked(int row, int firstColumn, int lastColumn) const
+{
+    const uint64_t *bits = GetRowBits(row);
+    int firstWord = firstColumn >> 6;
+    int lastWord = lastColumn >> 6;
+    for (int word = firstWord; word <= lastWord; word++)
+    {
+        uint64_t mask = ~uint64_t(0);
+        if (word == firstWord)
+        {
+            mask &= ~uint64_t(0) << (firstColumn & 63);
+        }
+        if (word == lastWord)
+        {
+            mask &= ~uint64_t(0) >> (63 - (lastColumn & 63));
+        }
+        if (bits[word] & mask)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TerrainMap::IsAreaBlocked(int firstColumn, int firstRow, int lastColumn, int lastRow) const
+{
+    if (firstColumn > lastColumn || firstRow > lastRow)
+    {
+        return false;
+    }
+    if (firstColumn < 0 || firstRow < 0 || lastColumn >= width || lastRow >= height)
+    {
+        return true;
+    }
+
+    for (int chunkY = firstRow >> CHUNK_SHIFT; chunkY <= lastRow >> CHUNK_SHIFT; chunkY++)
+    {
+        for (int chunkX = firstColumn >> CHUNK_SHIFT; chunkX <= lastColumn >> CHUNK_SHIFT; chunkX++)
+        {
+            if (IsChunkEmpty(chunkX, chunkY))
+            {
+                continue;
+            }
+            if (IsChunkSolid(chunkX, chunkY))
+            {
+                return true;
+            }
+            // mixed chunk: test the part of the area inside it row by row
+            int spanFirst = std::max(firstColumn, chunkX << CHUNK_SHIFT);
+            int spanLast = std::min(lastColumn, ((chunkX + 1) << CHUNK_SHIFT) - 1);
+            int rowFirst = std::max(firstRow, chunkY << CHUNK_SHIFT);
+            int rowLast = std::min(lastRow, ((chunkY + 1) << CHUNK_SHIFT) - 1);
+            for (int row = rowFirst; row <= rowLast; row++)
+            {
+                if (IsRowSpanBlocked(row, spanFirst, spanLast))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool TerrainMap::OverlapsBlocked(const AABB &box) const
+{
+    // a box edge lying exactly on a tile border does not touch the next tile
+    int firstColumn = static_cast<int>(std::floor(box.min.x / tileSize));
+    int firstRow = static_cast<int>(std::floor(box.min.y / tileSize));
+    int lastColumn = std::max(firstColumn, static_cast<int>(std::ceil(box.max.x / tileSize)) - 1);
+    int lastRow = std::max(firstRow, static_cast<int>(std::ceil(box.max.y / tileSize)) - 1);
+    return IsAreaBlocked(firstColumn, firstRow, lastColumn, lastRow);
+}
+
+bool TerrainMap::HasLineOfSight(glm::vec2 from, glm::vec2 to) const
+{
+    // walk the segment one tile row at a time; within a row it covers one
+    // contiguous span of columns, which is tested a word at a time
+    glm::vec2 a = from / tileSize;
+    glm::vec2 b = to / tileSize;
+    if (a.y > b.y)
+    {
+        std::swap(a, b);
+    }
+    float dy = b.y - a.y;
+    float slope = dy > 0.0f ? (b.x - a.x) / dy : 0.0f;
+
+    int firstRow = static_cast<int>(std::floor(a.y));
+    int lastRow = std::max(firstRow, static_cast<int>(std::ceil(b.y)) - 1);
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        float spanStart;
+        float spanEnd;
+        if (dy > 0.0f)
+        {
+            float yStart = std::max(a.y, static_cast<float>(row));
+            float yEnd = std::min(b.y, static_cast<float>(row + 1));
+            spanStart = a.x + (yStart - a.y) * slope;
+            spanEnd = a.x + (yEnd - a.y) * slope;
+        }
+        else
+        {
+            spanStart = a.x;
+            spanEnd = b.x;
+        }
+        float left = std::min(spanStart, spanEnd);
+        float right = std::max(spanStart, spanEnd);
+        int firstColumn = static_cast<int>(std::floor(left));
+        int lastColumn = std::max(firstColumn, static_cast<int>(std::ceil(right)) - 1);
+
+        if (row < 0 || row >= height || firstColumn < 0 || lastColumn >= width)
+        {
+            return false;
+        }
+        if (IsRowSpanBlocked(row, firstColumn, lastColumn))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TerrainMap::HasLineOfSight(int fromColumn, int fromRow, int toColumn, int toRow) const
+{
+    glm::vec2 from = (glm::vec2(fromColumn, fromRow) + 0.5f) * tileSize;
+    glm::vec2 to = (glm::vec2(toColumn, toRow) + 0.5f) * tileSize;
+    return HasLineOfSight(from, to);
+}
@@ -0,0 +1,105 @@
+#ifndef TERRAINMAP_H
+#define TERRAINMAP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "TileProperties.h"
+#include "../Physics/AABB.h"
+
+// Collision view of a tile map, baked once when the map is loaded.
+//
+// Every tile whose flags contain one of the blocking flags gets a bit in a
+// packed row-major bitmask (64 tiles per word), so "is this tile blocked"
+// is a shift and a mask and a whole row span is tested a word at a time.
+// On top of that every CHUNK_SIZE x CHUNK_SIZE chunk has two summary bits,
+// fully empty and fully solid, which let area queries skip whole chunks of
+// open ground or solid rock without looking at the tiles.
+//
+// Tile coordinates are (column, row); world coordinates are pixels, with
+// tile (0, 0) at the world origin. Everything outside the map is blocked.
+class TerrainMap
+{
+private:
+    int width;
+    int height;
+    float tileSize;
+    uint8_t blockingFlags;
+
+    // per tile, from the property table
+    std::vector<uint8_t> tileFlags;
+    // one bit per tile, rows padded to whole words
+    std::vector<uint64_t> blocked;
+    int wordsPerRow;
+
+    std::vector<uint64_t> chunkEmpty;
+    std::vector<uint64_t> chunkSolid;
+    int chunksX;
+    int chunksY;
+
+    void Bake();
+    // recomputes the empty / solid summary bits of one chunk
+    void BakeChunk(int chunkX, int chunkY);
+    // true if any tile of the row in [firstColumn, lastColumn] is blocked
+    bool IsRowSpanBlocked(int row, int firstColumn, int lastColumn) const;
+
+    static bool TestBit(const std::vector<uint64_t> &bits, int index)
+    {
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+
+public:
+    static const int CHUNK_SHIFT = 3;
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+
+    TerrainMap();
+
+    // tiles holds width * height tile indices, row by row
+    void Load(int width, int height, const std::vector<int> &tiles, const TileProperties &properties,
+              float tileSize, uint8_t blockingFlags = TILE_SOLID | TILE_WATER);
+    // reads a comma separated .map file, one line per row
+    bool LoadFromFile(const std::string &path, const TileProperties &properties,
+                      float tileSize, uint8_t blockingFlags = TILE_SOLID | TILE_WATER);
+    // changes one tile and rebakes its bit and its chunk
+    void SetTile(int column, int row, const TileProperties &properties, int tileIndex);
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    float GetTileSize() const { return tileSize; }
+    bool IsInside(int column, int row) const { return column >= 0 && row >= 0 && column < width && row < height; }
+
+    uint8_t GetFlags(int column, int row) const
+    {
+        return IsInside(column, row) ? tileFlags[row * width + column] : 0;
+    }
+
+    bool IsBlocked(int column, int row) const
+    {
+        if (!IsInside(column, row))
+        {
+            return true;
+        }
+        return (blocked[row * wordsPerRow + (column >> 6)] >> (column & 63)) & 1;
+    }
+
+    // the packed bits of one row, for scans that want whole words (pathfinding)
+    const uint64_t *GetRowBits(int row) const { return &blocked[row * wordsPerRow]; }
+    int GetWordsPerRow() const { return wordsPerRow; }
+
+    bool IsChunkEmpty(int chunkX, int chunkY) const { return TestBit(chunkEmpty, chunkY * chunksX + chunkX); }
+    bool IsChunkSolid(int chunkX, int chunkY) const { return TestBit(chunkSolid, chunkY * chunksX + chunkX); }
+
+    // true if any tile in the inclusive tile rectangle is blocked
+    bool IsAreaBlocked(int firstColumn, int firstRow, int lastColumn, int lastRow) const;
+    // true if the world box touches a blocked tile (unit versus terrain)
+    bool OverlapsBlocked(const AABB &box) const;
+
+    // true if the straight segment between the two world points crosses no
+    // blocked tile; every tile the segment passes through is tested
+    bool HasLineOfSight(glm::vec2 from, glm::vec2 to) const;
+    // same, between the centers of two tiles
+    bool HasLineOfSight(int fromColumn, int fromRow, int toColumn, int toRow) const;
+};
+
+#endif
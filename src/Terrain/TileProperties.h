@@ -0,0 +1,52 @@
+#ifndef TILEPROPERTIES_H
+#define TILEPROPERTIES_H
+
+#include <cstdint>
+#include <vector>
+
+enum TileFlags : uint8_t
+{
+    TILE_SOLID = 1 << 0,
+    TILE_WATER = 1 << 1,
+    TILE_ROAD = 1 << 2
+};
+
+// what each tile index of a tileset is made of; unknown indices are plain ground
+class TileProperties
+{
+private:
+    std::vector<uint8_t> flags;
+
+public:
+    void Set(int tileIndex, uint8_t tileFlags)
+    {
+        if (tileIndex >= static_cast<int>(flags.size()))
+        {
+            flags.resize(tileIndex + 1, 0);
+        }
+        flags[tileIndex] = tileFlags;
+    }
+
+    uint8_t Get(int tileIndex) const
+    {
+        return tileIndex >= 0 && tileIndex < static_cast<int>(flags.size()) ? flags[tileIndex] : 0;
+    }
+
+    // assets/tilemaps/jungle.png, 10 tiles per row, indices as used in jungle.map
+    static TileProperties Jungle()
+    {
+        TileProperties properties;
+        // open water and the shore tiles that are mostly water
+        for (int tileIndex : {9, 11, 13, 16, 17, 18, 19, 21, 22})
+        {
+            properties.Set(tileIndex, TILE_WATER);
+        }
+        // rocks
+        properties.Set(25, TILE_SOLID);
+        properties.Set(26, TILE_SOLID);
+        // the tileset has no road tiles yet
+        return properties;
+    }
+};
+
+#endif
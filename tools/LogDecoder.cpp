@@ -0,0 +1,317 @@
+// offline decoder for the Logger binary sink
+//
+//   ./logdecoder game.blog          -> text lines like the console sink
+//   ./logdecoder --json game.blog   -> one JSON object per line
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../src/Logger/BinaryLog.h"
+
+using namespace std;
+
+struct Format
+{
+    uint8_t level;
+    string category;
+    string argCodes;
+    string text;
+};
+
+class Reader
+{
+private:
+    const vector<char> &data;
+    size_t offset;
+
+public:
+    Reader(const vector<char> &data) : data(data), offset(0) {}
+
+    bool AtEnd() const { return offset >= data.size(); }
+
+    template <typename T>
+    bool Get(T &value)
+    {
+        if (offset + sizeof(T) > data.size())
+            return false;
+        memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool GetString(string &value)
+    {
+        uint16_t length;
+        if (!Get(length) || offset + length > data.size())
+            return false;
+        value.assign(data.data() + offset, length);
+        offset += length;
+        return true;
+    }
+
+    bool GetBytes(vector<char> &bytes, size_t size)
+    {
+        if (offset + size > data.size())
+            return false;
+        bytes.assign(data.begin() + offset, data.begin() + offset + size);
+        offset += size;
+        return true;
+    }
+};
+
+const char *LevelLabel(uint8_t level)
+{
+    static const char *labels[] = {"TRC", "DBG", "LOG", "WRN", "ERR"};
+    return level < 5 ? labels[level] : "???";
+}
+
+const char *LevelName(uint8_t level)
+{
+    static const char *names[] = {"trace", "debug", "info", "warning", "error"};
+    return level < 5 ? names[level] : "unknown";
+}
+
+string WallClock(int64_t wallMicros)
+{
+    time_t seconds = static_cast<time_t>(wallMicros / 1000000);
+    long micros = static_cast<long>(wallMicros % 1000000);
+    tm localTime;
+    localtime_r(&seconds, &localTime);
+    char prefix[32];
+    strftime(prefix, sizeof(prefix), "%d-%b-%Y %H:%M:%S", &localTime);
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%s.%06ld", prefix, micros);
+    return buffer;
+}
+
+string JsonEscape(const string &text)
+{
+    string escaped;
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+// turns the raw argument bytes back into text; strings are returned quoted
+// for JSON in jsonValues and unquoted in textValues
+bool DecodeArguments(const string &argCodes, const vector<char> &payload, vector<string> &textValues, vector<string> &jsonValues)
+{
+    Reader reader(payload);
+    for (char code : argCodes)
+    {
+        ostringstream text;
+        string json;
+        switch (code)
+        {
+        case BinaryLog::ARG_INT:
+        {
+            int64_t value;
+            if (!reader.Get(value))
+                return false;
+            text << value;
+            json = text.str();
+            break;
+        }
+        case BinaryLog::ARG_UINT:
+        {
+            uint64_t value;
+            if (!reader.Get(value))
+                return false;
+            text << value;
+            json = text.str();
+            break;
+        }
+        case BinaryLog::ARG_DOUBLE:
+        {
+            double value;
+            if (!reader.Get(value))
+                return false;
+            text << value;
+            json = text.str();
+            break;
+        }
+        case BinaryLog::ARG_BOOL:
+        {
+            uint8_t value;
+            if (!reader.Get(value))
+                return false;
+            text << (value ? "true" : "false");
+            json = text.str();
+            break;
+        }
+        case BinaryLog::ARG_STRING:
+        {
+            string value;
+            if (!reader.GetString(value))
+                return false;
+            text << value;
+            json = "\"" + JsonEscape(value) + "\"";
+            break;
+        }
+        default:
+            return false;
+        }
+        textValues.push_back(text.str());
+        jsonValues.push_back(json);
+    }
+    return true;
+}
+
+string Substitute(const string &format, const vector<string> &values)
+{
+    string message;
+    size_t next = 0;
+    for (size_t i = 0; i < format.size(); i++)
+    {
+        if (format[i] == '{' && i + 1 < format.size() && format[i + 1] == '}' && next < values.size())
+        {
+            message += values[next++];
+            i++;
+        }
+        else
+        {
+            message += format[i];
+        }
+    }
+    return message;
+}
+
+int main(int argc, char *argv[])
+{
+    bool json = false;
+    string path;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+            path = argv[i];
+    }
+    if (path.empty())
+    {
+        cerr << "usage: " << argv[0] << " [--json] <binary log file>" << endl;
+        return 1;
+    }
+
+    ifstream file(path, ios::binary);
+    if (!file)
+    {
+        cerr << "cannot open " << path << endl;
+        return 1;
+    }
+    vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    Reader reader(data);
+    char magic[4];
+    uint16_t version;
+    int64_t wallAtSteadyZero;
+    if (!reader.Get(magic) || memcmp(magic, BinaryLog::MAGIC, sizeof(magic)) != 0 ||
+        !reader.Get(version) || !reader.Get(wallAtSteadyZero))
+    {
+        cerr << path << " is not a binary log" << endl;
+        return 1;
+    }
+    if (version != BinaryLog::VERSION)
+    {
+        cerr << "unsupported binary log version " << version << endl;
+        return 1;
+    }
+
+    unordered_map<uint32_t, Format> formats;
+    vector<char> payload;
+    while (!reader.AtEnd())
+    {
+        uint8_t kind;
+        reader.Get(kind);
+        if (kind == BinaryLog::RECORD_FORMAT)
+        {
+            uint32_t id;
+            Format format;
+            if (!reader.Get(id) || !reader.Get(format.level) || !reader.GetString(format.category) ||
+                !reader.GetString(format.argCodes) || !reader.GetString(format.text))
+                break;
+            formats[id] = format;
+        }
+        else if (kind == BinaryLog::RECORD_EVENT)
+        {
+            uint32_t id;
+            int64_t nanoseconds;
+            uint32_t thread;
+            uint16_t size;
+            if (!reader.Get(id) || !reader.Get(nanoseconds) || !reader.Get(thread) ||
+                !reader.Get(size) || !reader.GetBytes(payload, size))
+                break;
+
+            auto found = formats.find(id);
+            if (found == formats.end())
+            {
+                cerr << "record refers to unknown format " << id << endl;
+                continue;
+            }
+            const Format &format = found->second;
+            vector<string> textValues;
+            vector<string> jsonValues;
+            if (!DecodeArguments(format.argCodes, payload, textValues, jsonValues))
+            {
+                cerr << "record for format " << id << " has truncated arguments" << endl;
+            }
+            string time = WallClock(wallAtSteadyZero + nanoseconds / 1000);
+            string message = Substitute(format.text, textValues);
+            if (json)
+            {
+                cout << "{\"time\":\"" << time << "\",\"level\":\"" << LevelName(format.level)
+                     << "\",\"category\":\"" << JsonEscape(format.category) << "\",\"thread\":" << thread
+                     << ",\"format\":\"" << JsonEscape(format.text) << "\",\"args\":[";
+                for (size_t i = 0; i < jsonValues.size(); i++)
+                {
+                    cout << (i ? "," : "") << jsonValues[i];
+                }
+                cout << "],\"message\":\"" << JsonEscape(message) << "\"}\n";
+            }
+            else
+            {
+                cout << LevelLabel(format.level) << " | " << time << " - [" << format.category << ":" << thread << "] "
+                     << message << "\n";
+            }
+        }
+        else
+        {
+            cerr << "corrupt record kind " << static_cast<int>(kind) << ", stopping" << endl;
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+// build-time compiler of Lua scripts into one bytecode pack for ScriptLoader
+//
+//   ./scriptpacker assets/scripts.pack assets/scripts [more dirs or .lua files]
+//
+// directories are searched recursively for *.lua; the game loads the pack
+// with ScriptLoader::OpenPack and only compiles scripts changed since
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "../src/Scripting/ScriptLoader.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <pack> <directory or .lua file>...\n", argv[0]);
+        return 1;
+    }
+
+    vector<string> paths;
+    for (int i = 2; i < argc; i++)
+    {
+        filesystem::path input(argv[i]);
+        if (!filesystem::is_directory(input))
+        {
+            paths.push_back(input.string());
+            continue;
+        }
+        for (const auto &file : filesystem::recursive_directory_iterator(input))
+        {
+            if (file.is_regular_file() && file.path().extension() == ".lua")
+            {
+                paths.push_back(file.path().string());
+            }
+        }
+    }
+    // same input, same pack
+    sort(paths.begin(), paths.end());
+
+    int packed = ScriptLoader::WritePack(paths, argv[1]);
+    if (packed < 0)
+    {
+        return 1;
+    }
+    printf("%d scripts packed into %s\n", packed, argv[1]);
+    return 0;
+}